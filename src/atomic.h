@@ -66,17 +66,16 @@ enum ERRORS
  */
 
 
-#define NELEMENTS		50          /* Maximum number of elements to consider */
+/* The tables of atomic data are not a fixed size, but grow as the data is read in, see atomic_tables.c */
+
 int nelements;                  /* The actual number of ions read from the data file */
-#define NIONS		500             /* Maximum number of ions to consider */
 int nions;                      /*The actual number of ions read from the datafile */
-#define NLEVELS 	12000         /* Maximum number of levels for all elements and ions */
 int nlevels;                    /*These are the actual number of levels which were read in */
 #define NLTE_LEVELS	12000       /* Maximum number of levels to treat explicitly */
 int nlte_levels;                /* Actual number of levels to treat explicityly */
 #define NLEVELS_MACRO   200     /* Maximum number of macro atom levels. (SS, June 04) */
 int nlevels_macro;              /* Actual number of macro atom levels. (SS, June 04) */
-#define NLINES 		200000        /* Maximum number of lines to be read */
+#define PYTHON_NLINES 200000      /* NLINES in Python, which is used to number the photoionization edges */
 int nlines;                     /* Actual number of lines that were read in */
 int nlines_macro;               /* Actual number of Macro Atom lines that were read in.  New version of get_atomic
                                    data assumes that macro lines are read in before non-macro lines */
@@ -189,6 +188,7 @@ typedef struct ions
 ion_dummy, *IonPtr;
 
 IonPtr ions;
+int *simple_line_ignore;        /* The number of simple lines ignored for each macro-ion when the data was read */
 
 
 /* And now for the arrays which describe the energy levels.  In the Topbase data, g is float (although
@@ -267,7 +267,7 @@ typedef struct lines
 line_dummy, *LinePtr;
 
 
-LinePtr line, lin_ptr[NLINES];  /* line[] is the actual structure array that contains all the data, *lin_ptr
+LinePtr line, *lin_ptr;         /* line[] is the actual structure array that contains all the data, *lin_ptr
                                    is an array which contains a frequency ordered set of ptrs to line */
                                 /* fast_line (added by SS August 05) is going to be a hypothetical
                                    rapid transition used in the macro atoms to stabilise level populations */
@@ -302,7 +302,7 @@ typedef struct coll_stren
   double scups[N_COLL_STREN_PTS]; //The sclaed coll sttengths in ythe fit.
 } Coll_stren, *Coll_strenptr;
 
-Coll_stren coll_stren[NLINES];  //Set up the structure - we could in principle have as many of these as we have lines
+Coll_strenptr coll_stren;       //Set up the structure - we could in principle have as many of these as we have lines
 
 
 
@@ -312,7 +312,6 @@ int nxphot;                     /*The actual number of ions for which there are
 double phot_freq_min;           /*The lowest frequency for which photoionization can occur */
 double inner_freq_min;          /*The lowest frequency for which inner shel ionization can take place */
 
-#define NCROSS 1500
 #define NTOP_PHOT 400           /* Maximum number of photoionisation processes. (SS) */
 int ntop_phot;                  /* The actual number of TopBase photoionzation x-sections */
 int nphot_total;                /* total number of photoionzation x-sections = nxphot + ntop_phot */
@@ -344,14 +343,24 @@ typedef struct topbase_phot
                                    configuration (nlev) and then up_index. (SS) */
   int up_index;
   int use;                      /* It we are to use this cross section. This allows unused VFKY cross sections to sit in the array. */
-  double freq[NCROSS], x[NCROSS];
+  int offset;                   /* Index of the first point of this cross section in the cross section pool */
+  double *freq, *x;             /* Pointers into the cross section pool, np points long */
   double f, sigma;              /*last freq, last x-section */
 } Topbase_phot, *TopPhotPtr;
 
-Topbase_phot phot_top[NLEVELS];
-TopPhotPtr phot_top_ptr[NLEVELS]; /* Pointers to phot_top in threshold frequency order - this */
-Topbase_phot inner_cross[N_INNER * NIONS];
-TopPhotPtr inner_cross_ptr[N_INNER * NIONS];
+TopPhotPtr phot_top;
+TopPhotPtr *phot_top_ptr;       /* Pointers to phot_top in threshold frequency order - this */
+TopPhotPtr inner_cross;
+TopPhotPtr *inner_cross_ptr;
+
+/* The frequency and cross section points for every photoionization and inner shell cross section are packed
+   end to end in a single pool, rather than each record reserving space for the largest cross section.  The
+   memory used therefore scales with the number of points actually read in */
+
+int xsection_pool_npts;         /* The number of points stored in the pool */
+int xsection_pool_size;         /* The number of points the pool currently has space for */
+double *xsection_pool_freq;     /* The frequencies of the points in the pool */
+double *xsection_pool_x;        /* The cross sections of the points in the pool */
 
 
 
@@ -393,7 +402,7 @@ typedef struct inner_elec_yield
   double Ea;                    /*Average electron energy */
 } Inner_elec_yield, Inner_elec_yieldPtr;
 
-Inner_elec_yield inner_elec_yield[N_INNER * NIONS];
+Inner_elec_yield *inner_elec_yield;
 
 /* This structure is for the flourescent photon yield following inner shell ionization from Kaastra and Mewe*/
 typedef struct inner_fluor_yield
@@ -405,7 +414,7 @@ typedef struct inner_fluor_yield
   double yield;                 /*number of photons per ionization */
 } Inner_fluor_yield, Inner_fluor_yieldPtr;
 
-Inner_fluor_yield inner_fluor_yield[N_INNER * NIONS];
+Inner_fluor_yield *inner_fluor_yield;
 
 
 
@@ -420,7 +429,7 @@ struct ground_fracs
                                    and then we go in steps of 5000 to ground_frac[19] which is for t=1e5. these
                                    fractions must have been computed elsewhere */
 }
-ground_frac[NIONS];
+ *ground_frac;
 
 
 //081115 nsh New structure and variables to hold the dielectronic recombination rate data
@@ -442,9 +451,11 @@ typedef struct dielectronic_recombination
 } Drecomb, *Drecombptr;
 
 
-Drecomb drecomb[NIONS];         //set up the actual structure
+Drecombptr drecomb;             //set up the actual structure
 
-double dr_coeffs[NIONS];        //this will be an array to temprarily store the volumetric dielectronic recombination rate coefficients for the current cell under interest. We may want to make this 2D and store the coefficients for a range of temperatures to interpolate.
+/* The dr_coeffs, di_coeffs and qrecomb_coeffs arrays, which were sized by NIONS, have been removed. They held
+   the rates of the ions for the cell Python was working on and nothing in atomix filled them in or used them.
+   The rates are now evaluated by evaluate_ion_rates into arrays provided by the caller */
 
 
 #define T_RR_PARAMS 6           //This is the number of parameters.
@@ -460,7 +471,7 @@ typedef struct total_rr
   int type;                     /* NSH 23/7/2012 - What type of parampeters we have for this ion */
 } Total_rr, *total_rrptr;
 
-Total_rr total_rr[NIONS];       //Set up the structure
+total_rrptr total_rr;           //Set up the structure
 
 #define BAD_GS_RR_PARAMS 19     //This is the number of points in the fit.
 int n_bad_gs_rr;
@@ -471,7 +482,7 @@ typedef struct badnell_gs_rr
   double rates[BAD_GS_RR_PARAMS]; //rates corresponding to those temperatures
 } Bad_gs_rr, *Bad_gs_rrptr;
 
-Bad_gs_rr bad_gs_rr[NIONS];     //Set up the structure
+Bad_gs_rrptr bad_gs_rr;         //Set up the structure
 
 
 #define DERE_DI_PARAMS 20       //This is the maximum number of points in the fit.
@@ -486,12 +497,7 @@ typedef struct dere_di_rate
   double min_temp;
 } Dere_di_rate, *Dere_di_rateptr;
 
-Dere_di_rate dere_di_rate[NIONS]; //Set up the structure
-
-double di_coeffs[NIONS];        //This is an array to store the di_coeffs 
-double qrecomb_coeffs[NIONS];   //JM 1508 analogous array for three body recombination 
-
-#define MAX_GAUNT_N_GSQRD 100   //Space set aside for the number of parameters for scaled inverse temperature
+Dere_di_rateptr dere_di_rate;   //Set up the structure
 
 int gaunt_n_gsqrd;              //The actual number of scaled temperatures
 
@@ -502,7 +508,7 @@ typedef struct gaunt_total
   float s1, s2, s3;
 } Gaunt_total, *Gaunt_totalptr;
 
-Gaunt_total gaunt_total[MAX_GAUNT_N_GSQRD]; //Set up the structure
+Gaunt_totalptr gaunt_total;     //Set up the structure
 
 /* a variable which controls whether to save a summary of atomic data
    this is defined in atomic.h, rather than the modes structure */
@@ -0,0 +1,957 @@
+/* ************************************************************************** */
+/**
+ * @file     atomic_cache.c
+ *
+ * @brief
+ *
+ * Functions for saving and restoring a binary snapshot of the atomic data.
+ *
+ * @details
+ *
+ * Parsing every file listed in a masterfile is slow for the larger data sets,
+ * so once get_atomic_data has read and indexed some atomic data, a snapshot
+ * of the structures in atomic.h is written to a cache directory. The snapshot
+ * is keyed on the path, size and modification time of the masterfile and of
+ * every data file it lists, and is reused whenever none of these have changed.
+ *
+ * The cache directory is $ATOMIX_CACHE_DIR, or $HOME/.cache/atomix if this is
+ * not set. Setting $ATOMIX_NO_CACHE disables the cache entirely.
+ *
+ * The snapshot is a header, a table of sections, the key and then the sections
+ * themselves. Pointers are not stored; the frequency ordered pointer arrays
+ * are stored as indices and the cross section pointers are rebuilt from the
+ * offsets into the cross section pool. The element, ion, level, line and
+ * cross section pool tables are used directly from the snapshot in memory.
+ *
+ * The indices made from the data once it has been read in, i.e. the line
+ * columns, edge thresholds, coverage trees and postings, are saved as well
+ * and also used directly from the snapshot. Loading a snapshot therefore never
+ * has to go through all of the lines or edges.
+ *
+ * Snapshots are loaded by mapping them read-only into memory, so only the
+ * pages which are actually used are read from disk and several instances of
+ * atomix using the same data share the same physical memory. As a snapshot is
+ * always replaced by renaming a new file over it, and never written to in
+ * place, an existing mapping remains valid when the cache is updated.
+ *
+ * ************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "atomix.h"
+
+#define LINELENGTH 400
+#define CACHE_MAGIC "ATOMIXC"
+#define CACHE_VERSION 5
+#define CACHE_ALIGN 64
+
+/* The nanoseconds of the modification time of a file are not in the same
+   member of struct stat everywhere, and some systems only have st_mtime */
+#if defined(__APPLE__)
+#define STAT_MTIME_NSEC(sb) ((long) (sb).st_mtimespec.tv_nsec)
+#elif defined(__linux__)
+#define STAT_MTIME_NSEC(sb) ((long) (sb).st_mtim.tv_nsec)
+#else
+#define STAT_MTIME_NSEC(sb) 0L
+#endif
+
+enum CacheSections
+{
+  CACHE_COUNTS,
+  CACHE_SUMMARY,
+  CACHE_ELE,
+  CACHE_IONS,
+  CACHE_CONFIG,
+  CACHE_LINE,
+  CACHE_LIN_PTR,
+  CACHE_LINE_FREQ,
+  CACHE_LINE_Z,
+  CACHE_LINE_ISTATE,
+  CACHE_LINE_NION,
+  CACHE_LINE_ID,
+  CACHE_LINE_A21,
+  CACHE_LINE_B12,
+  CACHE_LINE_B21,
+  CACHE_LINE_LIFETIME,
+  CACHE_PHOT_TOP,
+  CACHE_PHOT_TOP_PTR,
+  CACHE_INNER_CROSS,
+  CACHE_INNER_CROSS_PTR,
+  CACHE_PHOT_TOP_THRESHOLD,
+  CACHE_INNER_CROSS_THRESHOLD,
+  CACHE_PHOT_TOP_COVERAGE,
+  CACHE_INNER_CROSS_COVERAGE,
+  CACHE_ION_POSTINGS,
+  CACHE_ELEMENT_POSTINGS,
+  CACHE_POSTINGS,
+  CACHE_XSECTION_FREQ,
+  CACHE_XSECTION_X,
+  CACHE_COLL_STREN,
+  CACHE_DRECOMB,
+  CACHE_TOTAL_RR,
+  CACHE_BAD_GS_RR,
+  CACHE_DERE_DI_RATE,
+  CACHE_GAUNT_TOTAL,
+  CACHE_INNER_ELEC_YIELD,
+  CACHE_GROUND_FRAC,
+  CACHE_NSECTIONS
+};
+
+typedef struct CacheHeader_t
+{
+  char magic[8];
+  int version;
+  int nsections;
+  long key_len;
+  long file_size;
+} CacheHeader_t;
+
+typedef struct CacheSection_t
+{
+  long offset;
+  int count;
+  int size;
+} CacheSection_t;
+
+/*
+ * The scalar globals which describe the atomic data
+ */
+
+typedef struct CacheCounts_t
+{
+  int nelements, nions, nlevels, nlte_levels, nlevels_macro;
+  int nlines, nlines_macro, n_inner_tot, nauger;
+  int nxphot, ntop_phot, nphot_total;
+  int n_coll_stren, ndrecomb, n_total_rr, n_bad_gs_rr, n_dere_di_rate, gaunt_n_gsqrd;
+  int xsection_pool_npts;
+  double phot_freq_min, inner_freq_min, rho2nh;
+} CacheCounts_t;
+
+static const int CACHE_SECTION_SIZE[CACHE_NSECTIONS] = {
+  sizeof(CacheCounts_t),
+  sizeof(char),
+  sizeof(ele_dummy),
+  sizeof(ion_dummy),
+  sizeof(config_dummy),
+  sizeof(line_dummy),
+  sizeof(int),
+  sizeof(double),
+  sizeof(int),
+  sizeof(int),
+  sizeof(int),
+  sizeof(int),
+  sizeof(double),
+  sizeof(double),
+  sizeof(double),
+  sizeof(double),
+  sizeof(Topbase_phot),
+  sizeof(int),
+  sizeof(Topbase_phot),
+  sizeof(int),
+  sizeof(double),
+  sizeof(double),
+  sizeof(double),
+  sizeof(double),
+  sizeof(Postings_t),
+  sizeof(Postings_t),
+  sizeof(int),
+  sizeof(double),
+  sizeof(double),
+  sizeof(Coll_stren),
+  sizeof(Drecomb),
+  sizeof(Total_rr),
+  sizeof(Bad_gs_rr),
+  sizeof(Dere_di_rate),
+  sizeof(Gaunt_total),
+  sizeof(Inner_elec_yield),
+  sizeof(struct ground_fracs),
+};
+
+static char *CACHE_SNAPSHOT = NULL;
+static long CACHE_SNAPSHOT_SIZE = 0;
+static int CACHE_SNAPSHOT_MAPPED = FALSE;
+
+/* ************************************************************************** */
+/**
+ * @brief  Check if the cache has been disabled by the user
+ *
+ * @return  TRUE if $ATOMIX_NO_CACHE is set, otherwise FALSE
+ *
+ * @details
+ *
+ * A streamed line list is not kept in memory, so it can't be saved in a
+ * snapshot and the cache is never used.
+ *
+ * ************************************************************************** */
+
+static int
+cache_disabled(void)
+{
+  return getenv("ATOMIX_NO_CACHE") != NULL || AtomixConfiguration.lines_streamed;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Round up a number of bytes so the next section is aligned
+ *
+ * @param[in]  nbytes  The number of bytes
+ *
+ * @return  The number of bytes, rounded up to a multiple of CACHE_ALIGN
+ *
+ * ************************************************************************** */
+
+static long
+cache_align(long nbytes)
+{
+  return (nbytes + CACHE_ALIGN - 1) / CACHE_ALIGN * CACHE_ALIGN;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Append the path, size and modification time of a file to the cache
+ *         key
+ *
+ * @param[in, out]  key      The key, which is reallocated as it grows
+ * @param[in, out]  key_len  The length of the key
+ * @param[in]       path     The path to the file
+ *
+ * @return  0 on success, or -1 if the file could not be found
+ *
+ * @details
+ *
+ * The absolute path is used, as relative paths in a masterfile depend on the
+ * directory atomix is run from.
+ *
+ * ************************************************************************** */
+
+static int
+add_file_to_key(char **key, long *key_len, char *path)
+{
+  int len;
+  char *new_key;
+  char entry[PATH_MAX + LINELENGTH];
+  char real_path[PATH_MAX];
+  struct stat sb;
+
+  if(realpath(path, real_path) == NULL || stat(real_path, &sb))
+    return -1;
+
+  len = snprintf(entry, sizeof(entry), "%s %lld %lld.%09ld\n", real_path, (long long) sb.st_size,
+                 (long long) sb.st_mtime, STAT_MTIME_NSEC(sb));
+
+  if((new_key = realloc(*key, *key_len + len + 1)) == NULL)
+    return -1;
+
+  *key = new_key;
+  memcpy(*key + *key_len, entry, len + 1);
+  *key_len += len;
+
+  return 0;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Create the key which identifies a set of atomic data
+ *
+ * @param[in]   masterfile    The name of the masterfile
+ * @param[in]   use_relative  If TRUE, the paths in the masterfile are used as is
+ * @param[out]  key_len       The length of the key, including the terminating
+ *                            null character
+ *
+ * @return  The key, or NULL if any of the files could not be found
+ *
+ * @details
+ *
+ * The key is a line for the masterfile and each data file listed in it, in
+ * the order they are read by get_atomic_data, giving the path, size and
+ * modification time of each file.
+ *
+ * ************************************************************************** */
+
+static char *
+create_cache_key(char *masterfile, int use_relative, long *key_len)
+{
+  FILE *mptr;
+  char *key = NULL;
+  char aline[LINELENGTH];
+  char file[LINELENGTH];
+  char path[LINELENGTH];
+
+  *key_len = 0;
+
+  if(get_atomic_data_path(masterfile, use_relative, TRUE, path))
+    return NULL;
+  if(add_file_to_key(&key, key_len, path))
+  {
+    free(key);
+    return NULL;
+  }
+
+  if((mptr = fopen(path, "r")) == NULL)
+  {
+    free(key);
+    return NULL;
+  }
+
+  while(fgets(aline, LINELENGTH, mptr) != NULL)
+  {
+    if(scan_atomic_record(aline, "%s", file) == 1 && file[0] != '#')
+    {
+      get_atomic_data_path(file, use_relative, FALSE, path);
+      if(add_file_to_key(&key, key_len, path))
+      {
+        fclose(mptr);
+        free(key);
+        return NULL;
+      }
+    }
+  }
+
+  fclose(mptr);
+  *key_len += 1;
+
+  return key;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Get the name of the snapshot file for a masterfile
+ *
+ * @param[in]   masterfile    The name of the masterfile
+ * @param[in]   use_relative  If TRUE, the masterfile name is used as is
+ * @param[out]  path          The path to the snapshot, LINELENGTH long
+ *
+ * @return  0 on success, or -1 if there is nowhere to put the cache
+ *
+ * @details
+ *
+ * The name of the snapshot is a hash of the absolute path of the masterfile,
+ * so each masterfile has only one snapshot which is replaced when the data
+ * changes. The cache directory is created if it does not exist.
+ *
+ * ************************************************************************** */
+
+static int
+get_cache_file_path(char *masterfile, int use_relative, char *path)
+{
+  char *c;
+  char *home;
+  char dir[LINELENGTH - 32];  // leave room for the file name
+  char master_path[LINELENGTH];
+  char real_path[PATH_MAX];
+  unsigned long long hash = 14695981039346656037ULL;
+
+  if((c = getenv("ATOMIX_CACHE_DIR")) != NULL)
+  {
+    snprintf(dir, sizeof(dir), "%s", c);
+  }
+  else
+  {
+    if((home = getenv("HOME")) == NULL)
+      return -1;
+    snprintf(dir, sizeof(dir), "%s/.cache", home);
+    if(mkdir(dir, 0755) && errno != EEXIST)
+      return -1;
+    snprintf(dir, sizeof(dir), "%s/.cache/atomix", home);
+  }
+
+  if(mkdir(dir, 0755) && errno != EEXIST)
+    return -1;
+
+  if(get_atomic_data_path(masterfile, use_relative, TRUE, master_path))
+    return -1;
+  if(realpath(master_path, real_path) == NULL)
+    return -1;
+
+  for(c = real_path; *c != '\0'; c++)
+  {
+    hash ^= (unsigned char) *c;
+    hash *= 1099511628211ULL;
+  }
+
+  snprintf(path, LINELENGTH, "%s/%016llx.atomix", dir, hash);
+
+  return 0;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Map a snapshot into memory
+ *
+ * @param[in]   path    The path to the snapshot
+ * @param[out]  size    The size of the snapshot in bytes
+ * @param[out]  mapped  TRUE if the snapshot was mapped, FALSE if it had to be
+ *                      read into memory instead
+ *
+ * @return  The start of the snapshot in memory, or NULL if it couldn't be read
+ *
+ * @details
+ *
+ * The snapshot is mapped read-only, so it is an error to modify any of the
+ * tables which point into it. If the file can not be mapped, for example on
+ * some network file systems, it is read into memory instead.
+ *
+ * ************************************************************************** */
+
+static char *
+map_snapshot(char *path, long *size, int *mapped)
+{
+  int fd;
+  char *snapshot;
+  struct stat sb;
+
+  if((fd = open(path, O_RDONLY)) < 0)
+    return NULL;
+
+  if(fstat(fd, &sb) || sb.st_size < (long) (sizeof(CacheHeader_t) + sizeof(CacheSection_t) * CACHE_NSECTIONS))
+  {
+    close(fd);
+    return NULL;
+  }
+
+  *size = sb.st_size;
+  *mapped = TRUE;
+
+  if((snapshot = mmap(NULL, *size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED)
+  {
+    *mapped = FALSE;
+    if((snapshot = malloc(*size)) != NULL && pread(fd, snapshot, *size, 0) != *size)
+    {
+      free(snapshot);
+      snapshot = NULL;
+    }
+  }
+
+  close(fd);
+
+  return snapshot;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Unmap, or free, a snapshot
+ *
+ * @param[in]  snapshot  The start of the snapshot in memory
+ * @param[in]  size      The size of the snapshot in bytes
+ * @param[in]  mapped    TRUE if the snapshot was mapped by map_snapshot
+ *
+ * ************************************************************************** */
+
+static void
+unmap_snapshot(char *snapshot, long size, int mapped)
+{
+  if(mapped)
+    munmap(snapshot, size);
+  else
+    free(snapshot);
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Release the memory used by a snapshot loaded from the cache
+ *
+ * @details
+ *
+ * The tables which were used directly from the snapshot are detached from it,
+ * so that get_atomic_data does not try to free or grow them.
+ *
+ * ************************************************************************** */
+
+void
+release_atomic_data_cache(void)
+{
+  if(CACHE_SNAPSHOT == NULL)
+    return;
+
+  attach_atomic_table(TABLE_ELEMENTS, NULL);
+  attach_atomic_table(TABLE_IONS, NULL);
+  attach_atomic_table(TABLE_CONFIG, NULL);
+  attach_atomic_table(TABLE_LINES, NULL);
+  attach_atomic_table(TABLE_LINE_FREQ, NULL);
+  attach_atomic_table(TABLE_LINE_Z, NULL);
+  attach_atomic_table(TABLE_LINE_ISTATE, NULL);
+  attach_atomic_table(TABLE_LINE_NION, NULL);
+  attach_atomic_table(TABLE_LINE_ID, NULL);
+  attach_atomic_table(TABLE_LINE_A21, NULL);
+  attach_atomic_table(TABLE_LINE_B12, NULL);
+  attach_atomic_table(TABLE_LINE_B21, NULL);
+  attach_atomic_table(TABLE_LINE_LIFETIME, NULL);
+  attach_atomic_table(TABLE_PHOT_TOP_THRESHOLD, NULL);
+  attach_atomic_table(TABLE_INNER_CROSS_THRESHOLD, NULL);
+  attach_atomic_table(TABLE_PHOT_TOP_COVERAGE, NULL);
+  attach_atomic_table(TABLE_INNER_CROSS_COVERAGE, NULL);
+  attach_atomic_table(TABLE_ION_POSTINGS, NULL);
+  attach_atomic_table(TABLE_ELEMENT_POSTINGS, NULL);
+  attach_atomic_table(TABLE_POSTINGS, NULL);
+  xsection_pool_freq = xsection_pool_x = NULL;
+  xsection_pool_npts = xsection_pool_size = 0;
+
+  unmap_snapshot(CACHE_SNAPSHOT, CACHE_SNAPSHOT_SIZE, CACHE_SNAPSHOT_MAPPED);
+  CACHE_SNAPSHOT = NULL;
+  CACHE_SNAPSHOT_SIZE = 0;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Write a snapshot of the atomic data currently loaded to the cache
+ *
+ * @param[in]  masterfile    The name of the masterfile the data was read from
+ * @param[in]  use_relative  If TRUE, the paths in the masterfile are used as is
+ *
+ * @return  0 on success, otherwise -1
+ *
+ * @details
+ *
+ * The snapshot is written to a temporary file which is renamed over the
+ * previous snapshot, so another instance of atomix reading the cache at the
+ * same time never sees a partially written file.
+ *
+ * The atomic summary is saved as it is when this is called, so lines which
+ * depend on how long the data took to read, such as the sort time, should
+ * only be added to it afterwards.
+ *
+ * ************************************************************************** */
+
+int
+save_atomic_data_cache(char *masterfile, int use_relative)
+{
+  int i, n;
+  int error = 0;
+  long offset, key_len;
+  FILE *fptr;
+  char *key;
+  char *summary;
+  char cache_path[LINELENGTH];
+  char tmp_path[LINELENGTH + 32];
+  int *lin_index, *phot_top_index, *inner_cross_index;
+  Topbase_phot *phot_top_copy, *inner_cross_copy;
+  static const char padding[CACHE_ALIGN] = { 0 };
+
+  CacheHeader_t header;
+  CacheCounts_t counts;
+  CacheSection_t sections[CACHE_NSECTIONS];
+  const void *data[CACHE_NSECTIONS];
+
+  if(cache_disabled())
+    return -1;
+  if(get_cache_file_path(masterfile, use_relative, cache_path))
+    return -1;
+  if((key = create_cache_key(masterfile, use_relative, &key_len)) == NULL)
+    return -1;
+
+  counts.nelements = nelements;
+  counts.nions = nions;
+  counts.nlevels = nlevels;
+  counts.nlte_levels = nlte_levels;
+  counts.nlevels_macro = nlevels_macro;
+  counts.nlines = nlines;
+  counts.nlines_macro = nlines_macro;
+  counts.n_inner_tot = n_inner_tot;
+  counts.nauger = nauger;
+  counts.nxphot = nxphot;
+  counts.ntop_phot = ntop_phot;
+  counts.nphot_total = nphot_total;
+  counts.n_coll_stren = n_coll_stren;
+  counts.ndrecomb = ndrecomb;
+  counts.n_total_rr = n_total_rr;
+  counts.n_bad_gs_rr = n_bad_gs_rr;
+  counts.n_dere_di_rate = n_dere_di_rate;
+  counts.gaunt_n_gsqrd = gaunt_n_gsqrd;
+  counts.xsection_pool_npts = xsection_pool_npts;
+  counts.phot_freq_min = phot_freq_min;
+  counts.inner_freq_min = inner_freq_min;
+  counts.rho2nh = rho2nh;
+
+  /*
+   * Pointers can't be stored, so the pointer arrays are converted into indices
+   * and the cross section pointers are cleared as they are rebuilt on loading
+   */
+
+  lin_index = calloc(nlines + 1, sizeof(*lin_index));
+  phot_top_index = calloc(nphot_total + 1, sizeof(*phot_top_index));
+  inner_cross_index = calloc(n_inner_tot + 1, sizeof(*inner_cross_index));
+  phot_top_copy = calloc(nphot_total + 1, sizeof(*phot_top_copy));
+  inner_cross_copy = calloc(n_inner_tot + 1, sizeof(*inner_cross_copy));
+
+  for(i = 0, n = 0; i < ATOMIC_BUFFER.nlines; i++)
+    n += strlen(ATOMIC_BUFFER.lines[i].chars) + 1;
+  summary = calloc(n + 1, sizeof(*summary));
+
+  if(!lin_index || !phot_top_index || !inner_cross_index || !phot_top_copy || !inner_cross_copy || !summary)
+  {
+    error = -1;
+    goto cleanup;
+  }
+
+  for(i = 0; i < nlines; i++)
+    lin_index[i] = lin_ptr[i] - line;
+  for(i = 0; i < nphot_total; i++)
+  {
+    phot_top_index[i] = phot_top_ptr[i] - phot_top;
+    phot_top_copy[i] = phot_top[i];
+    phot_top_copy[i].freq = phot_top_copy[i].x = NULL;
+  }
+  for(i = 0; i < n_inner_tot; i++)
+  {
+    inner_cross_index[i] = inner_cross_ptr[i] - inner_cross;
+    inner_cross_copy[i] = inner_cross[i];
+    inner_cross_copy[i].freq = inner_cross_copy[i].x = NULL;
+  }
+  for(i = 0, n = 0; i < ATOMIC_BUFFER.nlines; i++)
+  {
+    strcpy(summary + n, ATOMIC_BUFFER.lines[i].chars);
+    n += strlen(ATOMIC_BUFFER.lines[i].chars) + 1;
+  }
+
+  sections[CACHE_COUNTS].count = 1;
+  data[CACHE_COUNTS] = &counts;
+  sections[CACHE_SUMMARY].count = n;
+  data[CACHE_SUMMARY] = summary;
+  sections[CACHE_ELE].count = nelements;
+  data[CACHE_ELE] = ele;
+  sections[CACHE_IONS].count = nions;
+  data[CACHE_IONS] = ions;
+  sections[CACHE_CONFIG].count = nlevels;
+  data[CACHE_CONFIG] = config;
+  sections[CACHE_LINE].count = nlines;
+  data[CACHE_LINE] = line;
+  sections[CACHE_LIN_PTR].count = nlines;
+  data[CACHE_LIN_PTR] = lin_index;
+  sections[CACHE_LINE_FREQ].count = nlines;
+  data[CACHE_LINE_FREQ] = line_columns.freq;
+  sections[CACHE_LINE_Z].count = nlines;
+  data[CACHE_LINE_Z] = line_columns.z;
+  sections[CACHE_LINE_ISTATE].count = nlines;
+  data[CACHE_LINE_ISTATE] = line_columns.istate;
+  sections[CACHE_LINE_NION].count = nlines;
+  data[CACHE_LINE_NION] = line_columns.nion;
+  sections[CACHE_LINE_ID].count = nlines;
+  data[CACHE_LINE_ID] = line_columns.id;
+  sections[CACHE_LINE_A21].count = nlines;
+  data[CACHE_LINE_A21] = line_columns.a21;
+  sections[CACHE_LINE_B12].count = nlines;
+  data[CACHE_LINE_B12] = line_columns.b12;
+  sections[CACHE_LINE_B21].count = nlines;
+  data[CACHE_LINE_B21] = line_columns.b21;
+  sections[CACHE_LINE_LIFETIME].count = nlines;
+  data[CACHE_LINE_LIFETIME] = line_columns.lifetime;
+  sections[CACHE_PHOT_TOP].count = nphot_total;
+  data[CACHE_PHOT_TOP] = phot_top_copy;
+  sections[CACHE_PHOT_TOP_PTR].count = nphot_total;
+  data[CACHE_PHOT_TOP_PTR] = phot_top_index;
+  sections[CACHE_INNER_CROSS].count = n_inner_tot;
+  data[CACHE_INNER_CROSS] = inner_cross_copy;
+  sections[CACHE_INNER_CROSS_PTR].count = n_inner_tot;
+  data[CACHE_INNER_CROSS_PTR] = inner_cross_index;
+  sections[CACHE_PHOT_TOP_THRESHOLD].count = nphot_total + 1;
+  data[CACHE_PHOT_TOP_THRESHOLD] = phot_top_threshold;
+  sections[CACHE_INNER_CROSS_THRESHOLD].count = n_inner_tot + 1;
+  data[CACHE_INNER_CROSS_THRESHOLD] = inner_cross_threshold;
+  sections[CACHE_PHOT_TOP_COVERAGE].count = coverage_tree_size(nphot_total);
+  data[CACHE_PHOT_TOP_COVERAGE] = phot_top_coverage;
+  sections[CACHE_INNER_CROSS_COVERAGE].count = coverage_tree_size(n_inner_tot);
+  data[CACHE_INNER_CROSS_COVERAGE] = inner_cross_coverage;
+  sections[CACHE_ION_POSTINGS].count = nions;
+  data[CACHE_ION_POSTINGS] = ion_postings;
+  sections[CACHE_ELEMENT_POSTINGS].count = nelements;
+  data[CACHE_ELEMENT_POSTINGS] = element_postings;
+  sections[CACHE_POSTINGS].count = count_postings();
+  data[CACHE_POSTINGS] = postings;
+  sections[CACHE_XSECTION_FREQ].count = xsection_pool_npts;
+  data[CACHE_XSECTION_FREQ] = xsection_pool_freq;
+  sections[CACHE_XSECTION_X].count = xsection_pool_npts;
+  data[CACHE_XSECTION_X] = xsection_pool_x;
+  sections[CACHE_COLL_STREN].count = n_coll_stren;
+  data[CACHE_COLL_STREN] = coll_stren;
+  sections[CACHE_DRECOMB].count = ndrecomb;
+  data[CACHE_DRECOMB] = drecomb;
+  sections[CACHE_TOTAL_RR].count = n_total_rr;
+  data[CACHE_TOTAL_RR] = total_rr;
+  sections[CACHE_BAD_GS_RR].count = n_bad_gs_rr;
+  data[CACHE_BAD_GS_RR] = bad_gs_rr;
+  sections[CACHE_DERE_DI_RATE].count = n_dere_di_rate;
+  data[CACHE_DERE_DI_RATE] = dere_di_rate;
+  sections[CACHE_GAUNT_TOTAL].count = gaunt_n_gsqrd;
+  data[CACHE_GAUNT_TOTAL] = gaunt_total;
+  sections[CACHE_INNER_ELEC_YIELD].count = n_inner_tot;
+  data[CACHE_INNER_ELEC_YIELD] = inner_elec_yield;
+  sections[CACHE_GROUND_FRAC].count = nions;
+  data[CACHE_GROUND_FRAC] = ground_frac;
+
+  /*
+   * Lay out the file: the header, the section table, the key and then each
+   * of the sections aligned to CACHE_ALIGN bytes
+   */
+
+  offset = cache_align(sizeof(header) + sizeof(sections) + key_len);
+  for(i = 0; i < CACHE_NSECTIONS; i++)
+  {
+    sections[i].size = CACHE_SECTION_SIZE[i];
+    sections[i].offset = offset;
+    offset += cache_align((long) sections[i].count * sections[i].size);
+  }
+
+  memset(&header, 0, sizeof(header));
+  strcpy(header.magic, CACHE_MAGIC);
+  header.version = CACHE_VERSION;
+  header.nsections = CACHE_NSECTIONS;
+  header.key_len = key_len;
+  header.file_size = offset;
+
+  snprintf(tmp_path, sizeof(tmp_path), "%s.%d.tmp", cache_path, (int) getpid());
+  if((fptr = fopen(tmp_path, "wb")) == NULL)
+  {
+    logfile("Unable to write atomic data cache %s\n", tmp_path);
+    error = -1;
+    goto cleanup;
+  }
+
+  fwrite(&header, sizeof(header), 1, fptr);
+  fwrite(sections, sizeof(sections), 1, fptr);
+  fwrite(key, 1, key_len, fptr);
+  offset = sizeof(header) + sizeof(sections) + key_len;
+  fwrite(padding, 1, cache_align(offset) - offset, fptr);
+
+  for(i = 0; i < CACHE_NSECTIONS; i++)
+  {
+    offset = (long) sections[i].count * sections[i].size;
+    if(offset > 0)
+      fwrite(data[i], 1, offset, fptr);
+    fwrite(padding, 1, cache_align(offset) - offset, fptr);
+  }
+
+  if(ferror(fptr) | fclose(fptr) || rename(tmp_path, cache_path))
+  {
+    logfile("Unable to write atomic data cache %s\n", cache_path);
+    remove(tmp_path);
+    error = -1;
+    goto cleanup;
+  }
+
+  logfile("Saved atomic data cache %s\n", cache_path);
+
+cleanup:
+  free(key);
+  free(summary);
+  free(lin_index);
+  free(phot_top_index);
+  free(inner_cross_index);
+  free(phot_top_copy);
+  free(inner_cross_copy);
+
+  return error;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Load a snapshot of the atomic data from the cache
+ *
+ * @param[in]  masterfile    The name of the masterfile to load
+ * @param[in]  use_relative  If TRUE, the paths in the masterfile are used as is
+ *
+ * @return  0 if the atomic data was loaded from the cache, otherwise -1
+ *
+ * @details
+ *
+ * The snapshot is only used if its key matches the key for the current state
+ * of the files in the masterfile and if it was written by a build of atomix
+ * with the same structure layouts. Otherwise, nothing is changed and the
+ * atomic data will need to be read in by get_atomic_data.
+ *
+ * The snapshot is mapped into memory and the element, ion, level, line and
+ * cross section pool tables, and the indices made from them, point directly
+ * into the mapping, so none of these are read from disk until they are used.
+ *
+ * ************************************************************************** */
+
+int
+load_atomic_data_cache(char *masterfile, int use_relative)
+{
+  int i;
+  int mapped;
+  long key_len, size;
+  char *key;
+  char *snapshot;
+  char *summary;
+  char cache_path[LINELENGTH];
+  int *index;
+
+  CacheHeader_t *header;
+  CacheCounts_t *counts;
+  CacheSection_t *sections;
+
+  if(cache_disabled())
+    return -1;
+  if(get_cache_file_path(masterfile, use_relative, cache_path))
+    return -1;
+  if((key = create_cache_key(masterfile, use_relative, &key_len)) == NULL)
+    return -1;
+  if((snapshot = map_snapshot(cache_path, &size, &mapped)) == NULL)
+  {
+    free(key);
+    return -1;
+  }
+
+  /*
+   * Check the snapshot is for the same files and structure layouts
+   */
+
+  header = (CacheHeader_t *) snapshot;
+  sections = (CacheSection_t *) (snapshot + sizeof(*header));
+
+  if(strncmp(header->magic, CACHE_MAGIC, sizeof(header->magic)) || header->version != CACHE_VERSION
+     || header->nsections != CACHE_NSECTIONS || header->file_size != size || header->key_len != key_len
+     || (long) (sizeof(*header) + sizeof(*sections) * CACHE_NSECTIONS) + key_len > size
+     || memcmp(snapshot + sizeof(*header) + sizeof(*sections) * CACHE_NSECTIONS, key, key_len))
+  {
+    logfile("Atomic data cache %s is out of date\n", cache_path);
+    unmap_snapshot(snapshot, size, mapped);
+    free(key);
+    return -1;
+  }
+
+  free(key);
+
+  for(i = 0; i < CACHE_NSECTIONS; i++)
+  {
+    if(sections[i].size != CACHE_SECTION_SIZE[i] || sections[i].count < 0
+       || sections[i].offset + (long) sections[i].count * sections[i].size > size)
+    {
+      logfile("Atomic data cache %s is out of date\n", cache_path);
+      unmap_snapshot(snapshot, size, mapped);
+      return -1;
+    }
+  }
+
+  /*
+   * The snapshot is good, so replace whatever atomic data was loaded before
+   */
+
+  release_atomic_data_cache();
+  free_atomic_tables();
+  free_streamed_lines();
+  free(xsection_pool_freq);
+  free(xsection_pool_x);
+
+  CACHE_SNAPSHOT = snapshot;
+  CACHE_SNAPSHOT_SIZE = size;
+  CACHE_SNAPSHOT_MAPPED = mapped;
+
+  counts = (CacheCounts_t *) (snapshot + sections[CACHE_COUNTS].offset);
+  nelements = counts->nelements;
+  nions = counts->nions;
+  nlevels = counts->nlevels;
+  nlte_levels = counts->nlte_levels;
+  nlevels_macro = counts->nlevels_macro;
+  nlines = counts->nlines;
+  nlines_macro = counts->nlines_macro;
+  n_inner_tot = counts->n_inner_tot;
+  nauger = counts->nauger;
+  nxphot = counts->nxphot;
+  ntop_phot = counts->ntop_phot;
+  nphot_total = counts->nphot_total;
+  n_coll_stren = counts->n_coll_stren;
+  ndrecomb = counts->ndrecomb;
+  n_total_rr = counts->n_total_rr;
+  n_bad_gs_rr = counts->n_bad_gs_rr;
+  n_dere_di_rate = counts->n_dere_di_rate;
+  gaunt_n_gsqrd = counts->gaunt_n_gsqrd;
+  phot_freq_min = counts->phot_freq_min;
+  inner_freq_min = counts->inner_freq_min;
+  rho2nh = counts->rho2nh;
+
+  attach_atomic_table(TABLE_ELEMENTS, snapshot + sections[CACHE_ELE].offset);
+  attach_atomic_table(TABLE_IONS, snapshot + sections[CACHE_IONS].offset);
+  attach_atomic_table(TABLE_CONFIG, snapshot + sections[CACHE_CONFIG].offset);
+  attach_atomic_table(TABLE_LINES, snapshot + sections[CACHE_LINE].offset);
+  xsection_pool_freq = (double *) (snapshot + sections[CACHE_XSECTION_FREQ].offset);
+  xsection_pool_x = (double *) (snapshot + sections[CACHE_XSECTION_X].offset);
+  xsection_pool_npts = counts->xsection_pool_npts;
+  xsection_pool_size = 0;
+
+  attach_atomic_table(TABLE_LINE_FREQ, snapshot + sections[CACHE_LINE_FREQ].offset);
+  attach_atomic_table(TABLE_LINE_Z, snapshot + sections[CACHE_LINE_Z].offset);
+  attach_atomic_table(TABLE_LINE_ISTATE, snapshot + sections[CACHE_LINE_ISTATE].offset);
+  attach_atomic_table(TABLE_LINE_NION, snapshot + sections[CACHE_LINE_NION].offset);
+  attach_atomic_table(TABLE_LINE_ID, snapshot + sections[CACHE_LINE_ID].offset);
+  attach_atomic_table(TABLE_LINE_A21, snapshot + sections[CACHE_LINE_A21].offset);
+  attach_atomic_table(TABLE_LINE_B12, snapshot + sections[CACHE_LINE_B12].offset);
+  attach_atomic_table(TABLE_LINE_B21, snapshot + sections[CACHE_LINE_B21].offset);
+  attach_atomic_table(TABLE_LINE_LIFETIME, snapshot + sections[CACHE_LINE_LIFETIME].offset);
+  attach_atomic_table(TABLE_PHOT_TOP_THRESHOLD, snapshot + sections[CACHE_PHOT_TOP_THRESHOLD].offset);
+  attach_atomic_table(TABLE_INNER_CROSS_THRESHOLD, snapshot + sections[CACHE_INNER_CROSS_THRESHOLD].offset);
+  attach_atomic_table(TABLE_PHOT_TOP_COVERAGE, snapshot + sections[CACHE_PHOT_TOP_COVERAGE].offset);
+  attach_atomic_table(TABLE_INNER_CROSS_COVERAGE, snapshot + sections[CACHE_INNER_CROSS_COVERAGE].offset);
+  attach_atomic_table(TABLE_ION_POSTINGS, snapshot + sections[CACHE_ION_POSTINGS].offset);
+  attach_atomic_table(TABLE_ELEMENT_POSTINGS, snapshot + sections[CACHE_ELEMENT_POSTINGS].offset);
+  attach_atomic_table(TABLE_POSTINGS, snapshot + sections[CACHE_POSTINGS].offset);
+
+  /* The rest of the tables are copied out of the snapshot, as they are
+     modified as the data is used */
+
+  if(reserve_atomic_table(TABLE_LIN_PTR, nlines) || reserve_atomic_table(TABLE_PHOT_TOP, nphot_total)
+     || reserve_atomic_table(TABLE_PHOT_TOP_PTR, nphot_total) || reserve_atomic_table(TABLE_INNER_CROSS, n_inner_tot)
+     || reserve_atomic_table(TABLE_INNER_CROSS_PTR, n_inner_tot)
+     || reserve_atomic_table(TABLE_INNER_ELEC_YIELD, n_inner_tot)
+     || reserve_atomic_table(TABLE_COLL_STREN, n_coll_stren) || reserve_atomic_table(TABLE_DRECOMB, ndrecomb)
+     || reserve_atomic_table(TABLE_TOTAL_RR, n_total_rr) || reserve_atomic_table(TABLE_BAD_GS_RR, n_bad_gs_rr)
+     || reserve_atomic_table(TABLE_DERE_DI_RATE, n_dere_di_rate)
+     || reserve_atomic_table(TABLE_GAUNT_TOTAL, gaunt_n_gsqrd) || reserve_atomic_table(TABLE_GROUND_FRAC, nions))
+  {
+    release_atomic_data_cache();
+    free_atomic_tables();
+    return -1;
+  }
+
+  index = (int *) (snapshot + sections[CACHE_LIN_PTR].offset);
+  for(i = 0; i < nlines; i++)
+    lin_ptr[i] = &line[index[i]];
+
+  memcpy(phot_top, snapshot + sections[CACHE_PHOT_TOP].offset, nphot_total * sizeof(*phot_top));
+  index = (int *) (snapshot + sections[CACHE_PHOT_TOP_PTR].offset);
+  for(i = 0; i < nphot_total; i++)
+  {
+    attach_xsection_to_pool(&phot_top[i], phot_top[i].offset);
+    phot_top_ptr[i] = &phot_top[index[i]];
+  }
+
+  memcpy(inner_cross, snapshot + sections[CACHE_INNER_CROSS].offset, n_inner_tot * sizeof(*inner_cross));
+  index = (int *) (snapshot + sections[CACHE_INNER_CROSS_PTR].offset);
+  for(i = 0; i < n_inner_tot; i++)
+  {
+    attach_xsection_to_pool(&inner_cross[i], inner_cross[i].offset);
+    inner_cross_ptr[i] = &inner_cross[index[i]];
+  }
+
+  memcpy(coll_stren, snapshot + sections[CACHE_COLL_STREN].offset, n_coll_stren * sizeof(*coll_stren));
+  memcpy(drecomb, snapshot + sections[CACHE_DRECOMB].offset, ndrecomb * sizeof(*drecomb));
+  memcpy(total_rr, snapshot + sections[CACHE_TOTAL_RR].offset, n_total_rr * sizeof(*total_rr));
+  memcpy(bad_gs_rr, snapshot + sections[CACHE_BAD_GS_RR].offset, n_bad_gs_rr * sizeof(*bad_gs_rr));
+  memcpy(dere_di_rate, snapshot + sections[CACHE_DERE_DI_RATE].offset, n_dere_di_rate * sizeof(*dere_di_rate));
+  memcpy(gaunt_total, snapshot + sections[CACHE_GAUNT_TOTAL].offset, gaunt_n_gsqrd * sizeof(*gaunt_total));
+  if(index_gaunt_segments())
+  {
+    release_atomic_data_cache();
+    free_atomic_tables();
+    return -1;
+  }
+  memcpy(inner_elec_yield, snapshot + sections[CACHE_INNER_ELEC_YIELD].offset,
+         n_inner_tot * sizeof(*inner_elec_yield));
+  memcpy(ground_frac, snapshot + sections[CACHE_GROUND_FRAC].offset, nions * sizeof(*ground_frac));
+
+  summary = snapshot + sections[CACHE_SUMMARY].offset;
+  for(i = 0; i < sections[CACHE_SUMMARY].count; i += strlen(summary + i) + 1)
+    atomic_summary_add("%s", summary + i);
+
+  logfile("Loaded atomic data from cache %s\n", cache_path);
+
+  return 0;
+}
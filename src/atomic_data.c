@@ -15,6 +15,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <time.h>
 
 #include "atomix.h"
 
@@ -63,9 +64,9 @@ view_atomic_summary(void)
  * array or the logarithm of them.
  *
  *
- * The routine uses bisection
- *
- *
+ * The search is done by fraction_cursor with no previous point, i.e. by
+ * bisection. fraction_cursor should be used instead when the same array is
+ * searched many times.
  *
  * ### Notes ###
  *
@@ -93,60 +94,9 @@ fraction(value, array, npts, ival, f, mode)
      double *f;                 // The fractional "distance" to the next point in the array
      int mode;                  // 0 = compute in linear space, 1=compute in log space
 {
-  int imin, imax, ihalf;
-
-  if(value < array[0])
-  {
-    *ival = 0;
-    *f = 0.0;
-    return (-1);
-  }
-
-  imax = npts - 1;
-  if(value > array[imax])
-  {
-    *ival = npts - 2;
-    *f = 1.0;
-    return (1);
-  }
-
-
-
-  imin = 0;
-
-/* In what follows, there is a specific issue as to how to treat
-the situation where the value is exactly on an array element. Right
-now this is set to try to identify the array element below the one
-on which the value sits, and to set the fraction to 1.  This was
-to reflect the behavior of the search routine in where_in_grid. */
-
-  while(imax - imin > 1)
-  {
-    ihalf = (imin + imax) >> 1; // Compute a midpoint >> is a bitwise right shift
-    if(value > array[ihalf])
-    {
-      imin = ihalf;
-    }
-    else
-      imax = ihalf;
-  }
-
-// So array[imin] just <= value
-
-  if(mode == 0)
-    *f = (value - array[imin]) / (array[imax] - array[imin]); //linear interpolation
-  else if(mode == 1)
-    *f = (log(value) - log(array[imin])) / (log(array[imax]) - log(array[imin])); //log interpolation
-  else
-  {
-    logfile("Fraction - unknown mode %i\n", mode);
-    exit(0);
-    return (0);
-  }
-
-  *ival = imin;
+  *ival = -1;
 
-  return (0);
+  return fraction_cursor(value, array, npts, ival, f, mode);
 }
 
 /**********************************************************/
@@ -195,11 +145,183 @@ linterp(x, xarray, yarray, xdim, y, mode)
      double *y;
      int mode;                  //0 = linear, 1 = log
 {
-  int nelem = 0;
-  double frac;
+  int nelem = -1;
+
+  return linterp_cursor(x, xarray, yarray, xdim, y, mode, &nelem);
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Find the points of an array either side of a value, starting from
+ *         the points found last time
+ *
+ * @param[in]  value  The value to find
+ * @param[in]  array  The array, in ascending order
+ * @param[in]  npts   The number of points in the array
+ * @param[in]  hint   The lower point found last time, or -1 if there is none
+ *
+ * @return  The lower point imin, where array[imin] < value <= array[imin + 1],
+ *          or 0 if value is array[0]
+ *
+ * @details
+ *
+ * The value has to be between the first and last points of the array. If
+ * the value is not between the points given by hint, the search gallops away
+ * from hint in steps of 1, 2, 4, ... points until the value is passed, and
+ * then bisects the last step. A sequence of values which is in order is
+ * therefore found in constant time per value, and the worst case is twice the
+ * cost of bisecting the whole array. The point found is always the same as
+ * the bisection in fraction would find.
+ *
+ * ************************************************************************** */
+
+static int
+locate_bracket(double value, double array[], int npts, int hint)
+{
+  int imin, imax, ihalf;
+  int step;
+
+  if(hint < 0 || hint > npts - 2)
+  {
+    imin = 0;
+    imax = npts - 1;
+  }
+  else if(value > array[hint + 1])
+  {
+    imin = hint + 1;
+    imax = imin + 1;
+    for(step = 2; imax < npts - 1 && value > array[imax]; step *= 2)
+    {
+      imin = imax;
+      imax = imin + step;
+    }
+    if(imax > npts - 1)
+      imax = npts - 1;
+  }
+  else if(hint > 0 && value <= array[hint])
+  {
+    imax = hint;
+    imin = imax - 1;
+    for(step = 2; imin > 0 && value <= array[imin]; step *= 2)
+    {
+      imax = imin;
+      imin = imax - step;
+    }
+    if(imin < 0)
+      imin = 0;
+  }
+  else
+  {
+    return hint;
+  }
+
+  while(imax - imin > 1)
+  {
+    ihalf = (imin + imax) >> 1;
+    if(value > array[ihalf])
+      imin = ihalf;
+    else
+      imax = ihalf;
+  }
+
+  return imin;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Calculate the fractional position of a value in an array, starting
+ *         the search from the position found last time
+ *
+ * @param[in]      value  The value to find
+ * @param[in]      array  The array, in ascending order
+ * @param[in]      npts   The number of points in the array
+ * @param[in, out] ival   On input, the lower point found last time or -1 if
+ *                        there is none. On output, the lower point
+ * @param[out]     f      The fractional distance from the lower point to the
+ *                        next point
+ * @param[in]      mode   0 to compute in linear space, or 1 for log space
+ *
+ * @return  -1 if the value is below the array, 1 if it is above the array, or
+ *          0 otherwise
+ *
+ * @details
+ *
+ * This gives exactly the same results as fraction. Keeping ival between calls
+ * for the same array means the search is quick when the values are in order,
+ * such as when going through a grid of temperatures or frequencies.
+ *
+ * ************************************************************************** */
+
+int
+fraction_cursor(double value, double array[], int npts, int *ival, double *f, int mode)
+{
+  int imin, imax;
+
+  if(value < array[0])
+  {
+    *ival = 0;
+    *f = 0.0;
+    return (-1);
+  }
+
+  if(value > array[npts - 1])
+  {
+    *ival = npts - 2;
+    *f = 1.0;
+    return (1);
+  }
+
+  /* When the value is on a point of the array, the point below it is found and
+     the fraction is 1. This reflects the behaviour of where_in_grid in Python */
+  imin = locate_bracket(value, array, npts, *ival);
+  imax = imin + 1 < npts ? imin + 1 : imin;
+
+  if(mode == 0)
+    *f = (value - array[imin]) / (array[imax] - array[imin]); //linear interpolation
+  else if(mode == 1)
+    *f = (log(value) - log(array[imin])) / (log(array[imax]) - log(array[imin])); //log interpolation
+  else
+  {
+    logfile("Fraction - unknown mode %i\n", mode);
+    exit(0);
+    return (0);
+  }
+
+  *ival = imin;
+
+  return (0);
+}
 
+/* ************************************************************************** */
+/**
+ * @brief  Perform a linear or logarithmic interpolation on two parallel
+ *         arrays, starting the search from the position found last time
+ *
+ * @param[in]      x       The value to interpolate at
+ * @param[in]      xarray  The array which is interpolated, in ascending order
+ * @param[in]      yarray  The function at each value in xarray
+ * @param[in]      xdim    The length of the two arrays
+ * @param[out]     y       The interpolated value
+ * @param[in]      mode    0 for linear, or 1 for logarithmic, interpolation
+ * @param[in, out] cursor  The lower point used last time, or -1 if there is
+ *                         none. This is updated to the lower point used
+ *
+ * @return  The lower point used for the interpolation
+ *
+ * @details
+ *
+ * This gives exactly the same results as linterp, see fraction_cursor.
+ *
+ * ************************************************************************** */
+
+int
+linterp_cursor(double x, double xarray[], double yarray[], int xdim, double *y, int mode, int *cursor)
+{
+  int nelem;
+  double frac;
 
-  fraction(x, xarray, xdim, &nelem, &frac, mode);
+  fraction_cursor(x, xarray, xdim, cursor, &frac, mode);
+  nelem = *cursor;
 
   if(mode == 0)
     *y = (1. - frac) * yarray[nelem] + frac * yarray[nelem + 1];
@@ -212,7 +334,6 @@ linterp(x, xarray, yarray, xdim, y, mode)
   }
 
   return (nelem);
-
 }
 
 /**********************************************************/
@@ -220,11 +341,13 @@ linterp(x, xarray, yarray, xdim, y, mode)
  * @brief      Index the topbase photoionzation crossections by frequency
  *
  *
- * @return     Always returns 0
+ * @return     0 on success, or ATOMIC_MEMORY_ISSUE_ERROR if phot_top_ptr could
+ *             not be allocated
  *
  * @details
  *
- * The results are stored in phot_top_ptr
+ * The results are stored in phot_top_ptr. Cross sections with the same
+ * threshold frequency are ordered by element, ion and then level.
  *
  * ### Notes ###
  * Adapted from index_lines as part to topbase
@@ -235,37 +358,36 @@ linterp(x, xarray, yarray, xdim, y, mode)
 int
 index_phot_top()
 {
-  float *freqs, foo;
-  int *index, ioo;
   int n;
-  void indexx();
+  SortKey_t *keys;
 
-  /* Allocate memory for some modestly large arrays */
-  freqs = calloc(sizeof(foo), ntop_phot + nxphot + 2);
-  index = calloc(sizeof(ioo), ntop_phot + nxphot + 2);
+  if(reserve_atomic_table(TABLE_PHOT_TOP_PTR, ntop_phot + nxphot))
+    return ATOMIC_MEMORY_ISSUE_ERROR;
+  if((keys = malloc((ntop_phot + nxphot) * sizeof(*keys))) == NULL)
+    return ATOMIC_MEMORY_ISSUE_ERROR;
 
-  freqs[0] = 0;
   for(n = 0; n < ntop_phot + nxphot; n++)
-    freqs[n + 1] = phot_top[n].freq[0]; /* So filled matrix
-                                           elements run from 1 to ntop_phot */
-
-  indexx(ntop_phot + nxphot, freqs, index); /* Note that this math recipes routine
-                                               expects arrays to run from 1 to nlines inclusive */
+  {
+    keys[n].freq = phot_top[n].freq[0];
+    keys[n].z = phot_top[n].z;
+    keys[n].istate = phot_top[n].istate;
+    keys[n].lower = phot_top[n].nlev;
+    keys[n].upper = phot_top[n].uplev;
+    keys[n].id = n;
+  }
 
-  /* The for loop indices are complicated by the numerical recipes routine,
-     which is a simple translation of a fortran routine.
-     Specifically, index array elements 1 to nlines are now filled,
-     and the numbers run from 1 to nlines, but the
-     pointer array is only filled from elements 0 to nlines -1 */
+  if(sort_by_frequency(keys, ntop_phot + nxphot))
+  {
+    free(keys);
+    return ATOMIC_MEMORY_ISSUE_ERROR;
+  }
 
   for(n = 0; n < ntop_phot + nxphot; n++)
   {
-    phot_top_ptr[n] = &phot_top[index[n + 1] - 1];
+    phot_top_ptr[n] = &phot_top[keys[n].id];
   }
 
-  /* Free the memory for the arrays */
-  free(freqs);
-  free(index);
+  free(keys);
 
   return (0);
 
@@ -276,130 +398,54 @@ index_phot_top()
 /**
  * @brief      Index inner shell xsections in frequency order
  *
- * @return     Alwasy returns 0
+ * @return     0 on success, or ATOMIC_MEMORY_ISSUE_ERROR if inner_cross_ptr
+ *             could not be allocated
  *
  * @details
- * The rusults are stored in inner_cross_ptr
- *
- * ### Notes ###
- * ??? NOTES ???
+ * The rusults are stored in inner_cross_ptr. Cross sections with the same
+ * threshold frequency are ordered by element, ion and then shell.
  *
  **********************************************************/
 
 int
 index_inner_cross()
 {
-  float *freqs, foo;
-  int *index, ioo;
   int n;
-  void indexx();
+  SortKey_t *keys;
 
-  /* Allocate memory for some modestly large arrays */
-  freqs = calloc(sizeof(foo), n_inner_tot + 2);
-  index = calloc(sizeof(ioo), n_inner_tot + 2);
+  if(reserve_atomic_table(TABLE_INNER_CROSS_PTR, n_inner_tot))
+    return ATOMIC_MEMORY_ISSUE_ERROR;
+  if((keys = malloc(n_inner_tot * sizeof(*keys))) == NULL)
+    return ATOMIC_MEMORY_ISSUE_ERROR;
 
-  freqs[0] = 0;
   for(n = 0; n < n_inner_tot; n++)
-    freqs[n + 1] = inner_cross[n].freq[0];  /* So filled matrix
-                                               elements run from 1 to ntop_phot */
-
-  indexx(n_inner_tot, freqs, index);  /* Note that this math recipes routine
-                                         expects arrays to run from 1 to nlines inclusive */
+  {
+    keys[n].freq = inner_cross[n].freq[0];
+    keys[n].z = inner_cross[n].z;
+    keys[n].istate = inner_cross[n].istate;
+    keys[n].lower = inner_cross[n].n;
+    keys[n].upper = inner_cross[n].l;
+    keys[n].id = n;
+  }
 
-  /* The for loop indices are complicated by the numerical recipes routine,
-     which is a simple translation of a fortran routine.
-     Specifically, index array elements 1 to nlines are now filled,
-     and the numbers run from 1 to nlines, but the
-     pointer array is only filled from elements 0 to nlines -1 */
+  if(sort_by_frequency(keys, n_inner_tot))
+  {
+    free(keys);
+    return ATOMIC_MEMORY_ISSUE_ERROR;
+  }
 
   for(n = 0; n < n_inner_tot; n++)
   {
-    inner_cross_ptr[n] = &inner_cross[index[n + 1] - 1];
+    inner_cross_ptr[n] = &inner_cross[keys[n].id];
   }
 
-  /* Free the memory for the arrays */
-  free(freqs);
-  free(index);
+  free(keys);
 
   return (0);
 
 }
 
 
-/* Numerical recipes routine used by index_lines which in turn is used by get_atomic_data */
-
-
-/**********************************************************/
-/**
- * @brief      Numerical recipes routine used by various routines to sort the atomic data
- *
- * @param [in] int  n   The dimension of the array that needs sorting
- * @param [in] float  arrin[]   The array to sort
- * @param [out] int  indx[]   The array that contains poionters to the sorted array
- * @return     N/A
- *
- * @details
- *
- * ### Notes ###
- * See nuerical recipes
- *
- * @bug Should probably replaces this with the equivalent gsl routine
- *
- **********************************************************/
-
-void
-indexx(n, arrin, indx)
-     int n, indx[];
-     float arrin[];
-{
-  int l, j, ir, indxt, i;
-  float q;
-/* NSH 1408 - This routine fails in the very odd circumstance that n=1 so we now do a little test here */
-  if(n < 2)
-  {
-    logfile("Nothing for indexx to do! Only one element\n");
-    indx[0] = 0;
-    indx[1] = 1;                /* NSH 1707 - We still need to populate the array */
-    return;
-  }
-
-  for(j = 1; j <= n; j++)
-    indx[j] = j;
-  l = (n >> 1) + 1;
-  ir = n;
-  for(;;)
-  {
-    if(l > 1)
-      q = arrin[(indxt = indx[--l])];
-    else
-    {
-      q = arrin[(indxt = indx[ir])];
-      indx[ir] = indx[1];
-      if(--ir == 1)
-      {
-        indx[1] = indxt;
-        return;
-      }
-    }
-    i = l;
-    j = l << 1;
-    while(j <= ir)
-    {
-      if(j < ir && arrin[indx[j]] < arrin[indx[j + 1]])
-        j++;
-      if(q < arrin[indx[j]])
-      {
-        indx[i] = indx[j];
-        j += (i = j);
-      }
-      else
-        j = ir + 1;
-    }
-    indx[i] = indxt;
-  }
-}
-
-
 
 
 /**********************************************************/
@@ -451,7 +497,7 @@ limit_lines(freqmin, freqmax)
   double f;
 
 
-  if(freqmin > lin_ptr[nlines - 1]->freq || freqmax < lin_ptr[0]->freq)
+  if(freqmin > get_line_freq(nlines - 1) || freqmax < get_line_freq(0))
   {
     nline_min = 0;
     nline_max = 0;
@@ -467,9 +513,9 @@ limit_lines(freqmin, freqmax)
 
   while(n != nmin)
   {
-    if(lin_ptr[n]->freq < f)
+    if(get_line_freq(n) < f)
       nmin = n;
-    if(lin_ptr[n]->freq >= f)
+    if(get_line_freq(n) >= f)
       nmax = n;
     n = (nmin + nmax) >> 1;     // Compute a midpoint >> is a bitwise right shift
   }
@@ -483,9 +529,9 @@ limit_lines(freqmin, freqmax)
 
   while(n != nmin)
   {
-    if(lin_ptr[n]->freq <= f)
+    if(get_line_freq(n) <= f)
       nmin = n;
-    if(lin_ptr[n]->freq > f)
+    if(get_line_freq(n) > f)
       nmax = n;
     n = (nmin + nmax) >> 1;     // Compute a midpoint >> is a bitwise right shift
   }
@@ -496,6 +542,94 @@ limit_lines(freqmin, freqmax)
   return (nline_delt = nline_max - nline_min + 1);
 }
 
+/**********************************************************/
+/**
+ * @brief      copy the threshold frequencies of the frequency ordered edges
+ *             into phot_top_threshold and inner_cross_threshold
+ *
+ * @return     0 on success, or ATOMIC_MEMORY_ISSUE_ERROR if the thresholds
+ *             could not be allocated
+ *
+ * @details
+ * This has to be done whenever the order of the edges is set, i.e. after
+ * index_phot_top and index_inner_cross. The thresholds are saved in the
+ * snapshot in the cache, so are not found again when the atomic data is read
+ * from there.
+ *
+ **********************************************************/
+
+int
+index_edge_thresholds(void)
+{
+  int n;
+
+  if(reserve_atomic_table(TABLE_PHOT_TOP_THRESHOLD, nphot_total + 1)
+     || reserve_atomic_table(TABLE_INNER_CROSS_THRESHOLD, n_inner_tot + 1))
+    return ATOMIC_MEMORY_ISSUE_ERROR;
+
+  for(n = 0; n < nphot_total; n++)
+    phot_top_threshold[n] = phot_top_ptr[n]->freq[0];
+  for(n = 0; n < n_inner_tot; n++)
+    inner_cross_threshold[n] = inner_cross_ptr[n]->freq[0];
+
+  return (0);
+}
+
+/**********************************************************/
+/**
+ * @brief      find the edges with a threshold frequency between freqmin and
+ *             freqmax
+ *
+ * @param [in] double *  threshold  The frequency ordered thresholds, i.e.
+ *                                  phot_top_threshold or inner_cross_threshold
+ * @param [in] int       nedges     The number of thresholds
+ * @param [in] double    freqmin    The minimum frequency we are interested in
+ * @param [in] double    freqmax    The maximum frequency we are interested in
+ * @param [out] int *    nfirst     The position of the first edge in range
+ *
+ * @return     The number of edges with freqmin < threshold < freqmax
+ *
+ * @details
+ * The edges in range are nfirst to nfirst + the number of edges - 1 of
+ * phot_top_ptr or inner_cross_ptr. As in limit_lines, the ends of the range
+ * are found by bisection.
+ *
+ **********************************************************/
+
+int
+limit_edges(double *threshold, int nedges, double freqmin, double freqmax, int *nfirst)
+{
+  int nmin, nmax, n;
+  int nlast;
+
+  /* Find the first threshold > freqmin */
+  nmin = 0;
+  nmax = nedges;
+  while(nmin < nmax)
+  {
+    n = (nmin + nmax) >> 1;
+    if(threshold[n] > freqmin)
+      nmax = n;
+    else
+      nmin = n + 1;
+  }
+  *nfirst = nmin;
+
+  /* Find the first threshold >= freqmax */
+  nmax = nedges;
+  while(nmin < nmax)
+  {
+    n = (nmin + nmax) >> 1;
+    if(threshold[n] >= freqmax)
+      nmax = n;
+    else
+      nmin = n + 1;
+  }
+  nlast = nmin;
+
+  return nlast - *nfirst;
+}
+
 
 
 
@@ -558,165 +692,41 @@ check_xsections()
 
 
 /*
-
-   q21 calculates and returns the collisional de-excitation coefficient q21
-
-   Notes:  This uses a simple approximation for the effective_collision_strength omega.
-   ?? I am not sure where this came from at present and am indeed no sure that
-   omega is omega(2->1) as it should be.  This should be carefully checked.??
-   This has no been improved, and wherever possible we use tabulated collision
-   stength data from Chianti (after Burgess and Tully 1992)
-
-   c21=n_e * q21
-   q12 = g_2/g_1 q21 exp(-h nu / kT )
-
+   a21 alculates and returns the Einstein A coefficient
    History:
-   98aug        ksl     Recoded from other routines so that one always calculates q21 in
-			the same way.
-	01nov	ksl	Add tracking mechanism so if called with same conditions it
-			returns without recalculation
-	12oct	nsh	Added, then commented out approximate gaunt factor given in
-			hazy 2.
-	17jan	nsh Added code to use the actual collision strength date from chianti
-
+   98aug        ksl     Coded and add_error_to_logged
+   99jan        ksl Modified so would shortcircuit calculation if
+   called multiple times for same a
  */
-
-
-/// (8*PI)/(sqrt(3) *nu_1Rydberg
-#define ECS_CONSTANT 4.773691e16
-
-struct lines *q21_line_ptr;
-double q21_a, q21_t_old;
+#define A21_CONSTANT 7.429297e-22 // 8 * PI * PI * E * E / (MELEC * C * C * C)
+#define B21_CONSTANT (C * C / (2 * H))
 
 
 /**********************************************************/
 /**
- * @brief      calculates and returns the collisional de-excitation coefficient q21
+ * @brief      Calculate the Einstein A coefficient for aline
  *
- * @param [in] struct lines *  line_ptr   A single line
- * @param [in] double  t   The temperature at wich to calculate the coefficient
- * @return    The collisional de-excitiation coefficient
- *
- * @details
- * This routine uses stored coefficients if we have them, or the Van Regemortor
- * approximation if we do not.
- *
- * ### Notes ###
- * the relevant paper to consult here is Van Regemorter 1962. We use an effective gaunt
- * factor to calculate collision strengths. There is one regime in which kt < hnu. For that
- * consult equation 4.20 and 4.21 of Hazy.
-************************************************************/
-
-/*
-double
-q21 (struct lines *line_ptr, double t)
-{
-  double gaunt;
-  double omega;
-  double u0;
-
-
-  if (q21_line_ptr != line_ptr || t != q21_t_old)
-  {
-
-
-    u0 = (BOLTZMANN * t) / (H * line_ptr->freq);
-
-    if (line_ptr->istate == 1 && u0 < 2)        // neutrals at low energy. Used 2 to give continuous function.
-      gaunt = u0 / 10.0;
-    else                        // low energy electrons, positive ions
-      gaunt = 0.2;
-
-
-
-    if (line_ptr->coll_index < 0)       //if we do not have a collision strength for this line use the g-bar formulation
-    {
-      omega = ECS_CONSTANT * line_ptr->gl * gaunt * line_ptr->f / line_ptr->freq;
-    }
-    else                        //otherwise use the collision strength directly. NB what we call omega, most people including hazy call upsilon.
-    {
-      omega = upsilon (line_ptr->coll_index, u0);
-    }
-
-
-    q21_a = 8.629e-6 / (sqrt (t) * line_ptr->gu) * omega;
-    q21_t_old = t;
-  }
-
-  return (q21_a);
-}
-*/
-
-/**********************************************************/
-/**
- * @brief      Calculate the collisional excitation coefficient for a line
- *
- * @param [in] struct lines *  line_ptr   The line of interest
- * @param [in] double  t   The temperature of interest
- * @return     The collisional excitation coeffient
- *
- * @details
- * The routine calls q21 and uses detailed balance to derive q12
- *
- * ### Notes ###
- *
- **********************************************************/
-
-/*
-double
-q12 (struct lines *line_ptr, double t)
-{
-  double x;
-  double exp ();
-
-  x = line_ptr->gu / line_ptr->gl * q21 (line_ptr, t) * exp (-H_OVER_K * line_ptr->freq / t);
-
-  return (x);
-}
-*/
-
-
-/*
-   a21 alculates and returns the Einstein A coefficient
-   History:
-   98aug        ksl     Coded and add_error_to_logged
-   99jan        ksl Modified so would shortcircuit calculation if
-   called multiple times for same a
- */
-#define A21_CONSTANT 7.429297e-22 // 8 * PI * PI * E * E / (MELEC * C * C * C)
-
-struct lines *a21_line_ptr;
-double a21_a;
-
-
-/**********************************************************/
-/**
- * @brief      Calculate the Einstein A coefficient for aline
- *
- * @param [in out] struct lines *  line_ptr   The structure that describes a single line
- * @return     The Einstein A coefficient
+ * @param [in] struct lines *  line_ptr   The structure that describes a single line
+ * @return     The Einstein A coefficient
  *
  * @details
  * Using the oscillator strecnth and the multiplicity (which are
  * read in) calculate A
  *
  * ### Notes ###
+ * This used to remember the last line it was called for, which did not help
+ * when callers alternated between lines. The coefficients for the lines in
+ * frequency order are in line_columns.a21, which should be used instead
+ * where possible.
  *
  **********************************************************/
 
 double
 a21(struct lines *line_ptr)
 {
-  double freq;
-
-  if(a21_line_ptr != line_ptr)
-  {
-    freq = line_ptr->freq;
-    a21_a = A21_CONSTANT * line_ptr->gl / line_ptr->gu * freq * freq * line_ptr->f;
-    a21_line_ptr = line_ptr;
-  }
+  double freq = line_ptr->freq;
 
-  return (a21_a);
+  return A21_CONSTANT * line_ptr->gl / line_ptr->gu * freq * freq * line_ptr->f;
 }
 
 
@@ -726,12 +736,14 @@ a21(struct lines *line_ptr)
  *
  * @param [in out] int  n_coll   the index of the collision strength record we are working with
  * @param [in out] double  u0  - kT_e/hnu - where nu is the transition frequency for the line of interest and T_e is the electron temperature
- * @return     upsilon - the thermally averaged collision strength for a given line at a given temp
+ * @return     upsilon - the thermally averaged collision strength for a given line at a given temp,
+ * or -1 if the fit has an unknown type
  *
  * @details
  *
  * ### Notes ###
- * It uses data extracted from Chianti stored in coll_stren.
+ * It uses data extracted from Chianti stored in coll_stren. To evaluate the
+ * collision strength over a grid of temperatures, use evaluate_collision_rates.
  * The paper to consult is Burgess and Tully A&A 254,436 (1992).
  * u0 is the ratio of Boltzmans constant times the electron temperature in the cell
  * divided by Plancks constant times the frequency of the line under analysis.
@@ -761,8 +773,8 @@ upsilon(n_coll, u0)
   }
   else
   {
-    logfile("upsilon - coll_stren %i has no type %g\n", coll_stren[n_coll].type);
-    exit(0);
+    logfile("upsilon - coll_stren %i has unknown type %i\n", n_coll, coll_stren[n_coll].type);
+    return (-1.0);
   }
 
 
@@ -791,8 +803,8 @@ upsilon(n_coll, u0)
   }
   else
   {
-    logfile("upsilon - coll_stren %i has no type %g\n", coll_stren[n_coll].type);
-    exit(0);
+    logfile("upsilon - coll_stren %i has unknown type %i\n", n_coll, coll_stren[n_coll].type);
+    return (-1.0);
   }
   return (upsilon);
 }
@@ -801,122 +813,635 @@ upsilon(n_coll, u0)
 /**
  * @brief      sort the lines into frequency order
  *
- * @return     Always returns 0
+ * @return     0 on success, or ATOMIC_MEMORY_ISSUE_ERROR if lin_ptr could not
+ *             be allocated
  *
  * @details
+ * Lines with the same frequency are ordered by element, ion and then the
+ * lower and upper levels, so the order of the lines is always the same.
  *
- * ### Notes ###
- * All use a Numerical recipes routine indexx for this
+ * A streamed line list is sorted in exactly the same way, so the lines are
+ * in the same order whichever way they were read in.
  *
  **********************************************************/
 
 int
 index_lines()
 {
-  float *freqs, foo;
-  int *index, ioo;
   int n;
-  void indexx();
+  SortKey_t *keys;
 
-  /* Allocate memory for some modestly large arrays */
-  freqs = calloc(sizeof(foo), NLINES + 2);
-  index = calloc(sizeof(ioo), NLINES + 2);
+  if(reserve_atomic_table(AtomixConfiguration.lines_streamed ? TABLE_LINE_INDEX_PTR : TABLE_LIN_PTR, nlines))
+    return ATOMIC_MEMORY_ISSUE_ERROR;
+  if((keys = malloc((nlines + 1) * sizeof(*keys))) == NULL)
+    return ATOMIC_MEMORY_ISSUE_ERROR;
 
-  freqs[0] = 0;
   for(n = 0; n < nlines; n++)
-    freqs[n + 1] = line[n].freq;  /* So filled matrix
-                                     elements run from 1 to nlines */
-
-  indexx(nlines, freqs, index); /* Note that this math recipes routine
-                                   expects arrays to run from 1 to nlines inclusive */
+  {
+    if(AtomixConfiguration.lines_streamed)
+    {
+      keys[n].freq = line_index[n].freq;
+      keys[n].z = ions[line_index[n].nion].z;
+      keys[n].istate = ions[line_index[n].nion].istate;
+      keys[n].lower = line_index[n].levl;
+      keys[n].upper = line_index[n].levu;
+    }
+    else
+    {
+      keys[n].freq = line[n].freq;
+      keys[n].z = line[n].z;
+      keys[n].istate = line[n].istate;
+      keys[n].lower = line[n].levl;
+      keys[n].upper = line[n].levu;
+    }
+    keys[n].id = n;
+  }
 
-  /* The for loop indices are complicated by the numerical recipes routine,
-     which is a simple translation of a fortran routine.
-     Specifically, index array elements 1 to nlines are now filled,
-     and the numbers run from 1 to nlines, but the
-     pointer array is only filled from elements 0 to nlines -1 */
+  if(sort_by_frequency(keys, nlines))
+  {
+    free(keys);
+    return ATOMIC_MEMORY_ISSUE_ERROR;
+  }
 
   /* SS - adding quantity "where_in_list" to line structure so that it is easy to from emission
      in recombination line to correct place in line list. */
 
+  for(n = 0; n < nlines; n++)
+  {
+    if(AtomixConfiguration.lines_streamed)
+    {
+      line_index_ptr[n] = &line_index[keys[n].id];
+    }
+    else
+    {
+      lin_ptr[n] = &line[keys[n].id];
+      line[keys[n].id].where_in_list = n;
+    }
+  }
+
+  free(keys);
+
+  return index_line_columns();
+}
+
+/**********************************************************/
+/**
+ * @brief      split the frequency ordered lines into columns
+ *
+ * @return     0 on success, or ATOMIC_MEMORY_ISSUE_ERROR if the columns could
+ *             not be allocated
+ *
+ * @details
+ * The frequency, element, ion and index of each line are copied out of
+ * lin_ptr, or line_index_ptr for a streamed line list, into line_columns.
+ * This has to be done whenever the order of the lines is set, i.e. by
+ * index_lines. The columns are saved in the snapshot in the cache, so are not
+ * made again when the atomic data is read from there. The radiative rates of
+ * the lines are then calculated by index_line_rates.
+ *
+ **********************************************************/
+
+int
+index_line_columns(void)
+{
+  int n;
+
+  if(reserve_atomic_table(TABLE_LINE_FREQ, nlines) || reserve_atomic_table(TABLE_LINE_Z, nlines)
+     || reserve_atomic_table(TABLE_LINE_ISTATE, nlines) || reserve_atomic_table(TABLE_LINE_NION, nlines)
+     || reserve_atomic_table(TABLE_LINE_ID, nlines) || reserve_atomic_table(TABLE_LINE_A21, nlines)
+     || reserve_atomic_table(TABLE_LINE_B12, nlines) || reserve_atomic_table(TABLE_LINE_B21, nlines)
+     || reserve_atomic_table(TABLE_LINE_LIFETIME, nlines))
+    return ATOMIC_MEMORY_ISSUE_ERROR;
 
+  /* The statistical weights and oscillator strength are put in the rate columns, until the rates are calculated */
   for(n = 0; n < nlines; n++)
   {
-    lin_ptr[n] = &line[index[n + 1] - 1];
-    line[index[n + 1] - 1].where_in_list = n;
+    if(AtomixConfiguration.lines_streamed)
+    {
+      line_columns.freq[n] = line_index_ptr[n]->freq;
+      line_columns.nion[n] = line_index_ptr[n]->nion;
+      line_columns.id[n] = line_index_ptr[n] - line_index;
+      line_columns.b12[n] = line_index_ptr[n]->gl;
+      line_columns.b21[n] = line_index_ptr[n]->gu;
+      line_columns.a21[n] = line_index_ptr[n]->f;
+    }
+    else
+    {
+      line_columns.freq[n] = lin_ptr[n]->freq;
+      line_columns.nion[n] = lin_ptr[n]->nion;
+      line_columns.id[n] = lin_ptr[n] - line;
+      line_columns.b12[n] = lin_ptr[n]->gl;
+      line_columns.b21[n] = lin_ptr[n]->gu;
+      line_columns.a21[n] = lin_ptr[n]->f;
+    }
+    line_columns.z[n] = ions[line_columns.nion[n]].z;
+    line_columns.istate[n] = ions[line_columns.nion[n]].istate;
   }
 
-  /* Free the memory for the arrays */
-  free(freqs);
-  free(index);
+  return index_line_rates();
+}
+
+/**********************************************************/
+/**
+ * @brief      calculate the radiative rates of the frequency ordered lines
+ *
+ * @return     0 on success, or ATOMIC_MEMORY_ISSUE_ERROR if there was not
+ *             enough memory
+ *
+ * @details
+ * This is called by index_line_columns, with the lower and upper statistical
+ * weights in line_columns.b12 and b21 and the oscillator strength in a21.
+ * These are replaced by the Einstein coefficients in one pass over the
+ * columns. A21 is the same as a21 gives,
+ *
+ * B21 = A21 c^2 / (2 h nu^3) and B12 = gu / gl B21.
+ *
+ * The lifetime of the upper level of a line is one over the sum of A21 for
+ * all of the lines from that level. It is zero if the level is not in the
+ * atomic data. For simple ions, the sum is also added to rad_rate of the
+ * upper level in config. The columns are kept in the snapshot in the cache,
+ * along with config, so this is not called when the atomic data is loaded
+ * from there.
+ *
+ **********************************************************/
+
+int
+index_line_rates(void)
+{
+  int n;
+  int levu;
+  int *upper;
+  double gl, gu, freq;
+  double *total;
+
+  upper = malloc(nlines * sizeof(*upper) + sizeof(*upper));
+  total = calloc(nlevels + 1, sizeof(*total));
+  if(upper == NULL || total == NULL)
+  {
+    free(upper);
+    free(total);
+    return ATOMIC_MEMORY_ISSUE_ERROR;
+  }
+
+  /* Find the upper level of each line the same way as match_line_to_levels, so that rad_rate and the lifetime are
+     for the level in nconfigu */
+  for(n = 0; n < nlines; n++)
+  {
+    levu = AtomixConfiguration.lines_streamed ? line_index[line_columns.id[n]].levu : line[line_columns.id[n]].levu;
+    upper[n] = find_ion_level(line_columns.nion[n], levu);
+  }
+
+  for(n = 0; n < nlines; n++)
+  {
+    gl = line_columns.b12[n];
+    gu = line_columns.b21[n];
+    freq = line_columns.freq[n];
+    line_columns.a21[n] = A21_CONSTANT * gl / gu * freq * freq * line_columns.a21[n];
+    line_columns.b21[n] = line_columns.a21[n] * B21_CONSTANT / (freq * freq * freq);
+    line_columns.b12[n] = gu / gl * line_columns.b21[n];
+  }
+
+  for(n = 0; n < nlines; n++)
+    if(upper[n] >= 0)
+      total[upper[n]] += line_columns.a21[n];
+
+  /* The levels of macro atoms have their radiative rates in the level data, so only the lines of simple ions are
+     added to rad_rate */
+  for(n = 0; n < nlines; n++)
+    if(upper[n] >= 0 && ions[line_columns.nion[n]].macro_info == 0)
+      config[upper[n]].rad_rate += line_columns.a21[n];
+
+  for(n = 0; n < nlines; n++)
+    line_columns.lifetime[n] = upper[n] >= 0 && total[upper[n]] > 0 ? 1.0 / total[upper[n]] : 0.0;
+
+  free(upper);
+  free(total);
 
   return (0);
 }
 
 /**********************************************************/
 /**
- * @brief      generalized subroutine for reading atomic data
- *  	into a set of structures defined in "atomic.h"
+ * @brief      Read the data for a line from a Line or LinMacro record
  *
+ * @param[in]  char *   aline  The record
+ * @param[out] LinePtr  l      The line read from the record
  *
- * @param [in] char  masterfile[]   The name of the "masterfile" which refers to other files which contain the data
- * @return     Always returns 0
+ * @return     The number of values read from the record
  *
  * @details
+ * The formats of the records are described in get_atomic_data. If 6, 8 or
+ * 10 values were read, the element, ion, frequency, oscillator strength,
+ * statistical weights, energies and level numbers of the line are filled in,
+ * along with macro_info which is 1 for a LinMacro record and 0 otherwise.
+ * The members which depend on the rest of the atomic data are not changed.
  *
- * get_atomic_data reads in all the atomic data.  It also converts the data to cgs units unless
- * 	otherwise noted, e.g ionization potentials are converted to ergs.
+ * This is used both when the atomic data is read in and when a streamed line
+ * is decoded, so a streamed line is exactly the same as it would have been if
+ * the whole line list was read in.
  *
+ **********************************************************/
+
+int
+scan_line_record(char *aline, LinePtr l)
+{
+  int nwords;
+  int z, istate, levl, levu;
+  double freq, f, gl, gu, el, eu;
+
+  if(strncmp(skip_whitespace(aline), "LinMacro", 8) == 0)
+  {
+    l->macro_info = 1;
+    nwords = scan_atomic_record(aline, "%*s %d %d %le %le %le %le %le %le %d %d", &z, &istate, &freq, &f, &gl, &gu, &el,
+                                &eu, &levl, &levu);
+  }
+  else
+  {
+    l->macro_info = 0;
+    nwords = scan_atomic_record(aline, "%*s %d %2d %le %le %le %le %le %le %d %d", &z, &istate, &freq, &f, &gl, &gu, &el,
+                                &eu, &levl, &levu);
+  }
+
+  if(nwords == 6)
+  {
+    el = 0.0;
+    eu = H * C / (freq * 1e-8); // Convert Angstroms to ergs
+    levl = -1;
+    levu = -1;
+  }
+  else if(nwords == 8)
+  {                             // Then the file contains the energy levels of the transitions
+    el = EV2ERGS * el;
+    eu = EV2ERGS * eu;
+    levl = -1;
+    levu = -1;
+  }
+  else if(nwords == 10)
+  {                             // Then the file contains energy levels and level numbers
+    el = EV2ERGS * el;
+    eu = EV2ERGS * eu;
+  }
+  else
+  {
+    return nwords;
+  }
+
+  l->z = z;
+  l->istate = istate;
+  l->freq = C / (freq * 1e-8);  /* convert Angstroms to frequency */
+  l->f = f;
+  l->gl = gl;
+  l->gu = gu;
+  l->levl = levl;
+  l->levu = levu;
+  l->el = el;
+  l->eu = eu;
+
+  return nwords;
+}
+
+/**********************************************************/
+/**
+ * @brief      Find a level of an ion in config
  *
+ * @param[in]  int  nion  The ion
+ * @param[in]  int  ilv   The number of the level within the ion
  *
- * The masterfile is a list of other files, which contain atomic data for specific puruposes.
+ * @return     The index of the level in config, or -1 if the ion has no such
+ *             level
  *
- * All of the files are ascii.  The information is keyword based.
+ * @details
+ * The levels of an ion are not always next to each other in config, so the
+ * search starts at the first level of the ion and skips the levels of other
+ * ions until all of the levels of the ion have been seen.
  *
- * The order of the data is important.  Elements should be defined before ions; ions
- * before levels, levels before  lines etc.  In most if not all cases, one can either define all
- * of the elements first, all of the ions, etc ... or the first element and its ions, the
- * second element and its ions etc. Commenting out an element in the datafile has the effect of
- * eliminating all of the data associated with that element, e.g ions, lines, etc.
+ **********************************************************/
+
+int
+find_ion_level(int nion, int ilv)
+{
+  int m, nseen;
+
+  nseen = 0;
+  for(m = ions[nion].firstlevel; m >= 0 && m < nlevels && nseen < ions[nion].nlevels; m++)
+  {
+    if(config[m].nion != nion)
+      continue;
+    if(config[m].ilv == ilv)
+      return m;
+    nseen++;
+  }
+
+  return -1;
+}
+
+/**********************************************************/
+/**
+ * @brief      Find the configurations of the levels of a line for a simple
+ *             atom
  *
- * The program assumes that the ions for a given element are grouped together,
- * that the levels for a given element are grouped together, etc.
+ * @param[in, out]  LinePtr  l  The line
  *
- * If one wants to read both Topbase and VFKY photoionization x-sections, then the topbase
- * x-sections should be read first.  The routine will ignore data in the VFKY list if there
- * is a pre-existing Topbase data.  The routine will stop if you but a VFKY x-section first
- * on the assumption that Topbase data should trump VFKY data. (Making the program more flexible
- * would be difficult because you would have to drop various bits of Topbase data out of the
- * middle of the structure or mark it NG or something.)
+ * @return     void
  *
- * Similarly, as a general rule the macro information should be provided before the simple
- * ions are described, and the macro lines should be presented before simple lines.
+ * @details
+ * nconfigl and nconfigu are set to -9999 if there is no level which matches
+ * the lower or upper level of the line. The data files for macro atoms
+ * already contain this information, so lines for macro atoms are left as
+ * they are.
  *
- * The only data which can be mixed up completely is the line array.
+ **********************************************************/
+
+void
+match_line_to_levels(LinePtr l)
+{
+  int m;
+
+  if(ions[l->nion].macro_info != 0)
+    return;
+
+  m = find_ion_level(l->nion, l->levl);
+  l->nconfigl = m >= 0 ? m : -9999;
+
+  m = find_ion_level(l->nion, l->levu);
+  l->nconfigu = m >= 0 ? m : -9999;
+}
+
+/**********************************************************/
+/**
+ * @brief      Point the freq and x arrays of a cross section at a block of
+ *             points in the cross section pool
  *
- * Finally, get_atomic_data creates a pointer array to  lines, which has the lines in
- * frequency ascending order.   This is actually done by a small subroutine index_lines
- * which in turn calls a Numerical Recipes routine.
+ * @param[in]  TopPhotPtr  xsection  The cross section to update
+ * @param[in]  int         offset    The index of the first point in the pool
  *
- * ### Notes ###
+ * @return     void
  *
- * get_atomic data is intended to be stand-alone, that is one should be able to use it for routines
- * other than Python, e.g for another routine intended to calculate the ionization state of
- * a plasma in collisional equilibrium.
+ **********************************************************/
+
+void
+attach_xsection_to_pool(TopPhotPtr xsection, int offset)
+{
+  xsection->offset = offset;
+  xsection->freq = &xsection_pool_freq[offset];
+  xsection->x = &xsection_pool_x[offset];
+}
+
+/**********************************************************/
+/**
+ * @brief      Reserve space at the end of the cross section pool
  *
- * To this end, the routines populate stuctures in atomic.h, which are not part of python.h, and
- * one should avoid calling routines like Exit(0) that are very python centric.  It's important
- * that future modifications to get_atomic_data maintain this independence.
+ * @param[in]  int  np  The number of points to make room for
+ *
+ * @return     The index of the first reserved point, or -1 if the pool could
+ *             not be grown
+ *
+ * @details
  *
+ * The reserved points are not counted as part of the pool until
+ * xsection_pool_npts is advanced past them, so a cross section which is read
+ * in but then ignored will have its points overwritten by the next one.
  *
+ * The pool grows geometrically. When it is moved by realloc, the freq and x
+ * pointers of every cross section already read in are updated to point at the
+ * new location.
  *
  **********************************************************/
 
 int
-get_atomic_data(char *masterfile, int use_relative)
+reserve_xsection_points(int np)
+{
+  int n;
+  int new_size;
+  double *new_freq, *new_x;
+
+  if(xsection_pool_npts + np > xsection_pool_size)
+  {
+    new_size = 2 * xsection_pool_size;
+    if(new_size < xsection_pool_npts + np)
+      new_size = xsection_pool_npts + np;
+    if(new_size < 4096)
+      new_size = 4096;
+
+    if((new_freq = realloc(xsection_pool_freq, new_size * sizeof(*new_freq))) == NULL)
+      return -1;
+    xsection_pool_freq = new_freq;
+    if((new_x = realloc(xsection_pool_x, new_size * sizeof(*new_x))) == NULL)
+      return -1;
+    xsection_pool_x = new_x;
+    xsection_pool_size = new_size;
+
+    for(n = 0; n < nphot_total; n++)
+      if(phot_top[n].offset >= 0)
+        attach_xsection_to_pool(&phot_top[n], phot_top[n].offset);
+    for(n = 0; n < n_inner_tot; n++)
+      if(inner_cross[n].offset >= 0)
+        attach_xsection_to_pool(&inner_cross[n], inner_cross[n].offset);
+  }
+
+  return xsection_pool_npts;
+}
+
+/**********************************************************/
+/**
+ * @brief      Read the points of a cross section into the pool
+ *
+ * @param[in]  AtomicFile_t *  afile  The staged file being read
+ * @param[in]  int     np       The number of points to read
+ * @param[out] int *   offset   The index of the first point in the pool
+ * @param[in, out] int *  lineno  The line number in the file
+ *
+ * @return     0 on success, otherwise an ATOMIC error code
+ *
+ * @details
+ *
+ * The points are read into reserved space at the end of the pool, with the
+ * energies converted from eV into frequency. The caller decides whether to
+ * keep them, by advancing xsection_pool_npts, once the cross section has been
+ * matched to a level or ion.
+ *
+ **********************************************************/
+
+int
+read_xsection_points(AtomicFile_t *afile, int np, int *offset, int *lineno)
+{
+  int n;
+  char aline[LINELENGTH];
+  AtomicRecord_t *record;
+
+  if((*offset = reserve_xsection_points(np)) < 0)
+  {
+    logfile("Get_atomic_data: Unable to allocate memory for %d cross section points\n", np);
+    return ATOMIC_MEMORY_ISSUE_ERROR;
+  }
+
+  for(n = *offset; n < *offset + np; n++)
+  {
+    if((record = read_atomic_data_record(afile, aline)) == NULL)
+    {
+      logfile("Get_atomic_data: Problem reading photoionization record\n");
+      logfile("Get_atomic_data: %s\n", aline);
+      return ATOMIC_ERROR_TODO;
+    }
+    if(record->has_points)      // the point was parsed when the file was staged
+    {
+      xsection_pool_freq[n] = record->points[0];
+      xsection_pool_x[n] = record->points[1];
+    }
+    else
+    {
+      scan_atomic_record(aline, "%*s %le %le", &xsection_pool_freq[n], &xsection_pool_x[n]);
+    }
+    xsection_pool_freq[n] = xsection_pool_freq[n] * EV2ERGS / H;  // convert from eV to freqency
+    (*lineno)++;
+  }
+
+  return 0;
+}
+
+/**********************************************************/
+/**
+ * @brief      Construct the full path to a masterfile or one of the data files
+ *             it lists
+ *
+ * @param[in]  char *  name          The name of the file, as given by the user
+ *                                   or in the masterfile
+ * @param[in]  int     use_relative  If TRUE, name is used as the path as is
+ * @param[in]  int     masterfile    TRUE if name is a masterfile
+ * @param[out] char *  path          The full path, LINELENGTH characters long
+ *
+ * @return     0 on success, or ATOMIC_ENVRIONMENT_ERROR if $PYTHON is not set
+ *
+ * @details
+ *
+ * Unless use_relative is set, masterfiles are looked for in $PYTHON/xdata and
+ * the data files they list, which are given as data/..., are looked for in
+ * $PYTHON/xdata.
+ *
+ **********************************************************/
+
+int
+get_atomic_data_path(char *name, int use_relative, int masterfile, char *path)
+{
+  char *python_file_path;
+
+  if(use_relative)
+  {
+    snprintf(path, LINELENGTH, "%s", name);
+    return 0;
+  }
+
+  if((python_file_path = getenv("PYTHON")) == NULL)
+    return ATOMIC_ENVRIONMENT_ERROR;
+
+  if(python_file_path[strlen(python_file_path) - 1] != '/')
+    snprintf(path, LINELENGTH, "%s/x%s%s", python_file_path, masterfile ? "data/" : "", name);
+  else
+    snprintf(path, LINELENGTH, "%sx%s%s", python_file_path, masterfile ? "data/" : "", name);
+
+  return 0;
+}
+
+/**********************************************************/
+/**
+ * @brief      Work out the type of a record from its keyword
+ *
+ * @param [in] char *  word   The first word of the record
+ * @return     The type of record, or 0 if it is a continuation record
+ *
+ * @details
+ *
+ * The type is a single character which selects how the record is interpreted
+ * by read_atomic_data.  A continuation record, beginning with *, has the same
+ * type as the record before it.
+ *
+ **********************************************************/
+
+char
+classify_atomic_data_record(char *word)
+{
+  char choice = 0;
+
+  if(strlen(word) == 0)
+    choice = 'c';         /*It's a a blank line, treated like a comment */
+  else if(strncmp(word, "!", 1) == 0)
+    choice = 'c';
+  else if(strncmp(word, "#", 1) == 0)
+    choice = 'c';         /* It's a comment */
+  else if(strncmp(word, "CSTREN", 6) == 0)  //collision strengths
+    choice = 'C';
+  else if(strncmp(word, "Element", 5) == 0)
+    choice = 'e';
+  else if(strncmp(word, "Ion", 3) == 0)
+    choice = 'i';
+  else if(strncmp(word, "LevTop", 6) == 0)
+    choice = 'N';
+  else if(strncmp(word, "LevMacro", 8) == 0)  // This indicated leves for a Macro Atom (SS)
+    choice = 'N';
+  else if(strncmp(word, "Level", 3) == 0) // There are various records of this type
+    choice = 'n';
+  else if(strncmp(word, "Phot", 4) == 0)  // There are various records of this type
+    choice = 'w';         // Macro Atom Phots are a subset of these (SS)
+  else if(strncmp(word, "Line", 4) == 0)
+    choice = 'r';
+  else if(strncmp(word, "LinMacro", 8) == 0)  //This indicates lines for a Macro Atom (SS)
+    choice = 'r';
+  else if(strncmp(word, "Frac", 4) == 0)
+    choice = 'f';         /*ground state fractions */
+  else if(strncmp(word, "InnerVYS", 8) == 0)
+    choice = 'I';         /*Its a set of inner shell photoionization cross sections */
+  else if(strncmp(word, "DR_BADNL", 8) == 0)  /* It's a badnell type dielectronic recombination file */
+    choice = 'D';
+  else if(strncmp(word, "DR_SHULL", 8) == 0)  /*its a schull type dielectronic recombination */
+    choice = 'S';
+  else if(strncmp(word, "RR_BADNL", 8) == 0)  /*Its a badnell type line in the total RR file */
+    choice = 'T';
+  else if(strncmp(word, "DI_DERE", 7) == 0) /*Its a data file giving direct ionization rates from Dere (2007) */
+    choice = 'd';
+  else if(strncmp(word, "RR_SHULL", 8) == 0)  /*Its a shull type line in the total RR file */
+    choice = 's';
+  else if(strncmp(word, "BAD_GS_RR", 9) == 0) /*Its a badnell resolved ground state RR file */
+    choice = 'G';
+  else if(strncmp(word, "FF_GAUNT", 8) == 0)  /*Its a data file giving the temperature averaged gaunt factors from Sutherland (1998) */
+    choice = 'g';
+  else if(strncmp(word, "Kelecyield", 10) == 0) /*Electron yield from inner shell ionization fro Kaastra and Mewe */
+    choice = 'K';
+//        else if (strncmp (word, "Kphotyield", 10) == 0) /*Floruescent photon yield from IS ionization from Kaastra and Mewe */
+//          choice = 'F';
+  else if(strncmp(word, "*", 1) == 0)
+    choice = 0;                 /* It's a continuation so record type remains same */
+
+  else
+    choice = 'z';         /* Who knows what it is */
+
+  return choice;
+}
+
+/**********************************************************/
+/**
+ * @brief      Interpret the records of the files listed in a masterfile
+ *
+ * @param [in] AtomicLoader_t *  loader   The loader which is staging the files
+ * @return     0 on success, otherwise an ATOMIC error code
+ *
+ * @details
+ *
+ * This does the work of get_atomic_data. The files are taken from the loader
+ * one at a time in masterfile order, and the records in each are interpreted
+ * in the order they appear in the file. The values in each record have
+ * already been parsed by the loader, so what is left here is to work out which
+ * ion, level or line each record belongs to and to merge it in.
+ *
+ **********************************************************/
+
+int
+read_atomic_data(AtomicLoader_t *loader)
 {
   int match;
-  FILE *fptr, *mptr;
+  FILE *fptr;
+  AtomicFile_t *afile;
+  AtomicRecord_t *record;
+  int nfile;
   char aline[LINELENGTH];
   char file[LINELENGTH];
 
@@ -924,33 +1449,34 @@ get_atomic_data(char *masterfile, int use_relative)
   int n, m, i, j;
   int n1, n2;                   //081115 nsh two new counters for DR - use new pointers to avoid any clashes!
   int nparam;                   //081115 nsh temperary holder for number of DR parameters
-  double drp[MAX_DR_PARAMS];    //081115 nsh array to hold DR parameters prior to putting into structure
-  double btrr[T_RR_PARAMS];     //0712 nsh array to hole badnell total RR params before putting into structure
-  int ne, w;                    //081115 nsh new variables for DR variables
-  int mstart, mstop;
+  int ne;                       //081115 nsh new variables for DR variables
   int nelem;
   double gl, gu;
   double el, eu;
   int qnum;
   double qqnum, ggg, gg;
-  int istate, z, nion;
+  int istate = -1, z = -1, nion;  //The ion of the last record, which old style level records belong to
   int iistate, zz;
   int levl, levu;
   int in, il;                   //The levels used in inner shell data
   double q;
-  double freq, f, exx, et, p;
-  double the_ground_frac[20];
+  double f, exx, et, p;
   char choice;
   int lineno;                   /* the line number in the file beginning with 1 */
-  int simple_line_ignore[NIONS], cstren_no_line;
+  int cstren_no_line;
   int nwords;
   int nlte, nmax;
   int mflag;                    //flag to identify reading data for macro atoms
   int nconfigl, nconfigu;       //internal labels for configurations
+  AtomicValues_t values;        //The values parsed from the record by the loader
+  LinePtr streamed_line;        //A line decoded from a streamed line list
+  int *coll_index;              //The collision strength index of a line
+  struct timespec sort_start, sort_end; //Used to time sorting the data into frequency order
+  int line_file;                //The file the current lines are streamed from
   int islp, ilv, np;
-  char configname[15];
-  double e, rl;
-  double xe[NCROSS], xx[NCROSS];
+  double rl;
+  int offset;                   //The index of the first point of a cross section in the cross section pool
+  int ierr;
   int nlines_simple;
   int nspline;
   double tmin;
@@ -960,11 +1486,8 @@ get_atomic_data(char *masterfile, int use_relative)
   int bb_max, bf_max;
   int lev_type;
   int nn;
-  double gstemp[BAD_GS_RR_PARAMS];  //Temporary storage for badnell resolved GS RR rates
-  double temp[LINELENGTH];      //Temporary storage for data read in off a line this is enogh if every character on the
   char gsflag, drflag;          //Flags to say what part of data is being read in for DR and RR
   double gstmin, gstmax;        //The range of temperatures for which all ions have GS RR rates
-  double gsqrdtemp, gfftemp, s1temp, s2temp, s3temp;  //Temporary storage for gaunt factors
   int n_elec_yield_tot;         //The number of inner shell cross sections with matching electron yield arrays
   int inner_no_e_yield;         //The number of inner shell cross sections with no yields
   double I, Ea;                 //The ionization energy and mean electron energy for electron yields
@@ -976,83 +1499,10 @@ get_atomic_data(char *masterfile, int use_relative)
   /* define which files to read as data files */
 
 
-  AtomixConfiguration.atomic_data_loaded = FALSE;
-
-/* Allocate structures for storage of data */
-
-  if(ele != NULL)
-  {
-    free(ele);
-  }
-  ele = (ElemPtr) calloc(sizeof(ele_dummy), NELEMENTS);
-  if(ele == NULL)
-  {
-    logfile("There is a problem in allocating memory for the element structure\n");
-    return ATOMIC_MEMORY_ISSUE_ERROR;
-  }
-  else
-  {
-    logfile
-      ("Allocated %10d bytes for each of %6d elements of   elements totaling %10.0f Mb \n",
-       sizeof(ele_dummy), NELEMENTS, 1.e-6 * NELEMENTS * sizeof(ele_dummy));
-  }
-
-
-  if(ions != NULL)
-  {
-    free(ions);
-  }
-  ions = (IonPtr) calloc(sizeof(ion_dummy), NIONS);
-  if(ions == NULL)
-  {
-    logfile("There is a problem in allocating memory for the ion structure\n");
-    return ATOMIC_MEMORY_ISSUE_ERROR;
-  }
-  else
-  {
-    logfile
-      ("Allocated %10d bytes for each of %6d elements of       ions totaling %10.1f Mb \n",
-       sizeof(ion_dummy), NIONS, 1.e-6 * NIONS * sizeof(ion_dummy));
-  }
-
-
-
-  if(config != NULL)
-  {
-    free(config);
-  }
-  config = (ConfigPtr) calloc(sizeof(config_dummy), NLEVELS);
-  if(config == NULL)
-  {
-    logfile("There is a problem in allocating memory for the config structure\n");
-    return ATOMIC_MEMORY_ISSUE_ERROR;
-  }
-  else
-  {
-    logfile
-      ("Allocated %10d bytes for each of %6d elements of     config totaling %10.1f Mb \n",
-       sizeof(config_dummy), NLEVELS, 1.e-6 * NLEVELS * sizeof(config_dummy));
-  }
-
-  if(line != NULL)
-  {
-    free(line);
-  }
-  line = (LinePtr) calloc(sizeof(line_dummy), NLINES);
-
-  if(line == NULL)
-  {
-    logfile("There is a problem in allocating memory for the line structure\n");
-    return ATOMIC_MEMORY_ISSUE_ERROR;
-  }
-  else
-  {
-    logfile
-      ("Allocated %10d bytes for each of %6d elements of       line totaling %10.1f Mb \n",
-       sizeof(line_dummy), NLINES, 1.e-6 * NLINES * sizeof(line_dummy));
-  }
-
+/* Empty the structures for storage of data. These grow as the data is read in */
 
+  free_atomic_tables();
+  free_streamed_lines();
 
   /* Initialize variables */
 
@@ -1061,216 +1511,23 @@ get_atomic_data(char *masterfile, int use_relative)
   phot_freq_min = VERY_BIG;
   inner_freq_min = VERY_BIG;
 
-  for(n = 0; n < NELEMENTS; n++)
-  {
-    strcpy(ele[n].name, "none");
-    ele[n].z = (-1);
-    ele[n].abun = (-1);
-    ele[n].firstion = (-1);
-    ele[n].nions = (-1);
-    ele[n].istate_max = (-1);
-  }
-
-  for(n = 0; n < NIONS; n++)
-  {
-    simple_line_ignore[n] = 0;  // diagnostic counter for how many lines ignored
-    ions[n].z = (-1);
-    ions[n].istate = (-1);
-    ions[n].nelem = (-1);
-    ions[n].ip = (-1);
-    ions[n].g = (-1);
-    ions[n].nmax = (-1);
-    ions[n].firstlevel = (-1);
-    ions[n].nlevels = (-1);
-    ions[n].first_nlte_level = (-1);
-    ions[n].first_levden = (-1);
-    ions[n].nlte = (-1);
-    ions[n].phot_info = (-1);
-    ions[n].macro_info = (-1);  //Initialise - don't know if using Macro Atoms or not: set to -1 (SS)
-    ions[n].ntop_first = 0;     // The fact that ntop_first and ntop  are initialized to 0 and not -1 is important
-    ions[n].ntop_ground = 0;    //NSH 0312 initialize the new pointer for GS cross sections
-    ions[n].ntop = 0;
-    ions[n].nxphot = (-1);
-    ions[n].lev_type = (-1);    // Initialise to indicate we don't know what types of configurations will be read
-    ions[n].drflag = 0;         //Initialise to indicate as far as we know, there are no dielectronic recombination parameters associated with this ion.
-    ions[n].total_rrflag = 0;   //Initialise to say this ion has no Badnell total recombination data
-    ions[n].nxtotalrr = -1;     //Initialise the pointer into the bad_t_rr structure.
-    ions[n].bad_gs_rr_t_flag = 0; //Initialise to say this ion has no Badnell ground state recombination data
-    ions[n].bad_gs_rr_r_flag = 0; //Initialise to say this ion has no Badnell ground state recombination data
-    ions[n].nxbadgsrr = -1;     //Initialise the pointer into the bad_gs_rr structure.
-    ions[n].dere_di_flag = 0;   //Initialise to say this ion has no Dere DI rate data
-    ions[n].nxderedi = -1;      //Initialise the pointer into the Dere DI rate structure
-    ions[n].n_inner = 0;        //Initialise the pointer to say we have no inner shell ionization cross sections
-    for(i = 0; i < N_INNER; i++)
-      ions[n].nxinner[i] = -1;  //Inintialise the inner shell pointer array
-  }
-
   nlevels = nxphot = nphot_total = ntop_phot = nauger = ndrecomb = n_inner_tot = 0; //Added counter for DR//
+  n_total_rr = n_bad_gs_rr = n_dere_di_rate = 0;
   n_elec_yield_tot = 0;         //Counter for electron yield
+  xsection_pool_npts = 0;       //Empty the cross section pool, but keep the memory for reuse
   //  n_fluor_yield_tot = 0;     and fluorescent photon yields
 
-  /*This initializes the top_phot array - it is used for all ionization processes so some elements
-     are only used in some circumstances
-   */
-
-  for(n = 0; n < NLEVELS; n++)
-  {
-    phot_top[n].nlev = (-1);
-    phot_top[n].uplev = (-1);
-    phot_top[n].nion = (-1);    //the ion to which this cross section belongs
-    phot_top[n].n_elec_yield = -1;  //pointer to the electron yield array (for inner shell)
-//    phot_top[n].n_fluor_yield = -1;     //pointer to the fluorescent photon yield (for inner shell)
-    phot_top[n].n = -1;         //pointer to shell (inner shell)
-    phot_top[n].l = -1;         //pointer to l subshell (inner shell only)
-    phot_top[n].z = (-1);       //atomic number
-    phot_top[n].np = (-1);      //number of points in the fit
-    phot_top[n].macro_info = (-1);  //Initialise - don't know if using Macro Atoms or not: set to -1 (SS)
-    for(j = 0; j < NCROSS; j++) //initialise the crooss sectiond
-    {
-      phot_top[n].freq[j] = (-1);
-      phot_top[n].x[j] = (-1);
-    }
-    phot_top[n].f = (-1);       //last frequency
-    phot_top[n].sigma = 0.0;    //last cross section
-  }
-
-
-  for(n = 0; n < NIONS * N_INNER; n++)  //Initialise atomic arrasy with dimension NIONS*NINNER
-  {
-    inner_cross[n].nlev = (-1);
-    inner_cross[n].uplev = (-1);
-    inner_cross[n].nion = inner_elec_yield[n].nion = inner_fluor_yield[n].nion = (-1);
-    inner_cross[n].n_elec_yield = -1;
-//    inner_cross[n].n_fluor_yield = -1;
-    inner_cross[n].n = inner_elec_yield[n].n = inner_fluor_yield[n].n = (-1);
-    inner_cross[n].l = inner_elec_yield[n].l = inner_fluor_yield[n].l = (-1);
-    inner_cross[n].z = inner_elec_yield[n].z = inner_fluor_yield[n].z = (-1);
-    inner_elec_yield[n].I = inner_elec_yield[n].Ea = 0.0;
-    inner_fluor_yield[n].freq = inner_fluor_yield[n].yield = 0.0;
-    for(j = 0; j < 10; j++)
-      inner_elec_yield[n].prob[j] = 0.0;
-    inner_cross[n].np = (-1);
-    inner_cross[n].macro_info = (-1); //Initialise - don't know if using Macro Atoms or not: set to -1 (SS)
-    for(j = 0; j < NCROSS; j++)
-    {
-      inner_cross[n].freq[j] = (-1);
-      inner_cross[n].x[j] = (-1);
-    }
-    inner_cross[n].f = (-1);
-    inner_cross[n].sigma = 0.0;
-  }
-
-
-
-
-  for(i = 0; i < NLEVELS; i++)
-  {
-    config[i].n_bbu_jump = 0;   // initialising the number of jumps from each level to 0. (SS)
-    config[i].n_bbd_jump = 0;
-    config[i].n_bfu_jump = 0;
-    config[i].n_bfd_jump = 0;
-  }
-
-  for(n = 0; n < NLINES; n++)
-  {
-    line[n].freq = -1;
-    line[n].f = 0;
-    line[n].nion = -1;
-    line[n].gl = line[n].gu = 0;
-    line[n].el = line[n].eu = 0.0;
-    line[n].macro_info = -1;
-    line[n].coll_index = -999;
-  }
-
-/* The following lines initialise the dielectronic recombination structure */
-  for(n = 0; n < NIONS; n++)
-  {
-    drecomb[n].nion = -1;
-    drecomb[n].nparam = -1;     //the number of parameters - it varies from ion to ion
-    for(n1 = 0; n1 < MAX_DR_PARAMS; n1++)
-    {
-      drecomb[n].c[n1] = 0.0;
-      drecomb[n].e[n1] = 0.0;
-    }
-  }
-
-
-/* The following lines initialise the badnell total radiative recombination rate structure */
-  for(n = 0; n < NIONS; n++)
-  {
-    total_rr[n].nion = -1;
-    for(n1 = 0; n1 < T_RR_PARAMS; n1++)
-    {
-      total_rr[n].params[n1] = 0.0;
-    }
-
-  }
-
-
-/* The following lines initialise the badnell total radiative recombination rate structure */
-  for(n = 0; n < NIONS; n++)
-  {
-    bad_gs_rr[n].nion = -1;
-    for(n1 = 0; n1 < BAD_GS_RR_PARAMS; n1++)
-    {
-      bad_gs_rr[n].temps[n1] = 0.0;
-      bad_gs_rr[n].rates[n1] = 0.0;
-    }
-
-  }
   gstmin = 0.0;
   gstmax = 1e99;
 
 
-/* The following lines initialise the dere direct ionization rate struture */
-  for(n = 0; n < NIONS; n++)
-  {
-    dere_di_rate[n].nion = -1;
-    dere_di_rate[n].xi = 0.0;
-    dere_di_rate[n].min_temp = 1e99;
-    for(n1 = 0; n1 < DERE_DI_PARAMS; n1++)
-    {
-      dere_di_rate[n].temps[n1] = 0.0;
-      dere_di_rate[n].rates[n1] = 0.0;
-    }
-
-  }
-
-
-
-
 /* The following lines initialise the Sutherland gaunt factors */
   gaunt_n_gsqrd = 0;            //The number of sets of scaled temperatures we have data for
-  for(n = 0; n < MAX_GAUNT_N_GSQRD; n++)
-  {
-    gaunt_total[n].log_gsqrd = 0.0;
-    gaunt_total[n].gff = 0.0;
-    gaunt_total[n].s1 = 0.0;
-    gaunt_total[n].s2 = 0.0;
-    gaunt_total[n].s3 = 0.0;
-  }
 
 
 /* The following lines initialise the collision strengths */
   n_coll_stren = 0;             //The number of data sets
   cstren_no_line = 0;           // counter to track how many times we don't find a matching line
-  for(n = 0; n < NLINES; n++)
-  {
-    coll_stren[n].n = -1;       //Internal index
-    coll_stren[n].lower = -1;   //The lower energy level - this is in Chianti notation and is currently unused
-    coll_stren[n].upper = -1;   //The upper energy level - this is in Chianti notation and is currently unused
-    coll_stren[n].energy = 0.0; //The energy of the transition
-    coll_stren[n].gf = 0.0;
-    coll_stren[n].hi_t_lim = 0.0; //The high temerature limit
-    coll_stren[n].n_points = 0.0; //The number of points in the splie fit
-    coll_stren[n].type = -1;    //The type of fit, this defines how one computes the scaled temperature and scaled coll strength
-    coll_stren[n].scaling_param = 0.0;  //The scaling parameter C used in the Burgess and Tully calculations
-    for(n1 = 0; n1 < N_COLL_STREN_PTS; n1++)
-    {
-      coll_stren[n].sct[n1] = 0.0;  //The scaled temperature points in the fit
-      coll_stren[n].scups[n1] = 0.0;
-    }
-  }
 
 
 
@@ -1295,137 +1552,38 @@ structure does not have this property! */
 
   /* OK now we can try to read in the data from the data files */
 
-  if(strcmp(masterfile, "") == 0)
-  {
-    return ATOMIC_FILE_IO_ERROR;
-  }
-
-  char *atomic_data_file_path = calloc(LINELENGTH, sizeof(char));
-  char *sub_atomic_data_file_path = calloc(LINELENGTH, sizeof(char));
-
-  char *python_file_path;
+/* Take each file in the masterfile in turn, once it has been staged by the loader */
 
-  if(!use_relative)
+  for(nfile = 0; nfile < loader->nfiles; nfile++)
   {
-    char data[LINELENGTH];
-    if((python_file_path = getenv("PYTHON")) == NULL)
+    strcpy(file, loader->files[nfile].name);
+
+    if((afile = get_staged_atomic_data_file(loader, nfile)) == NULL)
     {
-      logfile("Unable to find $PYTHON environment variable.\n");
-      return ATOMIC_ENVRIONMENT_ERROR;
+      logfile("Get_atomic_data: Could not open %s \n", loader->files[nfile].path);
+      return ATOMIC_FILE_IO_ERROR;
     }
-
-    if(python_file_path[strlen(python_file_path) - 1] != '/')
-      strcat(python_file_path, "/");
-
-    strcpy(atomic_data_file_path, python_file_path);
-    sprintf(data, "xdata/%s", masterfile);
-    strcat(atomic_data_file_path, data);
-  }
-  else
-  {
-    strcpy(atomic_data_file_path, masterfile);
-  }
-
-  if((mptr = fopen(atomic_data_file_path, "r")) == NULL)
-  {
-    logfile("Get_atomic_data: Could not find atomic data %s\n", atomic_data_file_path);
-    return ATOMIC_FILE_IO_ERROR;
-  }
-
-  atomic_summary_add("Reading atomic data from %s", atomic_data_file_path);
-
-/* Open and read each line in the masterfile in turn */
-
-  while(fgets(aline, LINELENGTH, mptr) != NULL)
-  {
-    if(sscanf(aline, "%s", file) == 1 && file[0] != '#')
+    else
     {
-
-      /*
-       * Open one of the files designated in the masterfile and begin to read it
-       */
-
-      if(!use_relative)
-      {
-        char adata[LINELENGTH];
-        sprintf(adata, "x");
-        strcat(adata, file);
-        strcpy(sub_atomic_data_file_path, python_file_path);
-        strcat(sub_atomic_data_file_path, adata);
-      }
-      else
-      {
-        strcpy(sub_atomic_data_file_path, file);
-      }
-
-      if((fptr = fopen(sub_atomic_data_file_path, "r")) == NULL)
-      {
-        logfile("Get_atomic_data: Could not open %s \n", sub_atomic_data_file_path);
-        return ATOMIC_FILE_IO_ERROR;
-      }
-
-      logfile("Get_atomic_data: Reading data from %s\n", sub_atomic_data_file_path);
+      logfile("Get_atomic_data: Reading data from %s\n", afile->path);
       lineno = 1;
+      line_file = -1;
 
-      /* Main loop for reading each data file line by line */
+      /* Main loop for reading each record of the data file in turn */
 
-      while(fgets(aline, LINELENGTH, fptr) != NULL)
+      while((record = read_atomic_data_record(afile, aline)) != NULL)
       {
         lineno++;
 
-        strcpy(word, "");       /*For reasons which are not clear, word needs to be reinitialized every time to
-                                   properly deal with blank lines */
-
-        if(sscanf(aline, "%s", word) == 0 || strlen(word) == 0)
-          choice = 'c';         /*It's a a blank line, treated like a comment */
-        else if(strncmp(word, "!", 1) == 0)
-          choice = 'c';
-        else if(strncmp(word, "#", 1) == 0)
-          choice = 'c';         /* It's a comment */
-        else if(strncmp(word, "CSTREN", 6) == 0)  //collision strengths
-          choice = 'C';
-        else if(strncmp(word, "Element", 5) == 0)
-          choice = 'e';
-        else if(strncmp(word, "Ion", 3) == 0)
-          choice = 'i';
-        else if(strncmp(word, "LevTop", 6) == 0)
-          choice = 'N';
-        else if(strncmp(word, "LevMacro", 8) == 0)  // This indicated leves for a Macro Atom (SS)
-          choice = 'N';
-        else if(strncmp(word, "Level", 3) == 0) // There are various records of this type
-          choice = 'n';
-        else if(strncmp(word, "Phot", 4) == 0)  // There are various records of this type
-          choice = 'w';         // Macro Atom Phots are a subset of these (SS)
-        else if(strncmp(word, "Line", 4) == 0)
-          choice = 'r';
-        else if(strncmp(word, "LinMacro", 8) == 0)  //This indicates lines for a Macro Atom (SS)
-          choice = 'r';
-        else if(strncmp(word, "Frac", 4) == 0)
-          choice = 'f';         /*ground state fractions */
-        else if(strncmp(word, "InnerVYS", 8) == 0)
-          choice = 'I';         /*Its a set of inner shell photoionization cross sections */
-        else if(strncmp(word, "DR_BADNL", 8) == 0)  /* It's a badnell type dielectronic recombination file */
-          choice = 'D';
-        else if(strncmp(word, "DR_SHULL", 8) == 0)  /*its a schull type dielectronic recombination */
-          choice = 'S';
-        else if(strncmp(word, "RR_BADNL", 8) == 0)  /*Its a badnell type line in the total RR file */
-          choice = 'T';
-        else if(strncmp(word, "DI_DERE", 7) == 0) /*Its a data file giving direct ionization rates from Dere (2007) */
-          choice = 'd';
-        else if(strncmp(word, "RR_SHULL", 8) == 0)  /*Its a shull type line in the total RR file */
-          choice = 's';
-        else if(strncmp(word, "BAD_GS_RR", 9) == 0) /*Its a badnell resolved ground state RR file */
-          choice = 'G';
-        else if(strncmp(word, "FF_GAUNT", 8) == 0)  /*Its a data file giving the temperature averaged gaunt factors from Sutherland (1998) */
-          choice = 'g';
-        else if(strncmp(word, "Kelecyield", 10) == 0) /*Electron yield from inner shell ionization fro Kaastra and Mewe */
-          choice = 'K';
-//        else if (strncmp (word, "Kphotyield", 10) == 0) /*Floruescent photon yield from IS ionization from Kaastra and Mewe */
-//          choice = 'F';
-        else if(strncmp(word, "*", 1) == 0);  /* It's a continuation so record type remains same */
+        /* The type of the record was worked out, and its values parsed, when the file was staged.
+           A continuation record keeps the type of the record before it */
+
+        memcpy(word, aline + record->word_start, record->word_len);
+        word[record->word_len] = '\0';
+        if(record->choice != 0)
+          choice = record->choice;
+        read_atomic_record_values(afile, record, choice, aline, &values);
 
-        else
-          choice = 'z';         /* Who knows what it is */
 
 
         switch (choice)
@@ -1441,21 +1599,18 @@ structure does not have this property! */
  *
  * */
           case 'e':
-            if(sscanf(aline, "%*s %d %s %le", &ele[nelements].z, ele[nelements].name, &ele[nelements].abun) != 3)
+            if((ierr = reserve_atomic_table(TABLE_ELEMENTS, nelements + 1)))
+              return ierr;
+            if(values.element.nwords != 3)
             {
               logfile("Get_atomic_data: file %s line %d: Element line incorrectly formatted\n", file, lineno);
               logfile("Get_atomic_data: %s\n", aline);
               exit(0);
             }
-            ele[nelements].abun = pow(10., ele[nelements].abun - 12.0); /* Immediate replace by number density relative to H */
+            ele[nelements].z = values.element.z;
+            strcpy(ele[nelements].name, values.element.name);
+            ele[nelements].abun = pow(10., values.element.abun - 12.0); /* Immediate replace by number density relative to H */
             nelements++;
-            if(nelements > NELEMENTS)
-            {
-              logfile("getatomic_data: file %s line %d: More elements than allowed. Increase NELEMENTS in atomic.h\n",
-                      file, lineno);
-              logfile("Get_atomic_data: %s\n", aline);
-              return ATOMIC_ERROR_TODO;
-            }
             break;
 
 
@@ -1487,15 +1642,21 @@ structure does not have this property! */
 
           case 'i':
 
-            if((nwords = sscanf(aline, "%*s %*s %d %d %le %le %d %d", &z, &istate, &gg, &p, &nmax, &nlte)) != 6)
+            if((nwords = values.ion.nwords) != 6)
             {
               logfile("get_atomic_data: file %s line %d: Ion istate line incorrectly formatted\n", file, lineno);
               logfile("Get_atomic_data: %s\n", aline);
               return ATOMIC_FILE_FORMAT_ERROR;
             }
+            z = values.ion.z;
+            istate = values.ion.istate;
+            gg = values.ion.g;
+            p = values.ion.ip;
+            nmax = values.ion.nmax;
+            nlte = values.ion.nlte;
 // Now check that an element line for this ion has already been read
             n = 0;
-            while(ele[n].z != z && n < nelements)
+            while(n < nelements && ele[n].z != z)
               n++;
             if(n == nelements)
             {
@@ -1505,6 +1666,11 @@ structure does not have this property! */
               break;
             }
 
+            if((ierr = reserve_atomic_table(TABLE_IONS, nions + 1))
+               || (ierr = reserve_atomic_table(TABLE_GROUND_FRAC, nions + 1))
+               || (ierr = reserve_atomic_table(TABLE_SIMPLE_LINE_IGNORE, nions + 1)))
+              return ierr;
+
 // Now populate the ion structure
 
             if(nlte > 0)
@@ -1536,14 +1702,7 @@ structure does not have this property! */
               ions[nions].macro_info = 0;
               nions_simple++;
             }
-            nions++;
-            if(nions == NIONS)
-            {
-              logfile
-                ("getatomic_data: file %s line %d: %d ions is more than %d allowed. Increase NIONS in atomic.h\n",
-                 file, lineno, nions, NIONS);
-              return ATOMIC_MAX_NIONS_ERROR;
-            }
+            nions++;
             break;
 
 /**
@@ -1673,9 +1832,14 @@ the program working in both cases, and certainly mixed cases  04apr ksl  */
 
             if(strncmp(word, "LevTop", 6) == 0)
             {                   //Its a TOPBASESTYLE level
-              sscanf(aline,
-                     "%*s %d %d %d %d %le %le %le %le %le %15c \n", &zz, &iistate, &islp, &ilv, &e, &exx, &ggg, &qqnum,
-                     &rl, configname);
+              zz = values.level.z;
+              iistate = values.level.istate;
+              islp = values.level.islp;
+              ilv = values.level.ilv;
+              exx = values.level.ex;
+              ggg = values.level.g;
+              qqnum = values.level.q_num;
+              rl = values.level.rl;
               istate = iistate;
               z = zz;
               gg = ggg;
@@ -1686,8 +1850,12 @@ the program working in both cases, and certainly mixed cases  04apr ksl  */
 
             else if(strncmp(word, "LevMacro", 8) == 0)
             {                   //It's a Macro Atom level (SS)
-              sscanf(aline, "%*s %d %d %d %le %le %le %le %15c \n", &zz, &iistate, &ilv, &e, &exx, &ggg, &rl,
-                     configname);
+              zz = values.level.z;
+              iistate = values.level.istate;
+              ilv = values.level.ilv;
+              exx = values.level.ex;
+              ggg = values.level.g;
+              rl = values.level.rl;
               islp = -1;        //these indices are not going to be used so just leave
               qqnum = -1;       //them at -1
               mflag = 1;        //record Macro read
@@ -1705,7 +1873,7 @@ the program working in both cases, and certainly mixed cases  04apr ksl  */
             }
 // Now check that the ion for this level is already known.  If not break out
             n = 0;
-            while((ions[n].z != z || ions[n].istate != istate) && n < nions)
+            while(n < nions && (ions[n].z != z || ions[n].istate != istate))
               n++;
             if(n == nions)
             {
@@ -1766,6 +1934,9 @@ a level type has not been established
 
 
             // case where data will be used (SS)
+            if((ierr = reserve_atomic_table(TABLE_CONFIG, nlevels + 1)))
+              return ierr;
+
             if(mflag == 1)
             {
               config[nlevels].macro_info = 1;
@@ -1853,30 +2024,29 @@ is already incremented
 
 
             nlevels++;
-
-            if(nlevels > NLEVELS)
-            {
-              logfile
-                ("getatomic_data: file %s line %d: More energy levels than allowed. Increase NLEVELS in atomic.h\n",
-                 file, lineno);
-              return ATOMIC_MAX_LEVELS_ERROR;
-            }
             break;
 
           case 'n':            // Its an "LTE" level
 
-            if(sscanf(aline, "%*s %d %d %d %le %le\n", &zz, &iistate, &qnum, &gg, &exx) == 5) //IT's KURUCZSTYLE
+            islp = -1;          // LTE levels have no LS term, so the index is not used
+            if(values.level.nwords == 5) //IT's KURUCZSTYLE
             {
-              istate = iistate;
-              z = zz;
+              istate = values.level.istate;
+              z = values.level.z;
+              qnum = values.level.ilv;
+              gg = values.level.g;
+              exx = values.level.ex;
               exx *= EV2ERGS;
               qqnum = ilv = qnum;
               lev_type = 0;     // It's a Kurucz-style record
 
             }
             else                // Read an OLDSTYLE level description
-            if(sscanf(aline, "%*s  %d %le %le\n", &qnum, &gg, &exx) == 3)
-            {
+            if(values.level.nwords == 3)
+            {                   // The element and ion are those of the last record which had them
+              qnum = values.level.ilv;
+              gg = values.level.g;
+              exx = values.level.ex;
               exx *= EV2ERGS;
               qqnum = ilv = qnum;
               lev_type = -2;    // It's an old style record, one which is only here for backward compatibility
@@ -1892,7 +2062,7 @@ is already incremented
 
 // Next section is identical already to case N
             n = 0;
-            while((ions[n].z != z || ions[n].istate != istate) && n < nions)
+            while(n < nions && (ions[n].z != z || ions[n].istate != istate))
               n++;
             if(n == nions)
             {
@@ -1949,6 +2119,9 @@ described as macro-levels. */
             }
 //  So now we know that this level can be associated with an ion
 
+            if((ierr = reserve_atomic_table(TABLE_CONFIG, nlevels + 1)))
+              return ierr;
+
             config[nlevels].z = z;
             config[nlevels].istate = istate;
             config[nlevels].isp = islp;
@@ -1976,13 +2149,6 @@ described as macro-levels. */
 
             nlevels_simple++;
             nlevels++;
-            if(nlevels > NLEVELS)
-            {
-              logfile
-                ("getatomic_data: file %s line %d: More energy levels than allowed. Increase NLEVELS in atomic.h\n",
-                 file, lineno);
-              return ATOMIC_MAX_LEVELS_ERROR;
-            }
             break;
 
 
@@ -2070,27 +2236,23 @@ described as macro-levels. */
             if(strncmp(word, "PhotMacS", 8) == 0)
             {
               // It's a Macro atom entry - similar format to TOPBASE - see below (SS)
-              sscanf(aline, "%*s %d %d %d %d %le %d\n", &z, &istate, &levl, &levu, &exx, &np);
+              z = values.xsection.z;
+              istate = values.xsection.istate;
+              levl = values.xsection.lower;
+              levu = values.xsection.upper;
+              exx = values.xsection.ex;
+              np = values.xsection.np;
               islp = -1;
               ilv = -1;
 
-              for(n = 0; n < np; n++)
-              {
-                //Read the photo. records but do nothing with them until verifyina a valid level
-                if(fgets(aline, LINELENGTH, fptr) == NULL)
-                {
-                  logfile("Get_atomic_data: Problem reading topbase photoionization record\n");
-                  logfile("Get_atomic_data: %s\n", aline);
-                  return ATOMIC_ERROR_TODO;
-                }
-                sscanf(aline, "%*s %le %le", &xe[n], &xx[n]);
-                lineno++;
-              }
+              //Read the photo. records but do nothing with them until verifyina a valid level
+              if((ierr = read_xsection_points(afile, np, &offset, &lineno)))
+                return ierr;
 
               // Locate upper state
               n = 0;
-              while((config[n].z != z || config[n].istate != (istate + 1) //note that the upper config will (SS)
-                     || config[n].ilv != levu) && n < nlevels)  //be the next ion up (istate +1) (SS)
+              while(n < nlevels && (config[n].z != z || config[n].istate != (istate + 1) //note that the upper config will (SS)
+                                    || config[n].ilv != levu))  //be the next ion up (istate +1) (SS)
                 n++;
               if(n == nlevels)
               {
@@ -2102,8 +2264,8 @@ described as macro-levels. */
 
               // Locate lower state
               m = 0;
-              while((config[m].z != z || config[m].istate != istate //Now searching for the lower
-                     || config[m].ilv != levl) && m < nlevels)  //configuration (SS)
+              while(m < nlevels && (config[m].z != z || config[m].istate != istate  //Now searching for the lower
+                                    || config[m].ilv != levl))  //configuration (SS)
                 m++;
               if(m == nlevels)
               {
@@ -2112,6 +2274,9 @@ described as macro-levels. */
                 break;          //Need to match the configuration for macro atoms - break if not found.
               }
 
+              if((ierr = reserve_atomic_table(TABLE_PHOT_TOP, nphot_total + 1)))
+                return ierr;
+
               // Populate upper state info
               phot_top[ntop_phot].uplev = n;  //store the level in the upper ion (SS)
               config[n].bfd_jump[config[n].n_bfd_jump] = ntop_phot; //record the line index as a downward bf Macro Atom jump (SS)
@@ -2159,13 +2324,10 @@ described as macro-levels. */
 
               ions[config[m].nion].ntop++;
 
-              // Finish up this section by storing the photionization data properly
+              // Finish up this section by keeping the photionization data in the pool
 
-              for(n = 0; n < np; n++)
-              {
-                phot_top[ntop_phot].freq[n] = xe[n] * EV2ERGS / H;  // convert from eV to freqency
-                phot_top[ntop_phot].x[n] = xx[n]; // leave cross sections in  CGS
-              }
+              attach_xsection_to_pool(&phot_top[ntop_phot], offset);
+              xsection_pool_npts = offset + np;
               if(phot_freq_min > phot_top[ntop_phot].freq[0])
                 phot_freq_min = phot_top[ntop_phot].freq[0];
 
@@ -2173,14 +2335,6 @@ described as macro-levels. */
               ntop_phot_macro++;
               ntop_phot++;
               nphot_total++;
-
-              if(nphot_total > NTOP_PHOT)
-              {
-                logfile
-                  ("get_atomicdata: More macro photoionization cross sections that NTOP_PHOT (%d).  Increase in atomic.h\n",
-                   NTOP_PHOT);
-                return ATOMIC_ERROR_TODO;
-              }
               break;
             }
 
@@ -2189,19 +2343,15 @@ described as macro-levels. */
             else if(strncmp(word, "PhotTopS", 8) == 0)
             {
               // It's a TOPBASE style photoionization record, beginning with the summary record
-              sscanf(aline, "%*s %d %d %d %d %le %d\n", &z, &istate, &islp, &ilv, &exx, &np);
-              for(n = 0; n < np; n++)
-              {                 //Read the topbase photoionization records
-                if(fgets(aline, LINELENGTH, fptr) == NULL)
-                {
-                  logfile("Get_atomic_data: Problem reading topbase photoionization record\n");
-                  logfile("Get_atomic_data: %s\n", aline);
-                  return ATOMIC_ERROR_TODO;
-                }
-                sscanf(aline, "%*s %le %le", &xe[n], &xx[n]);
-                lineno++;
-
-              }
+              z = values.xsection.z;
+              istate = values.xsection.istate;
+              islp = values.xsection.lower;
+              ilv = values.xsection.upper;
+              exx = values.xsection.ex;
+              np = values.xsection.np;
+              //Read the topbase photoionization records
+              if((ierr = read_xsection_points(afile, np, &offset, &lineno)))
+                return ierr;
 
               n = 0;
 
@@ -2212,9 +2362,9 @@ described as macro-levels. */
                * partition functions
                */
 
-              while((config[n].nden == -1
-                     || config[n].z != z || config[n].istate != istate || config[n].isp != islp
-                     || config[n].ilv != ilv) && n < nlevels)
+              while(n < nlevels && (config[n].nden == -1
+                                    || config[n].z != z || config[n].istate != istate || config[n].isp != islp
+                                    || config[n].ilv != ilv))
                 n++;
               if(n == nlevels)
               {
@@ -2225,6 +2375,9 @@ described as macro-levels. */
               }
               if(ions[config[n].nion].macro_info == 0)  //this is not a macro atom level (SS)
               {
+                if((ierr = reserve_atomic_table(TABLE_PHOT_TOP, nphot_total + 1)))
+                  return ierr;
+
                 phot_top[ntop_phot].nlev = n; // level associated with this crossection.
                 phot_top[ntop_phot].nion = config[n].nion;
                 phot_top[ntop_phot].z = z;
@@ -2257,12 +2410,8 @@ described as macro-levels. */
                   return ATOMIC_ERROR_TODO;
                 }
                 ions[config[n].nion].ntop++;
-                for(n = 0; n < np; n++)
-                {
-                  phot_top[ntop_phot].freq[n] = xe[n] * EV2ERGS / H;  // convert from eV to freqency
-
-                  phot_top[ntop_phot].x[n] = xx[n]; // leave cross sections in  CGS
-                }
+                attach_xsection_to_pool(&phot_top[ntop_phot], offset);
+                xsection_pool_npts = offset + np;
                 if(phot_freq_min > phot_top[ntop_phot].freq[0])
                   phot_freq_min = phot_top[ntop_phot].freq[0];
 
@@ -2270,15 +2419,6 @@ described as macro-levels. */
                 ntop_phot_simple++;
                 ntop_phot++;
                 nphot_total++;
-
-                /* check to assure we did not exceed the allowed number of photoionization records */
-                if(nphot_total > NTOP_PHOT)
-                {
-                  logfile
-                    ("get_atomicdata: More TopBase photoionization cross sections that NTOP_PHOT (%d).  Increase in atomic.h\n",
-                     NTOP_PHOT);
-                  return ATOMIC_ERROR_TODO;
-                }
               }
               else
               {
@@ -2296,20 +2436,15 @@ described as macro-levels. */
             else if(strncmp(word, "PhotVfkyS", 8) == 0)
             {
               // It's a VFKY style photoionization record, beginning with the summary record
-              sscanf(aline, "%*s %d %d %d %d %le %d\n", &z, &istate, &islp, &ilv, &exx, &np);
-              for(n = 0; n < np; n++)
-              {
-                //Read the topbase photoionization records
-                if(fgets(aline, LINELENGTH, fptr) == NULL)
-                {
-                  logfile("Get_atomic_data: Problem reading Vfky photoionization record\n");
-                  logfile("Get_atomic_data: %s\n", aline);
-                  return ATOMIC_ERROR_TODO;
-                }
-                sscanf(aline, "%*s %le %le", &xe[n], &xx[n]);
-                lineno++;
-
-              }
+              z = values.xsection.z;
+              istate = values.xsection.istate;
+              islp = values.xsection.lower;
+              ilv = values.xsection.upper;
+              exx = values.xsection.ex;
+              np = values.xsection.np;
+              //Read the Vfky photoionization records
+              if((ierr = read_xsection_points(afile, np, &offset, &lineno)))
+                return ierr;
 
               for(nion = 0; nion < nions; nion++)
               {
@@ -2318,6 +2453,9 @@ described as macro-levels. */
                   if(ions[nion].phot_info == -1)
                   {
                     /* Then there is a match */
+                    if((ierr = reserve_atomic_table(TABLE_PHOT_TOP, nphot_total + 1)))
+                      return ierr;
+
                     phot_top[nphot_total].nlev = ions[nion].firstlevel; // ground state
                     phot_top[nphot_total].nion = nion;
                     phot_top[nphot_total].z = z;
@@ -2329,11 +2467,8 @@ described as macro-levels. */
                     ions[nion].phot_info = 0; /* Mark this ion as using VFKY photo */
                     ions[nion].nxphot = nphot_total;
 
-                    for(n = 0; n < np; n++)
-                    {
-                      phot_top[nphot_total].freq[n] = xe[n] * EV2ERGS / H;  // convert from eV to freqency
-                      phot_top[nphot_total].x[n] = xx[n]; // leave cross sections in  CGS
-                    }
+                    attach_xsection_to_pool(&phot_top[nphot_total], offset);
+                    xsection_pool_npts = offset + np;
                     if(phot_freq_min > phot_top[ntop_phot].freq[0])
                       phot_freq_min = phot_top[ntop_phot].freq[0];
                     nxphot++;
@@ -2353,11 +2488,8 @@ described as macro-levels. */
                     phot_top[ions[nion].ntop_ground].nlast = -1;
                     phot_top[ions[nion].ntop_ground].macro_info = 0;
                     ions[nion].phot_info = 2; //We mark this as having hybrid data - VFKY ground, TB excited, potentially VFKY innershell
-                    for(n = 0; n < np; n++)
-                    {
-                      phot_top[ions[nion].ntop_ground].freq[n] = xe[n] * EV2ERGS / H; // convert from eV to freqency
-                      phot_top[ions[nion].ntop_ground].x[n] = xx[n];  // leave cross sections in  CGS
-                    }
+                    attach_xsection_to_pool(&phot_top[ions[nion].ntop_ground], offset);
+                    xsection_pool_npts = offset + np;
                     if(phot_freq_min > phot_top[ions[nion].ntop_ground].freq[0])
                       phot_freq_min = phot_top[ions[nion].ntop_ground].freq[0];
                     logfile_error
@@ -2367,18 +2499,11 @@ described as macro-levels. */
                 }
               }
 
-              if(nxphot > NIONS)
+              if(nxphot > nions)
               {
                 logfile("getatomic_data: file %s line %d: More photoionization edges than IONS.\n", file, lineno);
                 return ATOMIC_ERROR_TODO;
               }
-              if(nphot_total > NTOP_PHOT)
-              {
-                logfile
-                  ("get_atomicdata: More photoionization cross sections that NTOP_PHOT (%d).  Increase in atomic.h\n",
-                   NTOP_PHOT);
-                return ATOMIC_ERROR_TODO;
-              }
 
               break;
             }
@@ -2395,29 +2520,37 @@ described as macro-levels. */
 
 
           case 'I':
-            if(sscanf(aline, "%*s %d %d %d %d %le %d\n", &z, &istate, &in, &il, &exx, &np) != 6)
+            if(values.xsection.nwords != 6)
             {
               logfile("Inner shell ionization data incorrectly formatted\n");
               logfile("Get_atomic_data: %s\n", aline);
               return ATOMIC_ERROR_TODO;
             }
-            for(n = 0; n < np; n++)
-            {
-              //Read the topbase photoionization records
-              if(fgets(aline, LINELENGTH, fptr) == NULL)
-              {
-                logfile("Get_atomic_data: Problem reading VY inner shell record\n");
-                logfile("Get_atomic_data: %s\n", aline);
-                return ATOMIC_ERROR_TODO;
-              }
-              sscanf(aline, "%*s %le %le", &xe[n], &xx[n]);
-              lineno++;
-            }
+            z = values.xsection.z;
+            istate = values.xsection.istate;
+            in = values.xsection.lower;
+            il = values.xsection.upper;
+            exx = values.xsection.ex;
+            np = values.xsection.np;
+            //Read the VY inner shell records
+            if((ierr = read_xsection_points(afile, np, &offset, &lineno)))
+              return ierr;
             for(nion = 0; nion < nions; nion++)
             {
               if(ions[nion].z == z && ions[nion].istate == istate && ions[nion].macro_info != 1)
               {
                 /* Then there is a match */
+                if(ions[nion].n_inner + 1 >= N_INNER)
+                {
+                  logfile("getatomic_data: file %s line %d: More inner edges for ion %d than N_INNER.\n", file, lineno,
+                          nion);
+                  return ATOMIC_ERROR_TODO;
+                }
+                if((ierr = reserve_atomic_table(TABLE_INNER_CROSS, n_inner_tot + 1))
+                   || (ierr = reserve_atomic_table(TABLE_INNER_ELEC_YIELD, n_inner_tot + 1))
+                   || (ierr = reserve_atomic_table(TABLE_INNER_FLUOR_YIELD, n_inner_tot + 1)))
+                  return ierr;
+
                 inner_cross[n_inner_tot].nlev = ions[nion].firstlevel;  //All these are for the ground state
                 inner_cross[n_inner_tot].nion = nion;
                 inner_cross[n_inner_tot].np = np;
@@ -2428,22 +2561,14 @@ described as macro-levels. */
                 inner_cross[n_inner_tot].nlast = -1;
                 ions[nion].n_inner++; /*Increment the number of inner shells */
                 ions[nion].nxinner[ions[nion].n_inner] = n_inner_tot;
-                for(n = 0; n < np; n++)
-                {
-                  inner_cross[n_inner_tot].freq[n] = xe[n] * EV2ERGS / H; // convert from eV to freqency
-                  inner_cross[n_inner_tot].x[n] = xx[n];  // leave cross sections in  CGS
-                }
+                attach_xsection_to_pool(&inner_cross[n_inner_tot], offset);
+                xsection_pool_npts = offset + np;
                 if(inner_freq_min > inner_cross[n_inner_tot].freq[0])
                   inner_freq_min = inner_cross[n_inner_tot].freq[0];
                 n_inner_tot++;
 
               }
             }
-            if(n_inner_tot > N_INNER * NIONS)
-            {
-              logfile("getatomic_data: file %s line %d: Inner edges than we have room for.\n", file, lineno);
-              return ATOMIC_ERROR_TODO;
-            }
             break;
 
 
@@ -2632,6 +2757,13 @@ described as macro-levels. */
  *   out if either was not accounted for.
 */
           case 'r':
+            if(AtomixConfiguration.lines_streamed)
+              ierr = reserve_atomic_table(TABLE_LINE_INDEX, nlines + 1);
+            else
+              ierr = reserve_atomic_table(TABLE_LINES, nlines + 1);
+            if(ierr)
+              return ierr;
+
             if(strncmp(word, "LinMacro", 8) == 0)
             {                   //It's a macro atoms line(SS)
               if(mflag != 1)
@@ -2641,9 +2773,7 @@ described as macro-levels. */
               }
 
               mflag = 1;        //flag to identify macro atom case (SS)
-              nwords =
-                sscanf(aline, "%*s %d %d %le %le %le %le %le %le %d %d", &z, &istate, &freq, &f, &gl, &gu, &el, &eu,
-                       &levl, &levu);
+              nwords = values.line.nwords;
               if(nwords != 10)
               {
                 logfile("get_atomic_data: file %s line %d: LinMacro line incorrectly formatted\n", file, lineno);
@@ -2651,11 +2781,13 @@ described as macro-levels. */
                 return ATOMIC_ERROR_TODO;
               }
 
-              el = EV2ERGS * el;
-              eu = EV2ERGS * eu;
+              z = values.line.z;
+              istate = values.line.istate;
+              levl = values.line.levl;
+              levu = values.line.levu;
               //need to identify the configurations associated with the upper and lower levels (SS)
               n = 0;
-              while((config[n].z != z || config[n].istate != istate || config[n].ilv != levl) && n < nlevels)
+              while(n < nlevels && (config[n].z != z || config[n].istate != istate || config[n].ilv != levl))
                 n++;
               if(n == nlevels)
               {
@@ -2665,7 +2797,7 @@ described as macro-levels. */
 
 
               m = 0;
-              while((config[m].z != z || config[m].istate != istate || config[m].ilv != levu) && m < nlevels)
+              while(m < nlevels && (config[m].z != z || config[m].istate != istate || config[m].ilv != levu))
                 m++;
               if(m == nlevels)
               {
@@ -2677,7 +2809,8 @@ described as macro-levels. */
 
               nconfigl = n;     //record lower configuration (SS)
               config[n].bbu_jump[config[n].n_bbu_jump] = nlines;  //record the line index as an upward bb Macro Atom jump(SS)
-              line[nlines].down_index = config[n].n_bbu_jump; //record the index for the jump in the line structure
+              if(!AtomixConfiguration.lines_streamed)
+                line[nlines].down_index = config[n].n_bbu_jump; //record the index for the jump in the line structure
               config[n].n_bbu_jump += 1;  //note that there is one more upwards jump available (SS)
               if(config[n].n_bbu_jump > NBBJUMPS)
               {
@@ -2687,7 +2820,8 @@ described as macro-levels. */
 
               nconfigu = m;     //record upper configuration (SS)
               config[m].bbd_jump[config[m].n_bbd_jump] = nlines;  //record the line index as a downward bb Macro Atom jump (SS)
-              line[nlines].up_index = config[m].n_bbd_jump; //record jump index in line structure
+              if(!AtomixConfiguration.lines_streamed)
+                line[nlines].up_index = config[m].n_bbd_jump; //record jump index in line structure
               config[m].n_bbd_jump += 1;  //note that there is one more downwards jump available (SS)
               if(config[m].n_bbd_jump > NBBJUMPS)
               {
@@ -2704,46 +2838,31 @@ described as macro-levels. */
               mflag = -1;       //a flag to mark this as not a macro atom case (SS)
               nconfigl = -1;
               nconfigu = -1;
-              nwords =
-                sscanf(aline, "%*s %d %2d %le %le %le %le %le %le %d %d", &z, &istate, &freq, &f, &gl, &gu, &el, &eu,
-                       &levl, &levu);
-              if(nwords == 6)
-              {
-                el = 0.0;
-                eu = H * C / (freq * 1e-8); // Convert Angstroms to ergs
-                levl = -1;
-                levu = -1;
-
-              }
-              else if(nwords == 8)
-              {                 // Then the file contains the energy levels of the transitions
-
-                el = EV2ERGS * el;
-                eu = EV2ERGS * eu;
-                levl = -1;
-                levu = -1;
-              }
-              else if(nwords == 10)
-              {                 // Then the file contains energy levels and level numbers
-                el = EV2ERGS * el;
-                eu = EV2ERGS * eu;
-              }
-
-              else
+              nwords = values.line.nwords;
+              if(nwords != 6 && nwords != 8 && nwords != 10)
               {
                 logfile("get_atomic_data: file %s line %d: Resonance line incorrectly formatted\n", file, lineno);
                 logfile("Get_atomic_data: %s\n", aline);
                 return ATOMIC_ERROR_TODO;
               }
+
+              z = values.line.z;
+              istate = values.line.istate;
             }
 
+            f = values.line.f;
+            gl = values.line.gl;
+            gu = values.line.gu;
+            el = values.line.el;
+            eu = values.line.eu;
+
             if(el > eu)
               logfile("get_atomic_data: file %s line %d : line has el (%f) > eu (%f)\n", file, lineno, el, eu);
             for(n = 0; n < nions; n++)
             {
               if(ions[n].z == z && ions[n].istate == istate)
               {                 /* Then there is a match */
-                if(freq == 0 || f <= 0 || gl == 0 || gu == 0)
+                if(isinf(values.line.freq) || f <= 0 || gl == 0 || gu == 0)  // i.e. a wavelength of zero
                 {
                   logfile_error("getatomic_data: line input incomplete: %s\n", aline);
                   break;
@@ -2767,62 +2886,61 @@ would like to have simple lines for macro-ions */
                      n);
                   return ATOMIC_ERROR_TODO;
                 }
-                line[nlines].nion = n;
-                line[nlines].z = z;
-                line[nlines].istate = istate;
-                line[nlines].freq = C / (freq * 1e-8);  /* convert Angstroms to frequency */
-                line[nlines].f = f;
-                line[nlines].gl = gl;
-                line[nlines].gu = gu;
-                line[nlines].levl = levl;
-                line[nlines].levu = levu;
-                line[nlines].el = el;
-                line[nlines].eu = eu;
-                line[nlines].nconfigl = nconfigl;
-                line[nlines].nconfigu = nconfigu;
-                line[nlines].coll_index = -999; //Tokick off with we assume there is no collisional strength data
-                if(mflag == -1)
+                /* When the line list is streamed, only what is needed to find the line again is kept */
+                if(AtomixConfiguration.lines_streamed)
                 {
-                  line[nlines].macro_info = 0;  // It's an old-style line`
-                  nlines_simple++;
+                  if(line_file < 0 && (line_file = add_streamed_line_file(afile->path)) < 0)
+                    return ATOMIC_MEMORY_ISSUE_ERROR;
+                  line_index[nlines].freq = values.line.freq;
+                  line_index[nlines].offset = record->start;
+                  line_index[nlines].file = line_file;
+                  line_index[nlines].nion = n;
+                  line_index[nlines].levl = values.line.levl;
+                  line_index[nlines].levu = values.line.levu;
+                  line_index[nlines].gl = values.line.gl;
+                  line_index[nlines].gu = values.line.gu;
+                  line_index[nlines].f = values.line.f;
+                  line_index[nlines].coll_index = -999;
                 }
                 else
                 {
-                  line[nlines].macro_info = 1;  //It's a macro line
-                  nlines_macro++;
+                  line[nlines].nion = n;
+                  line[nlines].z = z;
+                  line[nlines].istate = istate;
+                  line[nlines].freq = values.line.freq;
+                  line[nlines].f = f;
+                  line[nlines].gl = gl;
+                  line[nlines].gu = gu;
+                  line[nlines].levl = values.line.levl;
+                  line[nlines].levu = values.line.levu;
+                  line[nlines].el = el;
+                  line[nlines].eu = eu;
+                  line[nlines].nconfigl = nconfigl;
+                  line[nlines].nconfigu = nconfigu;
+                  line[nlines].coll_index = -999; //Tokick off with we assume there is no collisional strength data
+                  line[nlines].macro_info = mflag == -1 ? 0 : 1;  // Either an old-style or a macro line
                 }
+                if(mflag == -1)
+                  nlines_simple++;
+                else
+                  nlines_macro++;
                 nlines++;
               }
             }
-            if(nlines > NLINES)
-            {
-              logfile("getatomic_data: file %s line %d: More lines than allowed. Increase NLINES in atomic.h\n", file,
-                      lineno);
-              return ATOMIC_ERROR_TODO;
-            }
             break;
 
 /** @section Ground state fractions
  */
           case 'f':
-            if(sscanf
-               (aline,
-                "%*s %d %d %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le",
-                &z, &istate, &the_ground_frac[0], &the_ground_frac[1],
-                &the_ground_frac[2], &the_ground_frac[3],
-                &the_ground_frac[4], &the_ground_frac[5],
-                &the_ground_frac[6], &the_ground_frac[7],
-                &the_ground_frac[8], &the_ground_frac[9],
-                &the_ground_frac[10], &the_ground_frac[11],
-                &the_ground_frac[12], &the_ground_frac[13],
-                &the_ground_frac[14], &the_ground_frac[15],
-                &the_ground_frac[16], &the_ground_frac[17], &the_ground_frac[18], &the_ground_frac[19]) != 22)
+            if(values.list.nwords != 22)
             {
               logfile("get_atomic_data: file %s line %d ground state fracs   frac table incorrectly formatted\n", file,
                       lineno);
               logfile("Get_atomic_data: %s\n", aline);
               return ATOMIC_ERROR_TODO;
             }
+            z = values.list.z;
+            istate = values.list.istate;
             for(n = 0; n < nions; n++)
             {
               if(ions[n].z == z && ions[n].istate == istate)
@@ -2831,7 +2949,7 @@ would like to have simple lines for macro-ions */
                 ground_frac[n].istate = istate;
                 for(j = 0; j < 20; j++)
                 {
-                  ground_frac[n].frac[j] = the_ground_frac[j];
+                  ground_frac[n].frac[j] = values.list.values[j];
                 }
               }
             }
@@ -2859,7 +2977,10 @@ would like to have simple lines for macro-ions */
  */
 
           case 'D':            /* Dielectronic recombination data read in. */
-            nparam = sscanf(aline, "%*s %s %d %d %le %le %le %le %le %le %le %le %le", &drflag, &z, &ne, &drp[0], &drp[1], &drp[2], &drp[3], &drp[4], &drp[5], &drp[6], &drp[7], &drp[8]);  //split and assign the line
+            nparam = values.list.nwords;
+            drflag = values.list.flag;
+            z = values.list.z;
+            ne = values.list.istate;
             nparam -= 3;        //take 4 off the nparam to give the number of actual parameters
             if(nparam > 9 || nparam < 1)  //     trap errors - not as robust as usual because there are a varaible number of parameters...
             {
@@ -2876,6 +2997,8 @@ would like to have simple lines for macro-ions */
               {
                 if(ions[n].drflag == 0) //This is the first time we have dealt with this ion
                 {
+                  if((ierr = reserve_atomic_table(TABLE_DRECOMB, ndrecomb + 1)))
+                    return ierr;
                   drecomb[ndrecomb].nion = n; //put the ion number into the DR structure
                   drecomb[ndrecomb].nparam = nparam;  //Put the number of parameters we ware going to read in, into the DR structure so we know what to iterate over later
                   ions[n].nxdrecomb = ndrecomb; //put the number of the DR into the ion
@@ -2890,7 +3013,7 @@ would like to have simple lines for macro-ions */
                   n1 = ions[n].nxdrecomb; //     Get the pointer to the correct bit of the recombination coefficient array. This should already be set from the first time through
                   for(n2 = 0; n2 < nparam; n2++)
                   {
-                    drecomb[n1].e[n2] = drp[n2];  //we are getting e parameters
+                    drecomb[n1].e[n2] = values.list.values[n2];  //we are getting e parameters
                   }
 
 
@@ -2900,7 +3023,7 @@ would like to have simple lines for macro-ions */
                   n1 = ions[n].nxdrecomb; //     Get the pointer to the correct bit of the recombination coefficient array. This should already be set from the first time through
                   for(n2 = 0; n2 < nparam; n2++)
                   {
-                    drecomb[n1].c[n2] = drp[n2];  //           we are getting e parameters
+                    drecomb[n1].c[n2] = values.list.values[n2];  //           we are getting e parameters
                   }
                 }
 
@@ -2929,7 +3052,9 @@ would like to have simple lines for macro-ions */
 
 
           case 'S':
-            nparam = sscanf(aline, "%*s %d %d %le %le %le %le ", &z, &ne, &drp[0], &drp[1], &drp[2], &drp[3]);  //split and assign the line
+            nparam = values.list.nwords;
+            z = values.list.z;
+            ne = values.list.istate;
             nparam -= 2;        //take 4 off the nparam to give the number of actual parameters
             if(nparam > 4 || nparam < 1)  //     trap errors - not as robust as usual because there are a varaible number of parameters...
             {
@@ -2946,6 +3071,8 @@ would like to have simple lines for macro-ions */
               {
                 if(ions[n].drflag == 0) //This is the first time we have dealt with this ion
                 {
+                  if((ierr = reserve_atomic_table(TABLE_DRECOMB, ndrecomb + 1)))
+                    return ierr;
                   drecomb[ndrecomb].nion = n; //put the ion number into the DR structure
                   drecomb[ndrecomb].nparam = nparam;  //Put the number of parameters we ware going to read in, into the DR structure so we know what to iterate over later
                   ions[n].nxdrecomb = ndrecomb; //put the number of the DR into the ion
@@ -2957,7 +3084,7 @@ would like to have simple lines for macro-ions */
                 n1 = ions[n].nxdrecomb; //     Get the pointer to the correct bit of the recombination coefficient array. This should already be set from the first time through
                 for(n2 = 0; n2 < nparam; n2++)
                 {
-                  drecomb[n1].shull[n2] = drp[n2];  //we are getting e parameters
+                  drecomb[n1].shull[n2] = values.list.values[n2];  //we are getting e parameters
                 }
               }
             }
@@ -2986,7 +3113,9 @@ would like to have simple lines for macro-ions */
 
           case 'T':            /*Badnell type total raditive rate coefficients read in */
 
-            nparam = sscanf(aline, "%*s %d %d %d %le %le %le %le %le %le", &z, &ne, &w, &btrr[0], &btrr[1], &btrr[2], &btrr[3], &btrr[4], &btrr[5]);  //split and assign the line
+            nparam = values.list.nwords;
+            z = values.list.z;
+            ne = values.list.istate;
             nparam -= 3;        //take 4 off the nparam to give the number of actual parameters
             if(nparam > 6 || nparam < 1)  //     trap errors - not as robust as usual because there are a varaible number of parameters...
             {
@@ -3002,13 +3131,15 @@ would like to have simple lines for macro-ions */
               {
                 if(ions[n].total_rrflag == 0) // this ion has no parameters, so it must be the first time through
                 {
+                  if((ierr = reserve_atomic_table(TABLE_TOTAL_RR, n_total_rr + 1)))
+                    return ierr;
                   total_rr[n_total_rr].nion = n;  //put the ion number into the bad_t_rr structure
                   ions[n].nxtotalrr = n_total_rr; /*put the number of the bad_t_rr into the ion
                                                      structure so we can go either way. */
                   total_rr[n_total_rr].type = RRTYPE_BADNELL;
                   for(n1 = 0; n1 < nparam; n1++)
                   {
-                    total_rr[n_total_rr].params[n1] = btrr[n1]; //we are getting  parameters
+                    total_rr[n_total_rr].params[n1] = values.list.values[n1]; //we are getting  parameters
                   }
                   ions[n].total_rrflag++; //increment the flag by 1. We will do this rather than simply setting it to 1 so we will get errors if we do this more than once....
                   n_total_rr++; //increment the counter of number of dielectronic recombination parameter sets
@@ -3049,7 +3180,9 @@ would like to have simple lines for macro-ions */
 
 
           case 's':
-            nparam = sscanf(aline, "%*s %d %d %le %le ", &z, &ne, &btrr[0], &btrr[1]);  //split and assign the line
+            nparam = values.list.nwords;
+            z = values.list.z;
+            ne = values.list.istate;
             nparam -= 2;        //take 4 off the nparam to give the number of actual parameters
             if(nparam > 6 || nparam < 1)  //     trap errors - not as robust as usual because there are a varaible number of parameters...
             {
@@ -3065,13 +3198,15 @@ would like to have simple lines for macro-ions */
               {
                 if(ions[n].total_rrflag == 0) // this ion has no parameters, so it must be the first time through
                 {
+                  if((ierr = reserve_atomic_table(TABLE_TOTAL_RR, n_total_rr + 1)))
+                    return ierr;
                   total_rr[n_total_rr].nion = n;  //put the ion number into the bad_t_rr structure
                   ions[n].nxtotalrr = n_total_rr; /*put the number of the bad_t_rr into the ion
                                                      structure so we can go either way. */
                   total_rr[n_total_rr].type = RRTYPE_SHULL;
                   for(n1 = 0; n1 < nparam; n1++)
                   {
-                    total_rr[n_total_rr].params[n1] = btrr[n1]; //we are getting  parameters
+                    total_rr[n_total_rr].params[n1] = values.list.values[n1]; //we are getting  parameters
                   }
                   ions[n].total_rrflag++; //increment the flag by 1. We will do this rather than simply setting it to 1 so we will get errors if we do this more than once....
                   n_total_rr++; //increment the counter of number of dielectronic recombination parameter sets
@@ -3111,7 +3246,10 @@ would like to have simple lines for macro-ions */
  */
 
           case 'G':
-            nparam = sscanf(aline, "%*s %s %d %d %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le", &gsflag, &z, &ne, &gstemp[0], &gstemp[1], &gstemp[2], &gstemp[3], &gstemp[4], &gstemp[5], &gstemp[6], &gstemp[7], &gstemp[8], &gstemp[9], &gstemp[10], &gstemp[11], &gstemp[12], &gstemp[13], &gstemp[14], &gstemp[15], &gstemp[16], &gstemp[17], &gstemp[18]);  //split and assign the line
+            nparam = values.list.nwords;
+            gsflag = values.list.flag;
+            z = values.list.z;
+            ne = values.list.istate;
             nparam -= 3;        //take 4 off the nparam to give the number of actual parameters
             if(nparam > 19 || nparam < 1) //     trap errors - not as robust as usual because there are a varaible number of parameters...
             {
@@ -3126,6 +3264,8 @@ would like to have simple lines for macro-ions */
               {
                 if(ions[n].bad_gs_rr_t_flag == 0 && ions[n].bad_gs_rr_r_flag == 0)  //This is first set of this type of data for this ion
                 {
+                  if((ierr = reserve_atomic_table(TABLE_BAD_GS_RR, n_bad_gs_rr + 1)))
+                    return ierr;
                   bad_gs_rr[n_bad_gs_rr].nion = n;  //put the ion number into the bad_t_rr structure
                   ions[n].nxbadgsrr = n_bad_gs_rr;  //put the number of the bad_t_rr into the ion structure so we can go either way.
                   n_bad_gs_rr++;  //increment the counter of number of ground state RR
@@ -3135,14 +3275,14 @@ would like to have simple lines for macro-ions */
                 {
                   if(ions[n].bad_gs_rr_t_flag == 0) //and we need a temp line for this ion
                   {
-                    if(gstemp[0] > gstmin)
-                      gstmin = gstemp[0];
-                    if(gstemp[18] < gstmax)
-                      gstmax = gstemp[18];
+                    if(values.list.values[0] > gstmin)
+                      gstmin = values.list.values[0];
+                    if(values.list.values[18] < gstmax)
+                      gstmax = values.list.values[18];
                     ions[n].bad_gs_rr_t_flag = 1; //set the flag
                     for(n1 = 0; n1 < nparam; n1++)
                     {
-                      bad_gs_rr[ions[n].nxbadgsrr].temps[n1] = gstemp[n1];
+                      bad_gs_rr[ions[n].nxbadgsrr].temps[n1] = values.list.values[n1];
                     }
                   }
                   else if(ions[n].bad_gs_rr_t_flag == 1)  //we already have a temp line for this ion
@@ -3164,7 +3304,7 @@ would like to have simple lines for macro-ions */
                     ions[n].bad_gs_rr_r_flag = 1; //set the flag
                     for(n1 = 0; n1 < nparam; n1++)
                     {
-                      bad_gs_rr[ions[n].nxbadgsrr].rates[n1] = gstemp[n1];
+                      bad_gs_rr[ions[n].nxbadgsrr].rates[n1] = values.list.values[n1];
                     }
                   }
                   else if(ions[n].bad_gs_rr_r_flag == 1)  //we already have a rate line for this ion
@@ -3208,20 +3348,22 @@ would like to have simple lines for macro-ions */
 
  */
           case 'g':
-            nparam = sscanf(aline, "%*s %le %le %le %le %le", &gsqrdtemp, &gfftemp, &s1temp, &s2temp, &s3temp); //split and assign the line
+            nparam = values.list.nwords;
             if(nparam > 5 || nparam < 1)  //     trap errors
             {
               logfile("Something wrong with sutherland gaunt data\n");
               logfile("Get_atomic_data: %s\n", aline);
               return ATOMIC_ERROR_TODO;
             }
-            if(gaunt_n_gsqrd == 0 || gsqrdtemp > gaunt_total[gaunt_n_gsqrd - 1].log_gsqrd)  //We will use it if it's our first piece of data or is in order
+            if(gaunt_n_gsqrd == 0 || values.list.values[0] > gaunt_total[gaunt_n_gsqrd - 1].log_gsqrd)  //We will use it if it's our first piece of data or is in order
             {
-              gaunt_total[gaunt_n_gsqrd].log_gsqrd = gsqrdtemp; //The scaled electron temperature squared for this array
-              gaunt_total[gaunt_n_gsqrd].gff = gfftemp;
-              gaunt_total[gaunt_n_gsqrd].s1 = s1temp;
-              gaunt_total[gaunt_n_gsqrd].s2 = s2temp;
-              gaunt_total[gaunt_n_gsqrd].s3 = s3temp;
+              if((ierr = reserve_atomic_table(TABLE_GAUNT_TOTAL, gaunt_n_gsqrd + 1)))
+                return ierr;
+              gaunt_total[gaunt_n_gsqrd].log_gsqrd = values.list.values[0]; //The scaled electron temperature squared for this array
+              gaunt_total[gaunt_n_gsqrd].gff = values.list.values[1];
+              gaunt_total[gaunt_n_gsqrd].s1 = values.list.values[2];
+              gaunt_total[gaunt_n_gsqrd].s2 = values.list.values[3];
+              gaunt_total[gaunt_n_gsqrd].s3 = values.list.values[4];
               gaunt_n_gsqrd++;
             }
             else
@@ -3248,7 +3390,12 @@ would like to have simple lines for macro-ions */
  * #Column rho1 -rho20   (F8.4)  ? Scaled rate coefficient 1 (2) [ucd=arith.rate;phys.atmol.collisional]
  */
           case 'd':
-            nparam = sscanf(aline, "%*s %d %d %d %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le", &z, &istate, &nspline, &et, &tmin, &temp[0], &temp[1], &temp[2], &temp[3], &temp[4], &temp[5], &temp[6], &temp[7], &temp[8], &temp[9], &temp[10], &temp[11], &temp[12], &temp[13], &temp[14], &temp[15], &temp[16], &temp[17], &temp[18], &temp[19], &temp[20], &temp[21], &temp[22], &temp[23], &temp[24], &temp[25], &temp[26], &temp[27], &temp[28], &temp[29], &temp[30], &temp[31], &temp[32], &temp[33], &temp[34], &temp[35], &temp[36], &temp[37], &temp[38], &temp[39]);  //split and assign the line
+            nparam = values.list.nwords;
+            z = values.list.z;
+            istate = values.list.istate;
+            nspline = values.list.w;
+            et = values.list.values[0];
+            tmin = values.list.values[1];
 
             if(nparam != 5 + (nspline * 2)) //     trap errors
             {
@@ -3262,6 +3409,8 @@ would like to have simple lines for macro-ions */
               {
                 if(ions[n].dere_di_flag == 0) //This is first set of this type of data for this ion
                 {
+                  if((ierr = reserve_atomic_table(TABLE_DERE_DI_RATE, n_dere_di_rate + 1)))
+                    return ierr;
                   ions[n].dere_di_flag = 1;
                   dere_di_rate[n_dere_di_rate].nion = n;  //put the ion number into the dere_di_rate structure
                   ions[n].nxderedi = n_dere_di_rate;  //put the number of the dere_di_rate into the ion structure so we can go either way.
@@ -3270,8 +3419,8 @@ would like to have simple lines for macro-ions */
                   dere_di_rate[n_dere_di_rate].nspline = nspline;
                   for(n1 = 0; n1 < nspline; n1++)
                   {
-                    dere_di_rate[n_dere_di_rate].temps[n1] = temp[n1];
-                    dere_di_rate[n_dere_di_rate].rates[n1] = temp[n1 + nspline] * 1e-6;
+                    dere_di_rate[n_dere_di_rate].temps[n1] = values.list.values[n1 + 2];
+                    dere_di_rate[n_dere_di_rate].rates[n1] = values.list.values[n1 + nspline + 2] * 1e-6;
 
                   }
                   n_dere_di_rate++; //increment the counter of number of ground state RR
@@ -3299,11 +3448,13 @@ would like to have simple lines for macro-ions */
 */
 
           case 'K':
-            nparam =
-              sscanf(aline,
-                     "%*s %d %d %d %d %le %le %le %le %le %le %le %le %le %le %le %le",
-                     &z, &istate, &in, &il, &I, &Ea, &temp[0],
-                     &temp[1], &temp[2], &temp[3], &temp[4], &temp[5], &temp[6], &temp[7], &temp[8], &temp[9]);
+            nparam = values.inner_yield.nwords;
+            z = values.inner_yield.z;
+            istate = values.inner_yield.istate;
+            in = values.inner_yield.n;
+            il = values.inner_yield.l;
+            I = values.inner_yield.I;
+            Ea = values.inner_yield.Ea;
             if(nparam != 16)
             {
               logfile("Something wrong with electron yield data\n");
@@ -3317,6 +3468,8 @@ would like to have simple lines for macro-ions */
               {
                 if(inner_cross[n].n_elec_yield == -1) /*This is the first yield data for this vacancy */
                 {
+                  if((ierr = reserve_atomic_table(TABLE_INNER_ELEC_YIELD, n_elec_yield_tot + 1)))
+                    return ierr;
                   inner_elec_yield[n_elec_yield_tot].nion = n;  /*This yield refers to this ion */
                   inner_cross[n].n_elec_yield = n_elec_yield_tot;
                   inner_elec_yield[n_elec_yield_tot].z = z;
@@ -3327,7 +3480,7 @@ would like to have simple lines for macro-ions */
                   inner_elec_yield[n_elec_yield_tot].Ea = Ea * EV2ERGS;
                   for(n1 = 0; n1 < 10; n1++)
                   {
-                    inner_elec_yield[n_elec_yield_tot].prob[n1] = temp[n1] / 10000.0;
+                    inner_elec_yield[n_elec_yield_tot].prob[n1] = values.inner_yield.prob[n1] / 10000.0;
                   }
                   n_elec_yield_tot++;
                 }
@@ -3410,11 +3563,24 @@ SCUPS    1.132e-01   2.708e-01   5.017e-01   8.519e-01   1.478e+00
  *		  */
 
           case 'C':
-            nparam =
-              (sscanf
-               (aline,
-                "%*s %*s %d %2d %le %le %le %le %le %le %d %d %d %d %le %le %le %d %d %le",
-                &z, &istate, &freq, &f, &gl, &gu, &el, &eu, &levl, &levu, &c_l, &c_u, &en, &gf, &hlt, &np, &type, &sp));
+            nparam = values.coll_stren.nwords;
+            z = values.coll_stren.z;
+            istate = values.coll_stren.istate;
+            f = values.coll_stren.f;
+            gl = values.coll_stren.gl;
+            gu = values.coll_stren.gu;
+            el = values.coll_stren.el;
+            eu = values.coll_stren.eu;
+            levl = values.coll_stren.levl;
+            levu = values.coll_stren.levu;
+            c_l = values.coll_stren.c_l;
+            c_u = values.coll_stren.c_u;
+            en = values.coll_stren.en;
+            gf = values.coll_stren.gf;
+            hlt = values.coll_stren.hlt;
+            np = values.coll_stren.np;
+            type = values.coll_stren.type;
+            sp = values.coll_stren.sp;
             if(nparam != 18)
             {
               logfile("Get_atomic_data: file %s line %d: Collision strength line incorrectly formatted\n", file,
@@ -3425,79 +3591,80 @@ SCUPS    1.132e-01   2.708e-01   5.017e-01   8.519e-01   1.478e+00
             match = 0;
             for(n = 0; n < nlines; n++) //loop over all the lines we have read in - look for a match
             {
-              if(line[n].z == z && line[n].istate == istate
-                 && line[n].levl == levl && line[n].levu == levu && line[n].gl == gl && line[n].gu == gu
-                 && line[n].f == f)
+              if(AtomixConfiguration.lines_streamed)
               {
-                if(line[n].coll_index > -1) //We already have a collision strength record from this line - throw an error and quit
-                {
-                  logfile("Get_atomic_data More than one collision strength record for line %i\n", n);
-                  return ATOMIC_ERROR_TODO;
-                }
-                match = 1;
-                coll_stren[n_coll_stren].n = n_coll_stren;
-                coll_stren[n_coll_stren].lower = c_l;
-                coll_stren[n_coll_stren].upper = c_u;
-                coll_stren[n_coll_stren].energy = en;
-                coll_stren[n_coll_stren].gf = gf;
-                coll_stren[n_coll_stren].hi_t_lim = hlt;
-                coll_stren[n_coll_stren].n_points = np;
-                coll_stren[n_coll_stren].type = type;
-                coll_stren[n_coll_stren].scaling_param = sp;
-
-                line[n].coll_index = n_coll_stren;  //point the line to its matching collision strength
-
-                //We now read in two lines of fitting data
-                if(fgets(aline, LINELENGTH, fptr) == NULL)
-                {
-                  logfile("Get_atomic_data: Problem reading collision strength record\n");
-                  logfile("Get_atomic_data: %s\n", aline);
-                  return ATOMIC_ERROR_TODO;
-                }
+                /* Only decode the lines which could match, which there is usually only one of */
+                if(ions[line_index[n].nion].z != z || ions[line_index[n].nion].istate != istate
+                   || line_index[n].levl != levl || line_index[n].levu != levu)
+                  continue;
+                streamed_line = decode_streamed_line(&line_index[n]);
+                if(streamed_line->gl != gl || streamed_line->gu != gu || streamed_line->f != f)
+                  continue;
+                coll_index = &line_index[n].coll_index;
+              }
+              else
+              {
+                if(line[n].z != z || line[n].istate != istate
+                   || line[n].levl != levl || line[n].levu != levu || line[n].gl != gl || line[n].gu != gu
+                   || line[n].f != f)
+                  continue;
+                coll_index = &line[n].coll_index;
+              }
+
+              if(*coll_index > -1)  //We already have a collision strength record from this line - throw an error and quit
+              {
+                logfile("Get_atomic_data More than one collision strength record for line %i\n", n);
+                return ATOMIC_ERROR_TODO;
+              }
+              if((ierr = reserve_atomic_table(TABLE_COLL_STREN, n_coll_stren + 1)))
+                return ierr;
+              match = 1;
+              coll_stren[n_coll_stren].n = n_coll_stren;
+              coll_stren[n_coll_stren].lower = c_l;
+              coll_stren[n_coll_stren].upper = c_u;
+              coll_stren[n_coll_stren].energy = en;
+              coll_stren[n_coll_stren].gf = gf;
+              coll_stren[n_coll_stren].hi_t_lim = hlt;
+              coll_stren[n_coll_stren].n_points = np;
+              coll_stren[n_coll_stren].type = type;
+              coll_stren[n_coll_stren].scaling_param = sp;
+
+              *coll_index = n_coll_stren; //point the line to its matching collision strength
+
+              //We now read in two lines of fitting data
+              if((record = read_atomic_data_record(afile, aline)) == NULL)
+              {
+                logfile("Get_atomic_data: Problem reading collision strength record\n");
+                logfile("Get_atomic_data: %s\n", aline);
+                return ATOMIC_ERROR_TODO;
+              }
 
-                /* JM 1709 -- increased number of entries read up to max of 20 */
-                nparam =
-                  sscanf(aline,
-                         "%*s %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le",
-                         &temp[0], &temp[1], &temp[2], &temp[3],
-                         &temp[4], &temp[5], &temp[6], &temp[7],
-                         &temp[8], &temp[9], &temp[10], &temp[11],
-                         &temp[12], &temp[13], &temp[14], &temp[15], &temp[16], &temp[17], &temp[18], &temp[19]);
+              /* JM 1709 -- increased number of entries read up to max of 20 */
+              read_atomic_record_values(afile, record, SPLINE_RECORD, aline, &values);
 
-                for(nn = 0; nn < np; nn++)
-                {
-                  coll_stren[n_coll_stren].sct[nn] = temp[nn];
-                }
-                if(fgets(aline, LINELENGTH, fptr) == NULL)
-                {
-                  logfile("Get_atomic_data: Problem reading collision strength record\n");
-                  logfile("Get_atomic_data: %s\n", aline);
-                  return ATOMIC_ERROR_TODO;
-                }
+              for(nn = 0; nn < np; nn++)
+              {
+                coll_stren[n_coll_stren].sct[nn] = values.list.values[nn];
+              }
+              if((record = read_atomic_data_record(afile, aline)) == NULL)
+              {
+                logfile("Get_atomic_data: Problem reading collision strength record\n");
+                logfile("Get_atomic_data: %s\n", aline);
+                return ATOMIC_ERROR_TODO;
+              }
 
-                nparam =
-                  sscanf(aline,
-                         "%*s %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le",
-                         &temp[0], &temp[1], &temp[2], &temp[3],
-                         &temp[4], &temp[5], &temp[6], &temp[7],
-                         &temp[8], &temp[9], &temp[10], &temp[11],
-                         &temp[12], &temp[13], &temp[14], &temp[15], &temp[16], &temp[17], &temp[18], &temp[19]);
+              read_atomic_record_values(afile, record, SPLINE_RECORD, aline, &values);
 
-                for(nn = 0; nn < np; nn++)
-                {
-                  coll_stren[n_coll_stren].scups[nn] = temp[nn];
-                }
-                n_coll_stren++;
+              for(nn = 0; nn < np; nn++)
+              {
+                coll_stren[n_coll_stren].scups[nn] = values.list.values[nn];
               }
+              n_coll_stren++;
             }
             if(match == 0)      //Fix for an error where a line match isn't found - this then causes the next two lines to be skipped
             {
-              char *ret1 = fgets(aline, LINELENGTH, fptr);
-              char *ret2 = fgets(aline, LINELENGTH, fptr);
-              if(ret1 == NULL || ret2 == NULL)  // Lazy solution to avoid compiler warnings
-              {
-                ;
-              }
+              read_atomic_data_record(afile, aline);
+              read_atomic_data_record(afile, aline);
               cstren_no_line++;
             }
             break;
@@ -3513,16 +3680,13 @@ SCUPS    1.132e-01   2.708e-01   5.017e-01   8.519e-01   1.478e+00
         strcpy(aline, "");
       }
 
-      fclose(fptr);
+      free_staged_atomic_data_file(afile);
     }
     /*End of do loop for reading a particular file of data */
   }
 
-/* End of main do loop for reading all of the the data. At this point we can close
-   the masterfile
- */
+/* End of main do loop for reading all of the the data */
 
-  fclose(mptr);
 /* OK now summarize the data that has been read*/
 
   n_elec_yield_tot = 0;         //Reset this numnber, we are now going to use it to check we have yields for all inner shells
@@ -3556,7 +3720,7 @@ SCUPS    1.132e-01   2.708e-01   5.017e-01   8.519e-01   1.478e+00
   atomic_summary_add("The minimum frequency for inner shell ionization is %8.2e", inner_freq_min);
 
   /* report ignored simple lines for macro-ions */
-  for(n = 0; n < NIONS; n++)
+  for(n = 0; n < nions; n++)
   {
     if(simple_line_ignore[n] > 0)
       atomic_summary_add("Ignored %d simple lines for macro-ion %d", simple_line_ignore[n], n);
@@ -3592,7 +3756,7 @@ exit if there is an element with no ions */
   for(nelem = 0; nelem < nelements; nelem++)
   {
     n = 0;
-    while(ions[n].z != ele[nelem].z && n < nions)
+    while(n < nions && ions[n].z != ele[nelem].z)
       n++;                      /* Find the first ion of that element for which there is data */
 
     ele[nelem].firstion = n;
@@ -3601,7 +3765,7 @@ exit if there is an element with no ions */
     /* find the highest ion stage and the number of ions */
     ele[nelem].istate_max = ions[n].istate;
 
-    while(ions[n].z == ele[nelem].z && n < nions)
+    while(n < nions && ions[n].z == ele[nelem].z)
     {
       if(ele[nelem].istate_max < ions[n].istate)
         ele[nelem].istate_max = ions[n].istate;
@@ -3620,44 +3784,19 @@ exit if there is an element with no ions */
   }
 
 
-/* Now attempt to associate lines with levels. If an association is found use, create
-a total emission oscillator strength for the level....really ought to be radiative lifefime */
+/* Now attempt to associate lines with levels. The total radiative rate of the upper level of each line
+is added up from the Einstein coefficients in line_columns by index_line_rates, once the lines are indexed */
 
 
 /* This next loop is connects levels to configurations for "simple atoms".
  For Macro Atoms files, the data files already contain this infomration and
- so the check is avoided by checking tte macro_info flag SS
+ so the check is avoided by checking tte macro_info flag SS. A streamed line
+ is matched to its levels when it is decoded
 */
 
-
-
-  for(n = 0; n < nlines; n++)
-  {
-    if(ions[line[n].nion].macro_info == 0)  // not a macro atom (SS)
-    {
-      mstart = ions[line[n].nion].firstlevel;
-      mstop = mstart + ions[line[n].nion].nlevels;
-
-      m = mstart;
-      while(config[m].ilv != line[n].levl && m < mstop)
-        m++;
-      if(m < mstop)
-        line[n].nconfigl = m;
-      else
-        line[n].nconfigl = -9999;
-
-      m = mstart;
-      while(config[m].ilv != line[n].levu && m < mstop)
-        m++;
-      if(m < mstop)
-      {
-        line[n].nconfigu = m;
-        config[m].rad_rate += a21(&line[n]);
-      }
-      else
-        line[n].nconfigu = -9999;
-    }
-  }
+  if(!AtomixConfiguration.lines_streamed)
+    for(n = 0; n < nlines; n++)
+      match_line_to_levels(&line[n]);
 
 /* Check that all of the macro_info variables are initialized to 1
 or zero so that simple checks of true and false can be used for them */
@@ -3680,7 +3819,7 @@ or zero so that simple checks of true and false can be used for them */
     }
   }
 
-  for(n = 0; n < nlines; n++)
+  for(n = 0; n < nlines && !AtomixConfiguration.lines_streamed; n++)
   {
     if(line[n].macro_info == -1)
     {
@@ -3701,14 +3840,10 @@ or zero so that simple checks of true and false can be used for them */
 
 /* Finally evaluate how close we are to limits set in the structures */
 
-  atomic_summary_add("get_atomic_data: Evaluation:  There are %6d elements     while %6d are currently allowed",
-                     nelements, NELEMENTS);
-  atomic_summary_add("get_atomic_data: Evaluation:  There are %6d ions         while %6d are currently allowed", nions,
-                     NIONS);
-  atomic_summary_add("get_atomic_data: Evaluation:  There are %6d levels       while %6d are currently allowed",
-                     nlevels, NLEVELS);
-  atomic_summary_add("get_atomic_data: Evaluation:  There are %6d lines        while %6d are currently allowed", nlines,
-                     NLINES);
+  atomic_summary_add("get_atomic_data: Evaluation:  There are %6d elements", nelements);
+  atomic_summary_add("get_atomic_data: Evaluation:  There are %6d ions", nions);
+  atomic_summary_add("get_atomic_data: Evaluation:  There are %6d levels", nlevels);
+  atomic_summary_add("get_atomic_data: Evaluation:  There are %6d lines", nlines);
   atomic_summary_add("get_atomic_data: Evaluation:  There are %6d macro levels while %6d are currently allowed",
                      nlevels_macro, NLEVELS_MACRO);
 
@@ -3784,13 +3919,14 @@ or zero so that simple checks of true and false can be used for them */
 
     for(n = 0; n < nlines; n++)
     {
-      fprintf(fptr, "n %3d ion %3d freq %8.1e f %6.3f\n", n, line[n].nion, line[n].freq, line[n].f);
+      streamed_line = AtomixConfiguration.lines_streamed ? decode_streamed_line(&line_index[n]) : &line[n];
+      fprintf(fptr, "n %3d ion %3d freq %8.1e f %6.3f\n", n, streamed_line->nion, streamed_line->freq, streamed_line->f);
     }
 
     /* Write the ground fraction data to the file */
     fprintf(fptr, "Ground frac data (just first and last fracs here as a check):\n");
 
-    for(n = 0; n < NIONS; n++)
+    for(n = 0; n < nions; n++)
     {
       fprintf(fptr, "%3d %3d %6.3f %6.3f\n", ground_frac[n].z, ground_frac[n].istate, ground_frac[n].frac[0],
               ground_frac[n].frac[19]);
@@ -3805,21 +3941,184 @@ or zero so that simple checks of true and false can be used for them */
    * of the atomic data
    */
 
+  clock_gettime(CLOCK_MONOTONIC, &sort_start);
+
   /* Index the lines */
-  index_lines();
+  if((ierr = index_lines()))
+    return ierr;
 
 /* Index the topbase photoionization structure by threshold freqeuncy */
-  if(ntop_phot + nxphot > 0)
-    index_phot_top();
+  if(ntop_phot + nxphot > 0 && (ierr = index_phot_top()))
+    return ierr;
 /* Index the topbase photoionization structure by threshold freqeuncy */
-  if(n_inner_tot > 0)
-    index_inner_cross();
+  if(n_inner_tot > 0 && (ierr = index_inner_cross()))
+    return ierr;
+
+  clock_gettime(CLOCK_MONOTONIC, &sort_end);
+  loader->sort_ms = 1e3 * (sort_end.tv_sec - sort_start.tv_sec) + 1e-6 * (sort_end.tv_nsec - sort_start.tv_nsec);
+
+  /* Make the threshold and coverage indices of the edges, and the lists of lines and edges for each ion and
+     element */
+  if((ierr = index_edge_thresholds()) || (ierr = index_edge_coverage()) || (ierr = index_postings()))
+    return ierr;
+
+  if((ierr = index_gaunt_segments()))
+    return ierr;
+
+  log_atomic_tables();
 
 
   check_xsections();            // add_error_to_log routine, only prints if verbosity > 4
 
-  free(sub_atomic_data_file_path);
-  free(atomic_data_file_path);
+  return (0);
+}
+
+/**********************************************************/
+/**
+ * @brief      generalized subroutine for reading atomic data
+ *  	into a set of structures defined in "atomic.h"
+ *
+ *
+ * @param [in] char  masterfile[]   The name of the "masterfile" which refers to other files which contain the data
+ * @param [in] int   use_relative   If TRUE, the paths to the masterfile and the files in it are used as is
+ * @return     0 on success, otherwise an ATOMIC error code
+ *
+ * @details
+ *
+ * get_atomic_data reads in all the atomic data.  It also converts the data to cgs units unless
+ * 	otherwise noted, e.g ionization potentials are converted to ergs.
+ *
+ *
+ *
+ * The masterfile is a list of other files, which contain atomic data for specific puruposes.
+ *
+ * All of the files are ascii.  The information is keyword based.
+ *
+ * The order of the data is important.  Elements should be defined before ions; ions
+ * before levels, levels before  lines etc.  In most if not all cases, one can either define all
+ * of the elements first, all of the ions, etc ... or the first element and its ions, the
+ * second element and its ions etc. Commenting out an element in the datafile has the effect of
+ * eliminating all of the data associated with that element, e.g ions, lines, etc.
+ *
+ * The program assumes that the ions for a given element are grouped together,
+ * that the levels for a given element are grouped together, etc.
+ *
+ * If one wants to read both Topbase and VFKY photoionization x-sections, then the topbase
+ * x-sections should be read first.  The routine will ignore data in the VFKY list if there
+ * is a pre-existing Topbase data.  The routine will stop if you but a VFKY x-section first
+ * on the assumption that Topbase data should trump VFKY data. (Making the program more flexible
+ * would be difficult because you would have to drop various bits of Topbase data out of the
+ * middle of the structure or mark it NG or something.)
+ *
+ * Similarly, as a general rule the macro information should be provided before the simple
+ * ions are described, and the macro lines should be presented before simple lines.
+ *
+ * The only data which can be mixed up completely is the line array.
+ *
+ * Finally, get_atomic_data creates a pointer array to  lines, which has the lines in
+ * frequency ascending order.   This is actually done by a small subroutine index_lines
+ * which in turn calls a Numerical Recipes routine.
+ *
+ * The files in the masterfile are read into memory, split into records and parsed in parallel
+ * by the loader in atomic_loader.c, but the records are interpreted by read_atomic_data one file
+ * at a time in masterfile order, so the order of the data matters exactly as described above.
+ *
+ * Once the data has been read in, a snapshot of it is saved by atomic_cache.c and this is
+ * used instead of reading the files again, until one of them changes.
+ *
+ * ### Notes ###
+ *
+ * get_atomic data is intended to be stand-alone, that is one should be able to use it for routines
+ * other than Python, e.g for another routine intended to calculate the ionization state of
+ * a plasma in collisional equilibrium.
+ *
+ * To this end, the routines populate stuctures in atomic.h, which are not part of python.h, and
+ * one should avoid calling routines like Exit(0) that are very python centric.  It's important
+ * that future modifications to get_atomic_data maintain this independence.
+ *
+ *
+ *
+ **********************************************************/
+
+int
+get_atomic_data(char *masterfile, int use_relative)
+{
+  int n;
+  int error;
+  long nbytes;
+  double elapsed;
+  FILE *mptr;
+  char atomic_data_file_path[LINELENGTH];
+  struct timespec start, end;
+  AtomicLoader_t loader;
+
+  AtomixConfiguration.atomic_data_loaded = FALSE;
+  AtomixConfiguration.lines_streamed = getenv("ATOMIX_STREAM_LINES") != NULL;
+
+/* Use the binary snapshot of this atomic data, if none of the files it was made from have changed */
+
+  release_atomic_data_cache();
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  if(load_atomic_data_cache(masterfile, use_relative) == 0)
+  {
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    atomic_summary_add("Loaded atomic data from the cache in %.2f ms",
+                       1e3 * (end.tv_sec - start.tv_sec) + 1e-6 * (end.tv_nsec - start.tv_nsec));
+    AtomixConfiguration.atomic_data_loaded = TRUE;
+    return (0);
+  }
+
+  if(strcmp(masterfile, "") == 0)
+  {
+    return ATOMIC_FILE_IO_ERROR;
+  }
+
+  if(get_atomic_data_path(masterfile, use_relative, TRUE, atomic_data_file_path))
+  {
+    logfile("Unable to find $PYTHON environment variable.\n");
+    return ATOMIC_ENVRIONMENT_ERROR;
+  }
+
+  if((mptr = fopen(atomic_data_file_path, "r")) == NULL)
+  {
+    logfile("Get_atomic_data: Could not find atomic data %s\n", atomic_data_file_path);
+    return ATOMIC_FILE_IO_ERROR;
+  }
+
+/* Start reading the files in the masterfile in the background, while the structures are set up */
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  error = start_atomic_data_loader(&loader, mptr, use_relative);
+  fclose(mptr);
+
+  if(!error)
+  {
+    atomic_summary_add("Reading atomic data from %s", atomic_data_file_path);
+    error = read_atomic_data(&loader);
+  }
+
+  if(!error)
+  {
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    elapsed = (end.tv_sec - start.tv_sec) + 1e-9 * (end.tv_nsec - start.tv_nsec);
+    for(n = 0, nbytes = 0; n < loader.nfiles; n++)
+      nbytes += loader.files[n].size;
+    logfile("Get_atomic_data: Parsed %.2f MB in %.3f s (%.1f MB/s)\n", nbytes / 1e6, elapsed,
+            elapsed > 0 ? nbytes / 1e6 / elapsed : 0.0);
+  }
+
+  stop_atomic_data_loader(&loader);
+
+  if(error)
+    return error;
+
+  save_atomic_data_cache(masterfile, use_relative);
+
+/* The sort time is only added to the summary once the snapshot has been saved, so it is never shown for a later
+   load from the cache, when nothing was sorted */
+
+  atomic_summary_add("Sorted %d lines and %d cross sections by frequency in %.2f ms", nlines,
+                     ntop_phot + nxphot + n_inner_tot, loader.sort_ms);
 
   AtomixConfiguration.atomic_data_loaded = TRUE;
 
@@ -0,0 +1,713 @@
+/* ************************************************************************** */
+/**
+ * @file     atomic_loader.c
+ *
+ * @brief
+ *
+ * Functions for reading the files listed in a masterfile in parallel.
+ *
+ * @details
+ *
+ * Most of the work in reading atomic data is reading each file, splitting it
+ * into records and parsing the numbers in each record. None of this depends on
+ * the data in any other file, so it is done for every file in the masterfile at
+ * once by a pool of worker threads. Each worker stages a file into memory,
+ * splits it into records, works out the type of each record and parses its
+ * values, including the points of the cross sections.
+ *
+ * What the records mean does depend on the files read before, e.g. ions must
+ * be read after elements. The parsed values are therefore still merged into
+ * the atomic data by get_atomic_data one file at a time in masterfile order,
+ * so the data read in is exactly the same as if each file had been read in
+ * turn.
+ *
+ * ************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "atomix.h"
+
+#define LINELENGTH 400
+
+/* ************************************************************************** */
+/**
+ * @brief  Split a staged file into records
+ *
+ * @param[in, out]  afile  The file to split, which has been read into memory
+ * @param[in]       size   The size of the file in bytes
+ *
+ * @return  0 on success, or -1 if there was not enough memory
+ *
+ * @details
+ *
+ * Records are split exactly as fgets would split them with a buffer of
+ * LINELENGTH characters, so a line which is too long is split into more than
+ * one record.
+ *
+ * ************************************************************************** */
+
+static int
+split_records(AtomicFile_t *afile, long size)
+{
+  int i;
+  int nalloc = 0;
+  long start = 0;
+  long end;
+  char *c;
+  char word[LINELENGTH];
+  AtomicRecord_t *record;
+  AtomicRecord_t *new_records;
+
+  afile->nrecords = 0;
+
+  while(start < size)
+  {
+    if(afile->nrecords == nalloc)
+    {
+      nalloc = nalloc ? 2 * nalloc : 1024;
+      if((new_records = realloc(afile->records, nalloc * sizeof(*new_records))) == NULL)
+        return -1;
+      afile->records = new_records;
+    }
+
+    if((c = memchr(afile->buffer + start, '\n', size - start)) != NULL)
+      end = c - afile->buffer + 1;
+    else
+      end = size;
+    if(end - start > LINELENGTH - 1)
+      end = start + LINELENGTH - 1;
+
+    record = &afile->records[afile->nrecords++];
+    record->start = start;
+    record->len = end - start;
+    record->has_points = FALSE;
+    record->parsed = 0;
+
+    for(i = 0; i < record->len && isspace((unsigned char) afile->buffer[start + i]); i++)
+      ;
+    record->word_start = i;
+    for(; i < record->len && !isspace((unsigned char) afile->buffer[start + i]); i++)
+      ;
+    record->word_len = i - record->word_start;
+
+    memcpy(word, afile->buffer + start + record->word_start, record->word_len);
+    word[record->word_len] = '\0';
+    record->choice = classify_atomic_data_record(word);
+
+    start = end;
+  }
+
+  return 0;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Parse the values in a record
+ *
+ * @param[in]   aline   The text of the record
+ * @param[in]   choice  The type of the record
+ * @param[out]  values  The values read from the record
+ *
+ * @return  The number of bytes of values which were filled in, or 0 if this
+ *          type of record has no values
+ *
+ * @details
+ *
+ * The formats are those which read_atomic_data used to read each record with
+ * itself. This is called by the worker threads for every record they stage,
+ * and by read_atomic_data for a record which was not parsed as the type it
+ * turns out to be.
+ *
+ * ************************************************************************** */
+
+int
+parse_atomic_data_record(char *aline, char choice, AtomicValues_t *values)
+{
+  int size;
+  double *v;
+  struct lines l;
+
+  switch(choice)
+  {
+    case 'e':
+      memset(&values->element, 0, sizeof(values->element));
+      values->element.nwords = scan_atomic_record(aline, "%*s %d %s %le", &values->element.z, values->element.name,
+                                                  &values->element.abun);
+      return sizeof(values->element);
+    case 'i':
+      memset(&values->ion, 0, sizeof(values->ion));
+      values->ion.nwords = scan_atomic_record(aline, "%*s %*s %d %d %le %le %d %d", &values->ion.z,
+                                              &values->ion.istate, &values->ion.g, &values->ion.ip, &values->ion.nmax,
+                                              &values->ion.nlte);
+      return sizeof(values->ion);
+    case 'N':
+      memset(&values->level, 0, sizeof(values->level));
+      if(strncmp(skip_whitespace(aline), "LevTop", 6) == 0)
+        values->level.nwords = scan_atomic_record(aline, "%*s %d %d %d %d %le %le %le %le %le", &values->level.z,
+                                                  &values->level.istate, &values->level.islp, &values->level.ilv,
+                                                  &values->level.e, &values->level.ex, &values->level.g,
+                                                  &values->level.q_num, &values->level.rl);
+      else
+        values->level.nwords = scan_atomic_record(aline, "%*s %d %d %d %le %le %le %le", &values->level.z,
+                                                  &values->level.istate, &values->level.ilv, &values->level.e,
+                                                  &values->level.ex, &values->level.g, &values->level.rl);
+      return sizeof(values->level);
+    case 'n':
+      memset(&values->level, 0, sizeof(values->level));
+      if((values->level.nwords = scan_atomic_record(aline, "%*s %d %d %d %le %le\n", &values->level.z,
+                                                    &values->level.istate, &values->level.ilv, &values->level.g,
+                                                    &values->level.ex)) != 5)
+      {
+        values->level.z = values->level.istate = 0;
+        values->level.nwords = scan_atomic_record(aline, "%*s  %d %le %le\n", &values->level.ilv, &values->level.g,
+                                                  &values->level.ex);
+      }
+      return sizeof(values->level);
+    case 'w':
+    case 'I':
+      memset(&values->xsection, 0, sizeof(values->xsection));
+      values->xsection.nwords = scan_atomic_record(aline, "%*s %d %d %d %d %le %d\n", &values->xsection.z,
+                                                   &values->xsection.istate, &values->xsection.lower,
+                                                   &values->xsection.upper, &values->xsection.ex, &values->xsection.np);
+      return sizeof(values->xsection);
+    case 'r':
+      memset(&values->line, 0, sizeof(values->line));
+      if((values->line.nwords = scan_line_record(aline, &l)) == 6 || values->line.nwords == 8
+         || values->line.nwords == 10)
+      {
+        values->line.z = l.z;
+        values->line.istate = l.istate;
+        values->line.levl = l.levl;
+        values->line.levu = l.levu;
+        values->line.freq = l.freq;
+        values->line.f = l.f;
+        values->line.gl = l.gl;
+        values->line.gu = l.gu;
+        values->line.el = l.el;
+        values->line.eu = l.eu;
+      }
+      return sizeof(values->line);
+    case 'K':
+      memset(&values->inner_yield, 0, sizeof(values->inner_yield));
+      v = values->inner_yield.prob;
+      values->inner_yield.nwords =
+        scan_atomic_record(aline, "%*s %d %d %d %d %le %le %le %le %le %le %le %le %le %le %le %le",
+                           &values->inner_yield.z, &values->inner_yield.istate, &values->inner_yield.n,
+                           &values->inner_yield.l, &values->inner_yield.I, &values->inner_yield.Ea, &v[0], &v[1], &v[2],
+                           &v[3], &v[4], &v[5], &v[6], &v[7], &v[8], &v[9]);
+      return sizeof(values->inner_yield);
+    case 'C':
+      memset(&values->coll_stren, 0, sizeof(values->coll_stren));
+      values->coll_stren.nwords =
+        scan_atomic_record(aline, "%*s %*s %d %2d %le %le %le %le %le %le %d %d %d %d %le %le %le %d %d %le",
+                           &values->coll_stren.z, &values->coll_stren.istate, &values->coll_stren.freq,
+                           &values->coll_stren.f, &values->coll_stren.gl, &values->coll_stren.gu,
+                           &values->coll_stren.el, &values->coll_stren.eu, &values->coll_stren.levl,
+                           &values->coll_stren.levu, &values->coll_stren.c_l, &values->coll_stren.c_u,
+                           &values->coll_stren.en, &values->coll_stren.gf, &values->coll_stren.hlt,
+                           &values->coll_stren.np, &values->coll_stren.type, &values->coll_stren.sp);
+      return sizeof(values->coll_stren);
+    default:
+      break;
+  }
+
+  /* The rest of the records are a few numbers followed by a list of values */
+
+  memset(&values->list, 0, sizeof(values->list));
+  v = values->list.values;
+  size = sizeof(values->list);
+
+  switch(choice)
+  {
+    case 'f':
+      values->list.nwords =
+        scan_atomic_record(aline,
+                           "%*s %d %d %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le",
+                           &values->list.z, &values->list.istate, &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7],
+                           &v[8], &v[9], &v[10], &v[11], &v[12], &v[13], &v[14], &v[15], &v[16], &v[17], &v[18], &v[19]);
+      break;
+    case 'D':
+      values->list.nwords = scan_atomic_record(aline, "%*s %c %d %d %le %le %le %le %le %le %le %le %le",
+                                               &values->list.flag, &values->list.z, &values->list.istate, &v[0], &v[1],
+                                               &v[2], &v[3], &v[4], &v[5], &v[6], &v[7], &v[8]);
+      break;
+    case 'S':
+      values->list.nwords = scan_atomic_record(aline, "%*s %d %d %le %le %le %le ", &values->list.z,
+                                               &values->list.istate, &v[0], &v[1], &v[2], &v[3]);
+      break;
+    case 'T':
+      values->list.nwords = scan_atomic_record(aline, "%*s %d %d %d %le %le %le %le %le %le", &values->list.z,
+                                               &values->list.istate, &values->list.w, &v[0], &v[1], &v[2], &v[3], &v[4],
+                                               &v[5]);
+      break;
+    case 's':
+      values->list.nwords = scan_atomic_record(aline, "%*s %d %d %le %le ", &values->list.z, &values->list.istate,
+                                               &v[0], &v[1]);
+      break;
+    case 'G':
+      values->list.nwords =
+        scan_atomic_record(aline,
+                           "%*s %c %d %d %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le",
+                           &values->list.flag, &values->list.z, &values->list.istate, &v[0], &v[1], &v[2], &v[3], &v[4],
+                           &v[5], &v[6], &v[7], &v[8], &v[9], &v[10], &v[11], &v[12], &v[13], &v[14], &v[15], &v[16],
+                           &v[17], &v[18]);
+      break;
+    case 'g':
+      values->list.nwords = scan_atomic_record(aline, "%*s %le %le %le %le %le", &v[0], &v[1], &v[2], &v[3], &v[4]);
+      break;
+    case 'd':
+      values->list.nwords =
+        scan_atomic_record(aline,
+                           "%*s %d %d %d %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le"
+                           " %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le",
+                           &values->list.z, &values->list.istate, &values->list.w, &v[0], &v[1], &v[2], &v[3], &v[4],
+                           &v[5], &v[6], &v[7], &v[8], &v[9], &v[10], &v[11], &v[12], &v[13], &v[14], &v[15], &v[16],
+                           &v[17], &v[18], &v[19], &v[20], &v[21], &v[22], &v[23], &v[24], &v[25], &v[26], &v[27],
+                           &v[28], &v[29], &v[30], &v[31], &v[32], &v[33], &v[34], &v[35], &v[36], &v[37], &v[38],
+                           &v[39], &v[40], &v[41]);
+      break;
+    case SPLINE_RECORD:
+      values->list.nwords =
+        scan_atomic_record(aline,
+                           "%*s %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le",
+                           &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7], &v[8], &v[9], &v[10], &v[11], &v[12],
+                           &v[13], &v[14], &v[15], &v[16], &v[17], &v[18], &v[19]);
+      break;
+    default:
+      size = 0;
+      break;
+  }
+
+  return size;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Keep the values parsed from a record in a staged file
+ *
+ * @param[in, out]  afile   The staged file
+ * @param[in, out]  record  The record
+ * @param[in]       choice  The type to parse the record as
+ * @param[in, out]  nalloc  The number of bytes allocated for the values
+ * @param[out]      values  The values which were parsed
+ *
+ * @return  0 on success, or -1 if there was not enough memory
+ *
+ * @details
+ *
+ * The values of each record are packed one after another, taking only as much
+ * space as the type of record needs, and the record keeps their offset.
+ *
+ * ************************************************************************** */
+
+static int
+stage_record_values(AtomicFile_t *afile, AtomicRecord_t *record, char choice, long *nalloc, AtomicValues_t *values)
+{
+  long size;
+  char aline[LINELENGTH];
+  char *new_values;
+
+  memcpy(aline, afile->buffer + record->start, record->len);
+  aline[record->len] = '\0';
+
+  if((size = parse_atomic_data_record(aline, choice, values)) == 0)
+    return 0;
+
+  size = (size + sizeof(double) - 1) / sizeof(double) * sizeof(double);
+  if(afile->values_size + size > *nalloc)
+  {
+    *nalloc = *nalloc ? 2 * *nalloc : 64 * (long) sizeof(*values);
+    if(*nalloc < afile->values_size + size)
+      *nalloc = afile->values_size + size;
+    if((new_values = realloc(afile->values, *nalloc)) == NULL)
+      return -1;
+    afile->values = new_values;
+  }
+
+  record->parsed = choice;
+  record->values = afile->values_size;
+  memcpy(afile->values + afile->values_size, values, size);
+  afile->values_size += size;
+
+  return 0;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Parse the records in a staged file
+ *
+ * @param[in, out]  afile  The staged file
+ *
+ * @return  0 on success, or -1 if there was not enough memory
+ *
+ * @details
+ *
+ * The records are gone through in the same way as read_atomic_data goes
+ * through them, so each is parsed as the type read_atomic_data will take it
+ * to be. A continuation record has the type of the record before it, so any
+ * at the start of a file are left for read_atomic_data.
+ *
+ * Each cross section begins with a summary record giving the number of points
+ * which follow, and the points are parsed into the records they are on. The
+ * two records after a CSTREN record are parsed as the spline of the collision
+ * strength.
+ *
+ * ************************************************************************** */
+
+static int
+parse_records(AtomicFile_t *afile)
+{
+  int n, i;
+  long nalloc = 0;
+  char choice = 0;
+  char aline[LINELENGTH];
+  char *word, *c;
+  AtomicRecord_t *record;
+  AtomicValues_t values;
+
+  for(n = 0; n < afile->nrecords; n++)
+  {
+    record = &afile->records[n];
+    word = afile->buffer + record->start + record->word_start;
+    if(record->choice != 0)
+      choice = record->choice;
+    if(choice == 0 || choice == 'c' || choice == 'z')
+      continue;
+
+    if(stage_record_values(afile, record, choice, &nalloc, &values))
+      return -1;
+
+    if(choice == 'C')
+    {
+      for(i = 0; i < 2 && n + 1 < afile->nrecords; i++)
+        if(stage_record_values(afile, &afile->records[++n], SPLINE_RECORD, &nalloc, &values))
+          return -1;
+      continue;
+    }
+
+    if(!((record->choice == 'w' && (strncmp(word, "PhotMacS", 8) == 0 || strncmp(word, "PhotTopS", 8) == 0
+                                    || strncmp(word, "PhotVfkyS", 8) == 0)) || record->choice == 'I'))
+      continue;
+    if(values.xsection.nwords != 6)
+      continue;
+
+    for(i = 0; i < values.xsection.np && n + 1 < afile->nrecords; i++)
+    {
+      record = &afile->records[++n];
+      memcpy(aline, afile->buffer + record->start, record->len);
+      aline[record->len] = '\0';
+      c = aline;
+      if(next_token(&c, &word) && next_double(&c, &record->points[0]) == 1
+         && next_double(&c, &record->points[1]) == 1)
+        record->has_points = TRUE;
+    }
+  }
+
+  return 0;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Read a file into memory and split it into records
+ *
+ * @param[in, out]  afile  The file to stage
+ *
+ * @return  LOADER_STAGED on success, otherwise LOADER_FAILED
+ *
+ * ************************************************************************** */
+
+static LoaderStatus_t
+stage_file(AtomicFile_t *afile)
+{
+  FILE *fptr;
+  struct stat sb;
+
+  if((fptr = fopen(afile->path, "r")) == NULL)
+    return LOADER_FAILED;
+
+  if(fstat(fileno(fptr), &sb) || (afile->buffer = malloc(sb.st_size + 1)) == NULL
+     || fread(afile->buffer, 1, sb.st_size, fptr) != (size_t) sb.st_size)
+  {
+    fclose(fptr);
+    return LOADER_FAILED;
+  }
+
+  fclose(fptr);
+  afile->size = sb.st_size;
+
+  if(split_records(afile, sb.st_size))
+    return LOADER_FAILED;
+
+  if(parse_records(afile))
+    return LOADER_FAILED;
+
+  return LOADER_STAGED;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  The main function of the worker threads
+ *
+ * @param[in]  arg  The loader
+ *
+ * @return  NULL
+ *
+ * @details
+ *
+ * Each worker takes the next file which has not been staged, in masterfile
+ * order, until there are none left or the loader is stopped.
+ *
+ * ************************************************************************** */
+
+static void *
+loader_worker(void *arg)
+{
+  int n;
+  LoaderStatus_t status;
+  AtomicLoader_t *loader = arg;
+
+  while(TRUE)
+  {
+    pthread_mutex_lock(&loader->lock);
+    n = loader->next_file++;
+    if(loader->abort || n >= loader->nfiles)
+    {
+      pthread_mutex_unlock(&loader->lock);
+      break;
+    }
+    pthread_mutex_unlock(&loader->lock);
+
+    status = stage_file(&loader->files[n]);
+
+    pthread_mutex_lock(&loader->lock);
+    loader->files[n].status = status;
+    pthread_cond_broadcast(&loader->staged);
+    pthread_mutex_unlock(&loader->lock);
+  }
+
+  return NULL;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Read a masterfile and start staging the files it lists
+ *
+ * @param[out]  loader        The loader to start
+ * @param[in]   mptr          The masterfile, which has been opened
+ * @param[in]   use_relative  If TRUE, the paths in the masterfile are used as is
+ *
+ * @return  0 on success, or an ATOMIC error code
+ *
+ * @details
+ *
+ * One worker thread is started for each available processor, up to
+ * LOADER_MAX_THREADS. If no threads can be started, the files are staged when
+ * they are asked for instead.
+ *
+ * ************************************************************************** */
+
+int
+start_atomic_data_loader(AtomicLoader_t *loader, FILE *mptr, int use_relative)
+{
+  int nalloc = 0;
+  long ncpus;
+  char aline[LINELENGTH];
+  char file[LINELENGTH];
+  AtomicFile_t *new_files;
+
+  memset(loader, 0, sizeof(*loader));
+  pthread_mutex_init(&loader->lock, NULL);
+  pthread_cond_init(&loader->staged, NULL);
+
+  while(fgets(aline, LINELENGTH, mptr) != NULL)
+  {
+    if(scan_atomic_record(aline, "%s", file) == 1 && file[0] != '#')
+    {
+      if(loader->nfiles == nalloc)
+      {
+        nalloc = nalloc ? 2 * nalloc : 32;
+        if((new_files = realloc(loader->files, nalloc * sizeof(*new_files))) == NULL)
+          return ATOMIC_MEMORY_ISSUE_ERROR;
+        loader->files = new_files;
+      }
+      memset(&loader->files[loader->nfiles], 0, sizeof(*loader->files));
+      snprintf(loader->files[loader->nfiles].name, LOADER_PATH_LEN, "%s", file);
+      get_atomic_data_path(file, use_relative, FALSE, loader->files[loader->nfiles].path);
+      loader->files[loader->nfiles].status = LOADER_PENDING;
+      loader->nfiles++;
+    }
+  }
+
+  ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+  if(ncpus > LOADER_MAX_THREADS)
+    ncpus = LOADER_MAX_THREADS;
+  if(ncpus > loader->nfiles)
+    ncpus = loader->nfiles;
+
+  for(loader->nthreads = 0; loader->nthreads < ncpus; loader->nthreads++)
+    if(pthread_create(&loader->threads[loader->nthreads], NULL, loader_worker, loader))
+      break;
+
+  return 0;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Get a file which has been staged, waiting for it if required
+ *
+ * @param[in]  loader  The loader
+ * @param[in]  n       The index of the file in the masterfile
+ *
+ * @return  The staged file, or NULL if it could not be read
+ *
+ * ************************************************************************** */
+
+AtomicFile_t *
+get_staged_atomic_data_file(AtomicLoader_t *loader, int n)
+{
+  AtomicFile_t *afile = &loader->files[n];
+
+  if(loader->nthreads == 0)
+  {
+    afile->status = stage_file(afile);
+  }
+  else
+  {
+    pthread_mutex_lock(&loader->lock);
+    while(afile->status == LOADER_PENDING)
+      pthread_cond_wait(&loader->staged, &loader->lock);
+    pthread_mutex_unlock(&loader->lock);
+  }
+
+  afile->current = 0;
+
+  return afile->status == LOADER_STAGED ? afile : NULL;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Read the next record from a staged file
+ *
+ * @param[in, out]  afile  The staged file
+ * @param[out]      aline  The text of the record, LINELENGTH characters long
+ *
+ * @return  The record, or NULL if there are no records left
+ *
+ * @details
+ *
+ * This is used in place of fgets by get_atomic_data, and aline is filled in
+ * exactly as fgets would have done.
+ *
+ * ************************************************************************** */
+
+AtomicRecord_t *
+read_atomic_data_record(AtomicFile_t *afile, char *aline)
+{
+  AtomicRecord_t *record;
+
+  if(afile->current >= afile->nrecords)
+    return NULL;
+
+  record = &afile->records[afile->current++];
+  memcpy(aline, afile->buffer + record->start, record->len);
+  aline[record->len] = '\0';
+
+  return record;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Get the values of a record from a staged file
+ *
+ * @param[in]   afile   The staged file
+ * @param[in]   record  The record
+ * @param[in]   choice  The type of the record
+ * @param[in]   aline   The text of the record
+ * @param[out]  values  The values of the record
+ *
+ * @details
+ *
+ * The values were parsed by the worker threads, unless the record has turned
+ * out to be of a different type to the one it was parsed as. The record is
+ * parsed again in that case.
+ *
+ * ************************************************************************** */
+
+void
+read_atomic_record_values(AtomicFile_t *afile, AtomicRecord_t *record, char choice, char *aline, AtomicValues_t *values)
+{
+  long size;
+
+  /* Only the member for this type of record was kept, which may be the last values in the file */
+
+  if(record->parsed == choice)
+  {
+    size = afile->values_size - record->values;
+    memcpy(values, afile->values + record->values, size < (long) sizeof(*values) ? size : (long) sizeof(*values));
+  }
+  else
+  {
+    parse_atomic_data_record(aline, choice, values);
+  }
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Free the memory used by a staged file
+ *
+ * @param[in, out]  afile  The staged file
+ *
+ * ************************************************************************** */
+
+void
+free_staged_atomic_data_file(AtomicFile_t *afile)
+{
+  free(afile->buffer);
+  free(afile->records);
+  free(afile->values);
+  afile->buffer = NULL;
+  afile->records = NULL;
+  afile->values = NULL;
+  afile->values_size = 0;
+  afile->nrecords = 0;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Stop the worker threads and free the staged files
+ *
+ * @param[in, out]  loader  The loader
+ *
+ * @details
+ *
+ * This is safe to call before every file has been staged, for example when
+ * get_atomic_data finds an error part way through the masterfile.
+ *
+ * ************************************************************************** */
+
+void
+stop_atomic_data_loader(AtomicLoader_t *loader)
+{
+  int n;
+
+  pthread_mutex_lock(&loader->lock);
+  loader->abort = TRUE;
+  pthread_mutex_unlock(&loader->lock);
+
+  for(n = 0; n < loader->nthreads; n++)
+    pthread_join(loader->threads[n], NULL);
+
+  for(n = 0; n < loader->nfiles; n++)
+    free_staged_atomic_data_file(&loader->files[n]);
+
+  pthread_mutex_destroy(&loader->lock);
+  pthread_cond_destroy(&loader->staged);
+  free(loader->files);
+  loader->files = NULL;
+  loader->nfiles = loader->nthreads = 0;
+}
@@ -0,0 +1,373 @@
+/* ************************************************************************** */
+/**
+ * @file     atomic_tables.c
+ *
+ * @brief
+ *
+ * Functions for managing the memory of the tables of atomic data.
+ *
+ * @details
+ *
+ * The tables used to have a size fixed at compile time, such as NLINES and
+ * NLEVELS, which was both far too much memory for a small data set and not
+ * enough for a large line list. Each table is now a single block of memory
+ * which is grown as the data is read in, by doubling its size each time it
+ * is full. Entries are initialised as they are created, so get_atomic_data
+ * only needs to reserve an entry before it fills it in.
+ *
+ * A table can also be attached to memory which atomix doesn't own, i.e. a
+ * snapshot in the cache. These tables can't grow and are never freed.
+ *
+ * ************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "atomix.h"
+
+#define MIN_TABLE_SIZE 16
+
+/*
+ * Functions to initialise a new entry in each of the tables
+ */
+
+static void
+init_element(void *entry)
+{
+  ElemPtr e = entry;
+
+  strcpy(e->name, "none");
+  e->z = (-1);
+  e->abun = (-1);
+  e->firstion = (-1);
+  e->nions = (-1);
+  e->istate_max = (-1);
+}
+
+static void
+init_ion(void *entry)
+{
+  int i;
+  IonPtr ion = entry;
+
+  ion->z = (-1);
+  ion->istate = (-1);
+  ion->nelem = (-1);
+  ion->ip = (-1);
+  ion->g = (-1);
+  ion->nmax = (-1);
+  ion->firstlevel = (-1);
+  ion->nlevels = (-1);
+  ion->first_nlte_level = (-1);
+  ion->first_levden = (-1);
+  ion->nlte = (-1);
+  ion->phot_info = (-1);
+  ion->macro_info = (-1);       //Initialise - don't know if using Macro Atoms or not: set to -1 (SS)
+  ion->ntop_first = 0;          // The fact that ntop_first and ntop  are initialized to 0 and not -1 is important
+  ion->ntop_ground = 0;         //NSH 0312 initialize the new pointer for GS cross sections
+  ion->ntop = 0;
+  ion->nxphot = (-1);
+  ion->lev_type = (-1);         // Initialise to indicate we don't know what types of configurations will be read
+  ion->drflag = 0;              //Initialise to indicate as far as we know, there are no dielectronic recombination parameters associated with this ion.
+  ion->total_rrflag = 0;        //Initialise to say this ion has no Badnell total recombination data
+  ion->nxtotalrr = -1;          //Initialise the pointer into the bad_t_rr structure.
+  ion->bad_gs_rr_t_flag = 0;    //Initialise to say this ion has no Badnell ground state recombination data
+  ion->bad_gs_rr_r_flag = 0;    //Initialise to say this ion has no Badnell ground state recombination data
+  ion->nxbadgsrr = -1;          //Initialise the pointer into the bad_gs_rr structure.
+  ion->dere_di_flag = 0;        //Initialise to say this ion has no Dere DI rate data
+  ion->nxderedi = -1;           //Initialise the pointer into the Dere DI rate structure
+  ion->n_inner = 0;             //Initialise the pointer to say we have no inner shell ionization cross sections
+  for(i = 0; i < N_INNER; i++)
+    ion->nxinner[i] = -1;       //Inintialise the inner shell pointer array
+}
+
+static void
+init_config(void *entry)
+{
+  ConfigPtr c = entry;
+
+  c->n_bbu_jump = 0;            // initialising the number of jumps from each level to 0. (SS)
+  c->n_bbd_jump = 0;
+  c->n_bfu_jump = 0;
+  c->n_bfd_jump = 0;
+}
+
+static void
+init_line(void *entry)
+{
+  LinePtr l = entry;
+
+  l->freq = -1;
+  l->f = 0;
+  l->nion = -1;
+  l->gl = l->gu = 0;
+  l->el = l->eu = 0.0;
+  l->macro_info = -1;
+  l->coll_index = -999;
+}
+
+static void
+init_coll_stren(void *entry)
+{
+  Coll_strenptr c = entry;
+
+  c->n = -1;                    //Internal index
+  c->lower = -1;                //The lower energy level - this is in Chianti notation and is currently unused
+  c->upper = -1;                //The upper energy level - this is in Chianti notation and is currently unused
+  c->type = -1;                 //The type of fit, this defines how one computes the scaled temperature and scaled coll strength
+}
+
+/* This is used for phot_top and inner_cross, as it is used for all ionization processes so some elements
+   are only used in some circumstances */
+
+static void
+init_xsection(void *entry)
+{
+  TopPhotPtr x = entry;
+
+  x->nlev = (-1);
+  x->uplev = (-1);
+  x->nion = (-1);               //the ion to which this cross section belongs
+  x->n_elec_yield = -1;         //pointer to the electron yield array (for inner shell)
+  x->n = -1;                    //pointer to shell (inner shell)
+  x->l = -1;                    //pointer to l subshell (inner shell only)
+  x->z = (-1);                  //atomic number
+  x->np = (-1);                 //number of points in the fit
+  x->macro_info = (-1);         //Initialise - don't know if using Macro Atoms or not: set to -1 (SS)
+  x->offset = (-1);             //no points in the cross section pool yet
+  x->freq = x->x = NULL;
+  x->f = (-1);                  //last frequency
+  x->sigma = 0.0;               //last cross section
+}
+
+static void
+init_inner_elec_yield(void *entry)
+{
+  Inner_elec_yield *y = entry;
+
+  y->nion = y->n = y->l = y->z = (-1);
+}
+
+static void
+init_inner_fluor_yield(void *entry)
+{
+  Inner_fluor_yield *y = entry;
+
+  y->nion = y->n = y->l = y->z = (-1);
+}
+
+static void
+init_drecomb(void *entry)
+{
+  Drecombptr d = entry;
+
+  d->nion = -1;
+  d->nparam = -1;               //the number of parameters - it varies from ion to ion
+}
+
+static void
+init_total_rr(void *entry)
+{
+  total_rrptr t = entry;
+
+  t->nion = -1;
+}
+
+static void
+init_bad_gs_rr(void *entry)
+{
+  Bad_gs_rrptr b = entry;
+
+  b->nion = -1;
+}
+
+static void
+init_dere_di_rate(void *entry)
+{
+  Dere_di_rateptr d = entry;
+
+  d->nion = -1;
+  d->min_temp = 1e99;
+}
+
+/*
+ * The tables of atomic data. Entries are zeroed before they are initialised,
+ * so only the members which are not initially zero need to be set by the
+ * init functions
+ */
+
+typedef struct AtomicTable_t
+{
+  char *name;
+  void **data;                  /* The address of the global pointer to the table */
+  size_t entry_size;
+  void (*init)(void *entry);    /* Initialise a new entry, or NULL if it is left as zero */
+  int size;                     /* The number of entries allocated */
+  int owned;                    /* FALSE if the table is in memory atomix doesn't own */
+} AtomicTable_t;
+
+static AtomicTable_t ATOMIC_TABLES[NTABLES] = {
+  {"elements", (void **) &ele, sizeof(*ele), init_element, 0, TRUE},
+  {"ions", (void **) &ions, sizeof(*ions), init_ion, 0, TRUE},
+  {"simple_line_ignore", (void **) &simple_line_ignore, sizeof(*simple_line_ignore), NULL, 0, TRUE},
+  {"ground_frac", (void **) &ground_frac, sizeof(*ground_frac), NULL, 0, TRUE},
+  {"config", (void **) &config, sizeof(*config), init_config, 0, TRUE},
+  {"line", (void **) &line, sizeof(*line), init_line, 0, TRUE},
+  {"lin_ptr", (void **) &lin_ptr, sizeof(*lin_ptr), NULL, 0, TRUE},
+  {"line_index", (void **) &line_index, sizeof(*line_index), NULL, 0, TRUE},
+  {"line_index_ptr", (void **) &line_index_ptr, sizeof(*line_index_ptr), NULL, 0, TRUE},
+  {"line_freq", (void **) &line_columns.freq, sizeof(*line_columns.freq), NULL, 0, TRUE},
+  {"line_z", (void **) &line_columns.z, sizeof(*line_columns.z), NULL, 0, TRUE},
+  {"line_istate", (void **) &line_columns.istate, sizeof(*line_columns.istate), NULL, 0, TRUE},
+  {"line_nion", (void **) &line_columns.nion, sizeof(*line_columns.nion), NULL, 0, TRUE},
+  {"line_id", (void **) &line_columns.id, sizeof(*line_columns.id), NULL, 0, TRUE},
+  {"line_a21", (void **) &line_columns.a21, sizeof(*line_columns.a21), NULL, 0, TRUE},
+  {"line_b12", (void **) &line_columns.b12, sizeof(*line_columns.b12), NULL, 0, TRUE},
+  {"line_b21", (void **) &line_columns.b21, sizeof(*line_columns.b21), NULL, 0, TRUE},
+  {"line_lifetime", (void **) &line_columns.lifetime, sizeof(*line_columns.lifetime), NULL, 0, TRUE},
+  {"phot_top_threshold", (void **) &phot_top_threshold, sizeof(*phot_top_threshold), NULL, 0, TRUE},
+  {"inner_cross_threshold", (void **) &inner_cross_threshold, sizeof(*inner_cross_threshold), NULL, 0, TRUE},
+  {"phot_top_coverage", (void **) &phot_top_coverage, sizeof(*phot_top_coverage), NULL, 0, TRUE},
+  {"inner_cross_coverage", (void **) &inner_cross_coverage, sizeof(*inner_cross_coverage), NULL, 0, TRUE},
+  {"ion_postings", (void **) &ion_postings, sizeof(*ion_postings), NULL, 0, TRUE},
+  {"element_postings", (void **) &element_postings, sizeof(*element_postings), NULL, 0, TRUE},
+  {"postings", (void **) &postings, sizeof(*postings), NULL, 0, TRUE},
+  {"coll_stren", (void **) &coll_stren, sizeof(*coll_stren), init_coll_stren, 0, TRUE},
+  {"phot_top", (void **) &phot_top, sizeof(*phot_top), init_xsection, 0, TRUE},
+  {"phot_top_ptr", (void **) &phot_top_ptr, sizeof(*phot_top_ptr), NULL, 0, TRUE},
+  {"inner_cross", (void **) &inner_cross, sizeof(*inner_cross), init_xsection, 0, TRUE},
+  {"inner_cross_ptr", (void **) &inner_cross_ptr, sizeof(*inner_cross_ptr), NULL, 0, TRUE},
+  {"inner_elec_yield", (void **) &inner_elec_yield, sizeof(*inner_elec_yield), init_inner_elec_yield, 0, TRUE},
+  {"inner_fluor_yield", (void **) &inner_fluor_yield, sizeof(*inner_fluor_yield), init_inner_fluor_yield, 0, TRUE},
+  {"drecomb", (void **) &drecomb, sizeof(*drecomb), init_drecomb, 0, TRUE},
+  {"total_rr", (void **) &total_rr, sizeof(*total_rr), init_total_rr, 0, TRUE},
+  {"bad_gs_rr", (void **) &bad_gs_rr, sizeof(*bad_gs_rr), init_bad_gs_rr, 0, TRUE},
+  {"dere_di_rate", (void **) &dere_di_rate, sizeof(*dere_di_rate), init_dere_di_rate, 0, TRUE},
+  {"gaunt_total", (void **) &gaunt_total, sizeof(*gaunt_total), NULL, 0, TRUE},
+  {"gaunt_segment", (void **) &gaunt_lookup.segment, sizeof(*gaunt_lookup.segment), NULL, 0, TRUE},
+};
+
+/* ************************************************************************** */
+/**
+ * @brief  Make sure a table has space for at least n entries
+ *
+ * @param[in]  id  The table
+ * @param[in]  n   The number of entries required
+ *
+ * @return  0 on success, or ATOMIC_MEMORY_ISSUE_ERROR if the table could not
+ *          be grown
+ *
+ * @details
+ *
+ * The table is moved when it grows, so any pointers into it are no longer
+ * valid. The pointer arrays, e.g. lin_ptr, are therefore only created once
+ * all of the data has been read in.
+ *
+ * ************************************************************************** */
+
+int
+reserve_atomic_table(AtomicTableId_t id, int n)
+{
+  int i;
+  int new_size;
+  char *new_data;
+  AtomicTable_t *table = &ATOMIC_TABLES[id];
+
+  if(n <= table->size)
+    return 0;
+  if(!table->owned)
+    return ATOMIC_MEMORY_ISSUE_ERROR;
+
+  new_size = table->size > 0 ? 2 * table->size : MIN_TABLE_SIZE;
+  if(new_size < n)
+    new_size = n;
+
+  if((new_data = realloc(*table->data, new_size * table->entry_size)) == NULL)
+  {
+    logfile("There is a problem in allocating memory for the %s structure\n", table->name);
+    return ATOMIC_MEMORY_ISSUE_ERROR;
+  }
+
+  memset(new_data + table->size * table->entry_size, 0, (new_size - table->size) * table->entry_size);
+  if(table->init)
+    for(i = table->size; i < new_size; i++)
+      table->init(new_data + i * table->entry_size);
+
+  *table->data = new_data;
+  table->size = new_size;
+
+  return 0;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Use memory which atomix doesn't own for a table
+ *
+ * @param[in]  id    The table
+ * @param[in]  data  The memory to use for the table, or NULL
+ *
+ * @details
+ *
+ * This is used to point a table into a snapshot from the cache. Any memory
+ * which was owned by the table is freed.
+ *
+ * ************************************************************************** */
+
+void
+attach_atomic_table(AtomicTableId_t id, void *data)
+{
+  AtomicTable_t *table = &ATOMIC_TABLES[id];
+
+  if(table->owned)
+    free(*table->data);
+
+  *table->data = data;
+  table->size = 0;
+  table->owned = data == NULL;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Free all of the tables of atomic data
+ *
+ * @details
+ *
+ * Tables which are attached to memory atomix doesn't own are just set to
+ * NULL. Every table is empty afterwards, ready for new data to be read in.
+ *
+ * ************************************************************************** */
+
+void
+free_atomic_tables(void)
+{
+  int i;
+
+  for(i = 0; i < NTABLES; i++)
+    attach_atomic_table(i, NULL);
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Write the size of each table to the log
+ *
+ * ************************************************************************** */
+
+void
+log_atomic_tables(void)
+{
+  int i;
+  double total = 0;
+  AtomicTable_t *table;
+
+  for(i = 0; i < NTABLES; i++)
+  {
+    table = &ATOMIC_TABLES[i];
+    if(table->size > 0)
+      logfile("Allocated %10d bytes for each of %6d elements of %18s totaling %10.1f Mb \n", (int) table->entry_size,
+              table->size, table->name, 1.e-6 * table->size * table->entry_size);
+    total += (double) table->size * table->entry_size;
+  }
+
+  logfile("Allocated %.1f Mb in total for the atomic data tables\n", 1e-6 * total);
+}
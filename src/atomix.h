@@ -13,6 +13,7 @@
 #include <form.h>
 #include <menu.h>
 #include <curses.h>
+#include <pthread.h>
 
 #define LINELEN 128
 #define ATOMIX_VERSION_NUMBER "5.0"
@@ -36,6 +37,7 @@ typedef struct Config_t
   int rows, cols;
   int current_line, current_col;
   int atomic_data_loaded;
+  int lines_streamed;
   char atomic_data[LINELEN];
   char status_message[LINELEN];
   Screens current_screen;
@@ -143,6 +145,11 @@ typedef struct QueryDump_t
   add_display(&DISPLAY_BUFFER, fmt, ##__VA_ARGS__); \
 }
 
+#define display_add_rows(ids, first, nrows, format) \
+{ \
+  add_rows_display(&DISPLAY_BUFFER, ids, first, nrows, format); \
+}
+
 #define display_show(scroll, persistent_header, header_rows) \
 {\
   AtomixConfiguration.current_screen = sc_text_view; \
@@ -156,17 +163,374 @@ typedef struct Line_t
   char *chars;
 } Line_t;
 
+/* The text of the lines in a Display_t is kept in a list of chunks, which are
+   re-used when the buffer is cleaned up */
+
+typedef struct DisplayChunk_t
+{
+  struct DisplayChunk_t *next;
+  size_t size;                  /* The number of chars in data */
+  size_t used;                  /* The number of chars written to data */
+  char data[];
+} DisplayChunk_t;
+
+/* A block of rows in a Display_t can be left to be formatted only when they
+   are shown on the screen. The formatter writes row id into a string of size
+   chars and returns its length, as snprintf does */
+
+#define DISPLAY_ROW_LEN 512
+#define DISPLAY_NROWS_CACHED 256
+
+typedef int (*DisplayRowFormatter_t)(int id, char *row, int size);
+
+typedef struct DisplayRow_t
+{
+  int line;                     /* The line of the buffer in this row, or -1 */
+  int len;
+  char chars[DISPLAY_ROW_LEN];
+} DisplayRow_t;
+
+typedef struct DisplayRows_t
+{
+  int start;                    /* The line of the buffer the rows start at */
+  int nrows;
+  int first;                    /* The id of the first row, if there are no ids */
+  int *ids;                     /* The id of each row, or NULL for first, first + 1, ... */
+  DisplayRowFormatter_t format;
+  DisplayRow_t *cache;          /* The formatted rows, at their line modulo DISPLAY_NROWS_CACHED */
+} DisplayRows_t;
+
 typedef struct Display_t
 {
   char name[LINELEN];
   int nlines;
   int maxlen;
+  int maxlines;                 /* The number of lines there is space for in lines */
   Line_t *lines;
+  DisplayChunk_t *chunks;       /* The first chunk of text */
+  DisplayChunk_t *current;      /* The chunk being written to */
+  DisplayRows_t rows;           /* The rows which are formatted when shown */
+  int log_level;                /* The level the lines are written to the log file at */
 } Display_t;
 
 Display_t ATOMIC_BUFFER;
 Display_t DISPLAY_BUFFER;
 
+/* ****************************************************************************
+ * Logging
+ * ************************************************************************** */
+
+/* Each message written to the log file has a level, and it is only written if
+   the level is at or below the verbosity of the log file, which is LOG_INFO
+   unless $ATOMIX_LOG_LEVEL is set */
+
+typedef enum LogLevel_t
+{
+  LOG_ERROR = 0,
+  LOG_INFO = 1,
+  LOG_DISPLAY = 2,              /* Every line added to a text buffer */
+} LogLevel_t;
+
+/* ****************************************************************************
+ * Atomic data tables
+ * ************************************************************************** */
+
+typedef enum AtomicTableId_t
+{
+  TABLE_ELEMENTS,
+  TABLE_IONS,
+  TABLE_SIMPLE_LINE_IGNORE,
+  TABLE_GROUND_FRAC,
+  TABLE_CONFIG,
+  TABLE_LINES,
+  TABLE_LIN_PTR,
+  TABLE_LINE_INDEX,
+  TABLE_LINE_INDEX_PTR,
+  TABLE_LINE_FREQ,
+  TABLE_LINE_Z,
+  TABLE_LINE_ISTATE,
+  TABLE_LINE_NION,
+  TABLE_LINE_ID,
+  TABLE_LINE_A21,
+  TABLE_LINE_B12,
+  TABLE_LINE_B21,
+  TABLE_LINE_LIFETIME,
+  TABLE_PHOT_TOP_THRESHOLD,
+  TABLE_INNER_CROSS_THRESHOLD,
+  TABLE_PHOT_TOP_COVERAGE,
+  TABLE_INNER_CROSS_COVERAGE,
+  TABLE_ION_POSTINGS,
+  TABLE_ELEMENT_POSTINGS,
+  TABLE_POSTINGS,
+  TABLE_COLL_STREN,
+  TABLE_PHOT_TOP,
+  TABLE_PHOT_TOP_PTR,
+  TABLE_INNER_CROSS,
+  TABLE_INNER_CROSS_PTR,
+  TABLE_INNER_ELEC_YIELD,
+  TABLE_INNER_FLUOR_YIELD,
+  TABLE_DRECOMB,
+  TABLE_TOTAL_RR,
+  TABLE_BAD_GS_RR,
+  TABLE_DERE_DI_RATE,
+  TABLE_GAUNT_TOTAL,
+  TABLE_GAUNT_SEGMENT,
+  NTABLES,
+} AtomicTableId_t;
+
+/* ****************************************************************************
+ * Parallel tasks
+ * ************************************************************************** */
+
+#define PARALLEL_MAX_THREADS 8
+
+/* ****************************************************************************
+ * Sorting
+ * ************************************************************************** */
+
+typedef struct SortKey_t
+{
+  double freq;
+  int z, istate;
+  int lower, upper;             /* The levels, or shell, used to break ties */
+  int id;                       /* The index of the entry in its table */
+} SortKey_t;
+
+/* ****************************************************************************
+ * Atomic data loader
+ * ************************************************************************** */
+
+#define LOADER_PATH_LEN 400
+#define LOADER_MAX_THREADS 8
+
+typedef enum LoaderStatus_t
+{
+  LOADER_PENDING,
+  LOADER_STAGED,
+  LOADER_FAILED,
+} LoaderStatus_t;
+
+#define SPLINE_RECORD 'u'       /* The type of the SCT and SCUPS records which follow a CSTREN record */
+#define MAX_RECORD_VALUES 42    /* The most real numbers in a record, i.e. a DI_DERE record */
+
+/*
+ * The values parsed from each type of record by the worker threads. nwords is
+ * the number of values which were read, as returned by scan_atomic_record, and
+ * any value which was not read is zero
+ */
+
+typedef struct ElementRecord_t
+{
+  int nwords;
+  int z;
+  char name[20];
+  double abun;
+} ElementRecord_t;
+
+typedef struct IonRecord_t
+{
+  int nwords;
+  int z, istate;
+  int nmax, nlte;
+  double g, ip;
+} IonRecord_t;
+
+typedef struct LevelRecord_t
+{
+  int nwords;
+  int z, istate;
+  int islp, ilv;
+  double e, ex, g, q_num, rl;
+} LevelRecord_t;
+
+typedef struct XsectionRecord_t
+{
+  int nwords;
+  int z, istate;
+  int lower, upper;             /* The levels of a PhotMacS record, or the level or shell of the others */
+  double ex;
+  int np;
+} XsectionRecord_t;
+
+typedef struct LineRecord_t
+{
+  int nwords;
+  int z, istate;
+  int levl, levu;
+  double freq, f, gl, gu, el, eu;
+} LineRecord_t;
+
+typedef struct ListRecord_t
+{
+  int nwords;
+  char flag;                    /* The T/R or E/C flag of the BAD_GS_RR and DR_BADNL records */
+  int z, istate;                /* The second number is not always the ionisation state */
+  int w;
+  double values[MAX_RECORD_VALUES];
+} ListRecord_t;
+
+typedef struct InnerYieldRecord_t
+{
+  int nwords;
+  int z, istate, n, l;
+  double I, Ea;
+  double prob[10];
+} InnerYieldRecord_t;
+
+typedef struct CollStrenRecord_t
+{
+  int nwords;
+  int z, istate;
+  double freq, f, gl, gu, el, eu;
+  int levl, levu;
+  int c_l, c_u;
+  double en, gf, hlt;
+  int np, type;
+  double sp;
+} CollStrenRecord_t;
+
+typedef union AtomicValues_t
+{
+  ElementRecord_t element;
+  IonRecord_t ion;
+  LevelRecord_t level;
+  XsectionRecord_t xsection;
+  LineRecord_t line;
+  ListRecord_t list;
+  InnerYieldRecord_t inner_yield;
+  CollStrenRecord_t coll_stren;
+} AtomicValues_t;
+
+typedef struct AtomicRecord_t
+{
+  long start;                   /* Offset of the record in the file buffer */
+  int len;                      /* Length of the record, including the newline */
+  int word_start, word_len;     /* Position of the first word, i.e. the keyword, in the record */
+  char choice;                  /* The type of record, or 0 for a continuation record */
+  char parsed;                  /* The type the values were parsed as, or 0 if they have not been parsed */
+  long values;                  /* Offset of the parsed values in the file's values */
+  int has_points;               /* TRUE if the record is a cross section point which has been parsed */
+  double points[2];             /* The energy and cross section of the point */
+} AtomicRecord_t;
+
+typedef struct AtomicFile_t
+{
+  char name[LOADER_PATH_LEN];   /* The name of the file as given in the masterfile */
+  char path[LOADER_PATH_LEN];   /* The path used to open the file */
+  LoaderStatus_t status;
+  char *buffer;                 /* The contents of the file */
+  long size;                    /* The size of the file in bytes */
+  AtomicRecord_t *records;
+  int nrecords;
+  int current;                  /* The next record to be read by the parser */
+  char *values;                 /* The values parsed from the records, packed one after another */
+  long values_size;             /* The number of bytes of values */
+} AtomicFile_t;
+
+typedef struct AtomicLoader_t
+{
+  int nfiles;
+  AtomicFile_t *files;
+  int next_file;                /* The next file to be picked up by a worker thread */
+  int abort;
+  int nthreads;
+  double sort_ms;               /* The time taken to sort the data into frequency order */
+  pthread_t threads[LOADER_MAX_THREADS];
+  pthread_mutex_t lock;
+  pthread_cond_t staged;
+} AtomicLoader_t;
+
+/* ****************************************************************************
+ * Streamed line list
+ * ************************************************************************** */
+
+typedef struct LineIndex_t
+{
+  double freq;                  /* The frequency of the line */
+  long offset;                  /* Offset of the record for the line in its file */
+  int file;                     /* The file the record is in */
+  int nion;                     /* The ion the line belongs to */
+  int levl, levu;               /* The levels of the line, used to match collision strengths */
+  double gl, gu;                /* The statistical weights of the levels, for the radiative rates */
+  double f;                     /* The oscillator strength, for the radiative rates */
+  int coll_index;               /* The collision strength for the line, or -999 if there is none */
+} LineIndex_t;
+
+LineIndex_t *line_index;        /* The lines in the order they were read in */
+LineIndex_t **line_index_ptr;   /* The lines in frequency order */
+
+/* ****************************************************************************
+ * Line list columns
+ * ************************************************************************** */
+
+/*
+ * The lines in frequency order, split into columns. The lines for an element
+ * or ion, or in a frequency range, are found by searching these columns
+ * rather than by looking at every line in lin_ptr or line_index_ptr
+ */
+
+typedef struct LineColumns_t
+{
+  double *freq;                 /* The frequency of the line */
+  int *z;                       /* The element of the line */
+  int *istate;                  /* The ionisation state of the line */
+  int *nion;                    /* The ion the line belongs to */
+  int *id;                      /* The index of the line in line, or line_index */
+  double *a21;                  /* The Einstein A coefficient */
+  double *b12;                  /* The Einstein B coefficient for absorption */
+  double *b21;                  /* The Einstein B coefficient for stimulated emission */
+  double *lifetime;             /* The radiative lifetime of the upper level, or 0 if it is not known */
+} LineColumns_t;
+
+LineColumns_t line_columns;
+
+/* The threshold frequencies of the edges in phot_top_ptr and inner_cross_ptr, for searching by frequency */
+
+double *phot_top_threshold;
+double *inner_cross_threshold;
+
+/* Trees of the highest frequency of the cross sections in phot_top_ptr and inner_cross_ptr, see coverage.c */
+
+double *phot_top_coverage;
+double *inner_cross_coverage;
+
+/*
+ * A lookup of the segment of the Sutherland gaunt factor spline for bins of
+ * log(g^2) which are no wider than the segments, see gaunt.c
+ */
+
+typedef struct GauntLookup_t
+{
+  double log_gsqrd_min;         /* The start of the first bin */
+  double inv_width;             /* One over the width of a bin */
+  int nbins;                    /* The number of bins */
+  int *segment;                 /* The last segment which starts at or below each bin */
+} GauntLookup_t;
+
+GauntLookup_t gaunt_lookup;
+
+/* ****************************************************************************
+ * Ion and element postings
+ * ************************************************************************** */
+
+typedef enum PostingType_t
+{
+  POSTING_LINES,
+  POSTING_PHOT_TOP,
+  POSTING_INNER_CROSS,
+  NPOSTING_TYPES,
+} PostingType_t;
+
+typedef struct Postings_t
+{
+  int first[NPOSTING_TYPES];    /* The first entry in postings of each type */
+  int n[NPOSTING_TYPES];        /* The number of entries of each type */
+} Postings_t;
+
+Postings_t *ion_postings;       /* Where the entries for each ion are in postings */
+Postings_t *element_postings;   /* Where the entries for each element are in postings */
+int *postings;                  /* Positions of lines and edges in their frequency ordered list */
+
 /* ****************************************************************************
  * Misc
  * ************************************************************************** */
@@ -12,19 +12,25 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <signal.h>
 #include <stdbool.h>
 
 #include "atomix.h"
 
+#define DISPLAY_MIN_LINES 256
+#define DISPLAY_CHUNK_SIZE 65536
+#define DISPLAY_MAX_CHUNK_SIZE 4194304
+
 /* ************************************************************************** */
 /**
  * @brief  Clean up a text buffer, generally once it has been printed.
  *
  * @details
  *
- * Free the memory for all of the lines in the DISPLAY buffer, before freeing
- * the memory for DISPLAY.lines and re-initialising DISPLAY.
+ * The lines and the chunks of text are kept to be written over by the next
+ * lines added to the buffer, so this takes the same time however many lines
+ * were in the buffer.
  *
  * ************************************************************************** */
 
@@ -33,12 +39,71 @@ clean_up_display(Display_t *buffer)
 {
   int i;
 
-  for(i = 0; i < buffer->nlines; ++i)
-    free(buffer->lines[i].chars);
-  free(buffer->lines);
-
   buffer->nlines = buffer->maxlen = 0;
-  buffer->lines = NULL;
+  buffer->current = buffer->chunks;
+  if(buffer->current)
+    buffer->current->used = 0;
+
+  buffer->rows.nrows = 0;
+  buffer->rows.ids = NULL;
+  buffer->rows.format = NULL;
+  if(buffer->rows.cache)
+    for(i = 0; i < DISPLAY_NROWS_CACHED; ++i)
+      buffer->rows.cache[i].line = -1;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Move a text buffer on to a chunk with space for a line.
+ *
+ * @param[in]  buffer  The buffer
+ * @param[in]  len     The number of chars needed, including the '\0'
+ *
+ * @details
+ *
+ * The next chunk is re-used if it is large enough, otherwise a new chunk is
+ * put in after the current one. Each new chunk is at least twice the size of
+ * the last.
+ *
+ * ************************************************************************** */
+
+static void
+next_display_chunk(Display_t *buffer, size_t len)
+{
+  size_t size;
+  DisplayChunk_t *chunk;
+
+  if(buffer->current && buffer->current->next && buffer->current->next->size >= len)
+  {
+    buffer->current = buffer->current->next;
+    buffer->current->used = 0;
+    return;
+  }
+
+  size = buffer->current ? 2 * buffer->current->size : DISPLAY_CHUNK_SIZE;
+  if(size > DISPLAY_MAX_CHUNK_SIZE)
+    size = DISPLAY_MAX_CHUNK_SIZE;
+  if(size < len)
+    size = len;
+
+  if((chunk = malloc(sizeof(*chunk) + size)) == NULL)
+    exit_atomix(EXIT_FAILURE, "Unable to add additional line to the display buffer");
+
+  chunk->size = size;
+  chunk->used = 0;
+
+  if(buffer->current)
+  {
+    chunk->next = buffer->current->next;
+    buffer->current->next = chunk;
+  }
+  else
+  {
+    chunk->next = buffer->chunks;
+    buffer->chunks = chunk;
+  }
+
+  buffer->current = chunk;
 }
 
 /* ************************************************************************** */
@@ -54,8 +119,10 @@ clean_up_display(Display_t *buffer)
  * Do not provide a new line character at the end, it probably will break
  * something.
  *
- * Uses a bit of a hack of vsnprintf to figure out the storage requirement for
- * the string. The pointer for the new string is added to the DISPLAY buffer.
+ * The string is formatted straight into the space left in the current chunk
+ * of text. Only if it does not fit is it formatted again, into the next chunk.
+ * The table of lines grows by doubling. The line is written to the log file at
+ * the log level of the buffer.
  *
  * TODO check for \n or \r\n etc.
  *
@@ -65,18 +132,22 @@ void
 add_display(Display_t *buffer, char *fmt, ...)
 {
   int len;
-  int line_index;
+  int maxlines;
+  char *chars;
+  Line_t *lines;
   va_list va, va_c;
 
-  buffer->nlines++;
-  buffer->lines = realloc(buffer->lines, buffer->nlines * sizeof(Line_t));
-  line_index = buffer->nlines - 1;
-
-  if(buffer->lines == NULL)
-    exit_atomix(EXIT_FAILURE, "Unable to add additional line to the display buffer");
+  if(buffer->nlines == buffer->maxlines)
+  {
+    maxlines = buffer->maxlines > 0 ? 2 * buffer->maxlines : DISPLAY_MIN_LINES;
+    if((lines = realloc(buffer->lines, maxlines * sizeof(Line_t))) == NULL)
+      exit_atomix(EXIT_FAILURE, "Unable to add additional line to the display buffer");
+    buffer->lines = lines;
+    buffer->maxlines = maxlines;
+  }
 
-  buffer->lines[line_index].len = 0;
-  buffer->lines[line_index].chars = NULL;
+  if(buffer->current == NULL)
+    next_display_chunk(buffer, 1);
 
   /*
    * May be playing it extra safe here, but make a copy of va as va is not
@@ -86,24 +157,175 @@ add_display(Display_t *buffer, char *fmt, ...)
   va_start(va, fmt);
   va_copy(va_c, va);
 
-  len = vsnprintf(NULL, 0, fmt, va);  // Hack: write 0 to NULL to determine length :-)
-  buffer->lines[line_index].chars = malloc(len * sizeof(char) + 1);
-  len = vsprintf(buffer->lines[line_index].chars, fmt, va_c);
-  buffer->lines[line_index].chars[len] = '\0';  // I believe this is redundant, but just in case
+  chars = buffer->current->data + buffer->current->used;
+  len = vsnprintf(chars, buffer->current->size - buffer->current->used, fmt, va);
+  if(len < 0)
+    len = 0;
+  if((size_t) len >= buffer->current->size - buffer->current->used)
+  {
+    next_display_chunk(buffer, len + 1);
+    chars = buffer->current->data;
+    vsnprintf(chars, len + 1, fmt, va_c);
+  }
+  chars[len] = '\0';
+
+  va_end(va);
+  va_end(va_c);
 
   /*
    * Remove whitespace to stop being able to overscroll the buffer
    */
 
-  trim_whitespaces(buffer->lines[line_index].chars);
-  buffer->lines[line_index].len = strlen(buffer->lines[line_index].chars);;
+  while(len > 0 && isspace((unsigned char) chars[len - 1]))
+    chars[--len] = '\0';
+
+  buffer->current->used += len + 1;
+  buffer->lines[buffer->nlines].chars = chars;
+  buffer->lines[buffer->nlines].len = len;
+  buffer->nlines++;
 
-  if(buffer->maxlen < buffer->lines[line_index].len)
+  if(buffer->maxlen < len)
     buffer->maxlen = len + 1;
 
-  va_end(va);
-  va_end(va_c);
-  logfile("%s\n", buffer->lines[line_index].chars);
+  logfile_message(buffer->log_level, "%s\n", chars);
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Add a block of rows to a buffer, which are formatted when shown.
+ *
+ * @param[in]  buffer  The buffer
+ * @param[in]  ids     The id of each row, or NULL if the ids are first,
+ *                     first + 1, ...
+ * @param[in]  first   The id of the first row if ids is NULL
+ * @param[in]  nrows   The number of rows
+ * @param[in]  format  The function which formats a row from its id
+ *
+ * @details
+ *
+ * The rows go after the lines already in the buffer, and any lines added after
+ * them go after the rows. Nothing is formatted until a row is shown on the
+ * screen, so the ids must stay valid until the buffer is cleaned up. The rows
+ * are not written to the log file.
+ *
+ * A buffer can only leave one block of rows to be formatted, so if it already
+ * has one the rows are formatted and added as normal lines. The width of the
+ * buffer is first worked out from the first and last rows, and grows as the
+ * other rows are shown.
+ *
+ * ************************************************************************** */
+
+void
+add_rows_display(Display_t *buffer, int *ids, int first, int nrows, DisplayRowFormatter_t format)
+{
+  int i, len;
+  char row[DISPLAY_ROW_LEN];
+
+  if(nrows < 1)
+    return;
+
+  if(buffer->rows.nrows > 0)
+  {
+    for(i = 0; i < nrows; ++i)
+    {
+      format(ids ? ids[i] : first + i, row, sizeof(row));
+      add_display(buffer, "%s", row);
+    }
+    return;
+  }
+
+  if(buffer->rows.cache == NULL)
+  {
+    if((buffer->rows.cache = malloc(DISPLAY_NROWS_CACHED * sizeof(*buffer->rows.cache))) == NULL)
+      exit_atomix(EXIT_FAILURE, "Unable to add additional line to the display buffer");
+    for(i = 0; i < DISPLAY_NROWS_CACHED; ++i)
+      buffer->rows.cache[i].line = -1;
+  }
+
+  buffer->rows.start = buffer->nlines;
+  buffer->rows.nrows = nrows;
+  buffer->rows.first = first;
+  buffer->rows.ids = ids;
+  buffer->rows.format = format;
+
+  get_display_line(buffer, buffer->rows.start, &len);
+  get_display_line(buffer, buffer->rows.start + nrows - 1, &len);
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Get the number of lines in a buffer.
+ *
+ * @param[in]  buffer  The buffer
+ *
+ * @return  The number of lines, including the rows which are formatted when
+ *          shown
+ *
+ * ************************************************************************** */
+
+int
+count_display_lines(Display_t *buffer)
+{
+  return buffer->nlines + buffer->rows.nrows;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Get a line of a buffer.
+ *
+ * @param[in]   buffer  The buffer
+ * @param[in]   i       The line, from 0 to count_display_lines
+ * @param[out]  len     The length of the line
+ *
+ * @return  The line, which for a row formatted when shown is only valid until
+ *          another DISPLAY_NROWS_CACHED lines have been got
+ *
+ * @details
+ *
+ * Rows which are formatted when shown are kept in a cache at their line modulo
+ * DISPLAY_NROWS_CACHED, so scrolling through a window of rows only formats the
+ * rows which have come onto the screen.
+ *
+ * ************************************************************************** */
+
+char *
+get_display_line(Display_t *buffer, int i, int *len)
+{
+  int n;
+  DisplayRow_t *row;
+  DisplayRows_t *rows = &buffer->rows;
+
+  if(i < rows->start || rows->nrows < 1)
+  {
+    *len = buffer->lines[i].len;
+    return buffer->lines[i].chars;
+  }
+  if(i >= rows->start + rows->nrows)
+  {
+    *len = buffer->lines[i - rows->nrows].len;
+    return buffer->lines[i - rows->nrows].chars;
+  }
+
+  row = &rows->cache[i % DISPLAY_NROWS_CACHED];
+  if(row->line != i)
+  {
+    n = i - rows->start;
+    row->len = rows->format(rows->ids ? rows->ids[n] : rows->first + n, row->chars, DISPLAY_ROW_LEN);
+    if(row->len < 0)
+      row->len = 0;
+    if(row->len > DISPLAY_ROW_LEN - 1)
+      row->len = DISPLAY_ROW_LEN - 1;
+    row->chars[row->len] = '\0';
+    while(row->len > 0 && isspace((unsigned char) row->chars[row->len - 1]))
+      row->chars[--row->len] = '\0';
+    row->line = i;
+
+    if(buffer->maxlen < row->len)
+      buffer->maxlen = row->len + 1;
+  }
+
+  *len = row->len;
+  return row->chars;
 }
 
 /* ************************************************************************* */
@@ -165,6 +387,146 @@ update_current_line_progress(Window_t win, int current_line, int total_lines)
 
 }
 
+/* ************************************************************************** */
+/**
+ * @brief  Draw a line of a buffer as a row of a window.
+ *
+ * @param[in]  buffer  The buffer
+ * @param[in]  window  The window to draw in
+ * @param[in]  line    The line of the buffer, or -1 for an empty row
+ * @param[in]  srow    The row of the window
+ * @param[in]  scol    The column of the window to start at
+ * @param[in]  col     The first char of the line to draw
+ * @param[in]  width   The number of columns to draw
+ *
+ * @details
+ *
+ * The part of the line which is in the window is written in one go, and the
+ * rest of the row is filled with blanks, so the row does not have to be
+ * cleared before it is drawn.
+ *
+ * ************************************************************************** */
+
+static void
+draw_display_line(Display_t *buffer, WINDOW *window, int line, int srow, int scol, int col, int width)
+{
+  int n, len;
+  char *chars;
+
+  n = 0;
+  if(line >= 0 && width > 0)
+  {
+    chars = get_display_line(buffer, line, &len);
+    n = len - col;
+    if(n > width)
+      n = width;
+    if(n > 0)
+      mvwaddnstr(window, srow, scol, chars + col, n);
+    else
+      n = 0;
+  }
+
+  if(width - n > 0)
+    mvwhline(window, srow, scol + n, ' ', width - n);
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Draw the lines of a buffer which are in a window, skipping the rows
+ *         which are already showing the right part of the right line.
+ *
+ * @param[in]      buffer       The buffer
+ * @param[in]      win          The window
+ * @param[in,out]  drawn        The line drawn on each row of the window, or
+ *                              -2 if the row is not known
+ * @param[in,out]  drawn_col    The first char drawn of each line
+ * @param[in]      header_rows  The number of persistent header rows
+ * @param[in]      first_line   The line at the top of the rows under the
+ *                              header
+ * @param[in]      col          The first char of each line to draw
+ *
+ * @details
+ *
+ * The lines of a buffer do not change while it is shown, so a row only has to
+ * be drawn again when it shows a different line, or when the view has moved
+ * sideways.
+ *
+ * ************************************************************************** */
+
+static void
+draw_display_frame(Display_t *buffer, Window_t win, int *drawn, int *drawn_col, int header_rows, int first_line,
+                   int col)
+{
+  int srow, line, nlines;
+
+  nlines = count_display_lines(buffer);
+
+  for(srow = 1; srow < win.nrows - 1; ++srow)
+  {
+    if(srow <= header_rows)
+      line = srow - 1;
+    else
+      line = first_line + srow - 1 - header_rows;
+    if(line >= nlines)
+      line = -1;
+
+    if(drawn[srow] == line && *drawn_col == col)
+      continue;
+
+    draw_display_line(buffer, win.window, line, srow, 1, col, win.ncols - 2);
+    drawn[srow] = line;
+  }
+
+  *drawn_col = col;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Scroll the rows of a window under the persistent header.
+ *
+ * @param[in]      win      The window
+ * @param[in,out]  drawn    The line drawn on each row of the window, or -2 if
+ *                          the row is not known
+ * @param[in]      top      The first row under the header
+ * @param[in]      nscroll  The number of rows to scroll by, which is positive
+ *                          to move the text up
+ *
+ * @details
+ *
+ * The rows from top to the bottom of the window are made a scrolling region
+ * and moved with wscrl, which curses can send to the terminal as a scroll
+ * rather than drawing the rows again. The rows left empty are marked as not
+ * known, so draw_display_frame only has to draw these. Nothing happens if
+ * every row would scroll out of the region.
+ *
+ * ************************************************************************** */
+
+static void
+scroll_display_frame(Window_t win, int *drawn, int top, int nscroll)
+{
+  int srow, bottom;
+
+  bottom = win.nrows - 2;
+  if(nscroll == 0 || abs(nscroll) > bottom - top)
+    return;
+
+  wsetscrreg(win.window, top, bottom);
+  scrollok(win.window, true);
+  wscrl(win.window, nscroll);
+  scrollok(win.window, false);
+
+  if(nscroll > 0)
+  {
+    for(srow = top; srow <= bottom; ++srow)
+      drawn[srow] = srow + nscroll <= bottom ? drawn[srow + nscroll] : -2;
+  }
+  else
+  {
+    for(srow = bottom; srow >= top; --srow)
+      drawn[srow] = srow + nscroll >= top ? drawn[srow + nscroll] : -2;
+  }
+}
+
 /* ************************************************************************** */
 /**
  * @brief  Scroll the text buffer up and down.
@@ -181,7 +543,9 @@ update_current_line_progress(Window_t win, int current_line, int total_lines)
  *
  * The main purpose of this function is to allow the text buffer to be scrolled
  * both horizontally and vertically. The screen is only updated if a key has
- * been pressed which will scroll to avoid screen flicker.
+ * been pressed which will scroll to avoid screen flicker, and then only the
+ * rows which show a different line, or all of them if the view has moved
+ * sideways, are drawn again.
  *
  * The persistent header functionality of this function allows the first
  * header_row lines in the buffer to become frozen at the top of the window. The
@@ -194,17 +558,29 @@ update_current_line_progress(Window_t win, int current_line, int total_lines)
 void
 scroll_display(Display_t *buffer, Window_t win, bool persistent_header, int header_rows)
 {
-  int i, j;
+  int i;
   int ch;
+  int nlines;
   int row_origin, col_origin;
   int current_line, current_col;
-  int srow, scol;
+  int drawn[win.nrows], drawn_col, drawn_line;
   bool screen_position_moved;
   WINDOW *window = win.window;
 
   current_line = current_col = 0;
   row_origin = col_origin = 1;
   screen_position_moved = false;
+  nlines = count_display_lines(buffer);
+
+  /*
+   * What is already in the window is not known, so every row is drawn the
+   * first time the view moves
+   */
+
+  for(i = 0; i < win.nrows; ++i)
+    drawn[i] = -2;
+  drawn_col = 0;
+  drawn_line = -1;
 
   /*
    * The buffer and row origin have to be incremented otherwise the persistent
@@ -224,6 +600,7 @@ scroll_display(Display_t *buffer, Window_t win, bool persistent_header, int head
   }
 
   update_status_bar("press q or F1 to exit text view or use the ARROW KEYS to navigate");
+  idlok(window, true);
 
   while((ch = wgetch(window)))
   {
@@ -235,7 +612,7 @@ scroll_display(Display_t *buffer, Window_t win, bool persistent_header, int head
      * the screen
      */
 
-    if(buffer->nlines > win.nrows - 2)
+    if(nlines > win.nrows - 2)
     {
       screen_position_moved = true;
       switch (ch)
@@ -265,7 +642,7 @@ scroll_display(Display_t *buffer, Window_t win, bool persistent_header, int head
           current_line = header_rows;
           break;
         case KEY_END:
-          current_line = header_rows + buffer->nlines - (win.nrows - 2);
+          current_line = header_rows + nlines - (win.nrows - 2);
           break;
         default:
           screen_position_moved = false;
@@ -279,12 +656,10 @@ scroll_display(Display_t *buffer, Window_t win, bool persistent_header, int head
 
       if(screen_position_moved)
       {
-        wclear(window);
-
         if(current_line < header_rows)
           current_line = header_rows;
-        if(current_line + (win.nrows - row_origin - 2) > buffer->nlines - 1)
-          current_line = header_rows + buffer->nlines - (win.nrows - 2);
+        if(current_line + (win.nrows - row_origin - 2) > nlines - 1)
+          current_line = header_rows + nlines - (win.nrows - 2);
 
         if(current_col < 0)
           current_col = 0;
@@ -295,40 +670,28 @@ scroll_display(Display_t *buffer, Window_t win, bool persistent_header, int head
         AtomixConfiguration.current_col = current_col;
 
         /*
-         * Write the header to screen, char by car
+         * Only the rows which now show a different line are written to the
+         * window, rather than clearing it and writing every char again. When
+         * the view has moved by less than a page, the rows which are still
+         * shown are scrolled rather than written again
          */
 
-        if(persistent_header)
-        {
-          for(i = 0, srow = 1; i < header_rows && srow < win.nrows - 1; ++i, ++srow)
-          {
-            for(j = current_col, scol = col_origin; j < buffer->lines[i].len && scol < win.ncols - 1; ++j, ++scol)
-            {
-              mvwprintw(window, srow, scol, "%c", buffer->lines[i].chars[j]);
-            }
-          }
-        }
+        if(drawn_line >= 0 && drawn_col == current_col)
+          scroll_display_frame(win, drawn, row_origin, current_line - drawn_line);
+        draw_display_frame(buffer, win, drawn, &drawn_col, header_rows, current_line, current_col);
+        drawn_line = current_line;
 
-        /*
-         * Write the buffer to screen, taking into account any header, char
-         * by char
-         */
-
-        for(i = current_line, srow = row_origin; i < buffer->nlines && srow < win.nrows - 1; ++i, ++srow)
-        {
-          for(j = current_col, scol = col_origin; j < buffer->lines[i].len && scol < win.ncols - 1; ++j, ++scol)
-          {
-            mvwprintw(window, srow, scol, "%c", buffer->lines[i].chars[j]);
-          }
-        }
-
-        update_current_line_progress(win, current_line + 1 - header_rows, buffer->nlines - header_rows);
+        mvwhline(window, win.nrows - 1, 0, ' ', win.ncols);
+        update_current_line_progress(win, current_line + 1 - header_rows, nlines - header_rows);
         wrefresh(window);
       }
 
       screen_position_moved = false;
     }
   }
+
+  wsetscrreg(window, 0, win.nrows - 1);
+  idlok(window, false);
 }
 
 /* ************************************************************************** */
@@ -345,9 +708,9 @@ scroll_display(Display_t *buffer, Window_t win, bool persistent_header, int head
  *
  * @details
  *
- * Simply iterates through all of the lines and prints them one by one before
- * refreshing the screen. If DISPLAY.nlines is zero, or if the lines pointer in
- * DISPLAY is NULL, an error message is displayed instead.
+ * Simply iterates through the lines which fit in the window and prints them
+ * one row at a time before refreshing the screen. If there are no lines in the buffer, an error message
+ * is displayed instead.
  *
  * The persistent header functionality of this function allows the first
  * header_row lines in the buffer to become frozen at the top of the window. The
@@ -360,29 +723,24 @@ scroll_display(Display_t *buffer, Window_t win, bool persistent_header, int head
 void
 display_buffer(Display_t *buffer, int scroll, bool persisent_header, int header_rows)
 {
-  int i, j;
-  int line_index;
+  int i;
+  int nlines;
   WINDOW *window = CONTENT_VIEW_WINDOW.window;
 
   wclear(window);
+  nlines = count_display_lines(buffer);
 
-  if(buffer->nlines == 0 || buffer->lines == NULL)
+  if(nlines == 0)
   {
     bold_message(CONTENT_VIEW_WINDOW, 1, 1, "No text in %s buffer to show", buffer->name);
     wrefresh(window);
   }
   else
   {
-    for(i = 0; i < buffer->nlines && i < CONTENT_VIEW_WINDOW.nrows - 2; ++i)
-    {
-      line_index = i;
-      for(j = 0; j < buffer->lines[line_index].len && j < CONTENT_VIEW_WINDOW.ncols - 2; ++j)
-      {
-        mvwprintw(window, i + 1, j + 1, "%c", buffer->lines[line_index].chars[j]);
-      }
-    }
+    for(i = 0; i < nlines && i < CONTENT_VIEW_WINDOW.nrows - 2; ++i)
+      draw_display_line(buffer, window, i, i + 1, 1, 0, CONTENT_VIEW_WINDOW.ncols - 2);
 
-    update_current_line_progress(CONTENT_VIEW_WINDOW, 1, buffer->nlines - header_rows);
+    update_current_line_progress(CONTENT_VIEW_WINDOW, 1, nlines - header_rows);
     wrefresh(window);
 
     if(scroll == SCROLL_ENABLE)
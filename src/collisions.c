@@ -0,0 +1,194 @@
+/* ************************************************************************** */
+/**
+ * @file     collisions.c
+ *
+ * @brief
+ *
+ * Functions for calculating collision strengths and collisional rates over a
+ * grid of temperatures.
+ *
+ * @details
+ *
+ * These give the same results as upsilon, q21 and q12 in Python. The collision
+ * strength of a line comes from its Burgess & Tully (1992) fit in coll_stren
+ * if it has one, otherwise the van Regemorter g-bar approximation is used.
+ *
+ * Rather than working out the collision strength one temperature at a time,
+ * evaluate_collision_rates looks at the type of fit once for each line, and
+ * then does each step of the calculation as a loop over the temperatures. The
+ * interpolation of the fit starts each search from the points found for the
+ * previous temperature.
+ *
+ * ************************************************************************** */
+
+#include <math.h>
+
+#include "atomix.h"
+
+/// (8*PI)/(sqrt(3) *nu_1Rydberg
+#define ECS_CONSTANT 4.773691e16
+#define Q21_CONSTANT 8.629e-6
+
+/* ************************************************************************** */
+/**
+ * @brief  Calculate the collision strength and collisional rates of a line
+ *         over a grid of temperatures
+ *
+ * @param[in]   line_ptr  The line
+ * @param[in]   temp      The temperatures
+ * @param[in]   ntemp     The number of temperatures
+ * @param[out]  omega     The thermally averaged collision strength, upsilon,
+ *                        at each temperature
+ * @param[out]  q21       The collisional de-excitation rate coefficient at each
+ *                        temperature
+ * @param[out]  q12       The collisional excitation rate coefficient at each
+ *                        temperature
+ *
+ * @return  0 on success, or -1 if the line has a fit of an unknown type, in
+ *          which case nothing is calculated
+ *
+ * @details
+ *
+ * The temperatures do not need to be in order, but the interpolation of the
+ * fit is quickest when they are. q21 and q12 are used as working space until
+ * the rates are calculated.
+ *
+ * ************************************************************************** */
+
+int
+evaluate_collision_rates(struct lines *line_ptr, double *temp, int ntemp, double *omega, double *q21, double *q12)
+{
+  int k, cursor;
+  double c, log_c, ecs_gl;
+  double *u0 = q21;
+  double *x = q12;
+  Coll_strenptr cs = NULL;
+
+  if(line_ptr->coll_index >= 0)
+  {
+    if(line_ptr->coll_index >= n_coll_stren)
+      return -1;
+    cs = &coll_stren[line_ptr->coll_index];
+    if(cs->type < 1 || cs->type > 4)
+      return -1;
+  }
+
+  /* u0 is kT / h nu */
+  for(k = 0; k < ntemp; k++)
+    u0[k] = (BOLTZMANN * temp[k]) / (H * line_ptr->freq);
+
+  if(cs == NULL)
+  {
+    /* The g-bar approximation, where the gaunt factor is u0 / 10 for neutrals with u0 < 2 and is 0.2 otherwise.
+       The cut off at u0 = 2 gives a continuous function */
+    ecs_gl = ECS_CONSTANT * line_ptr->gl;
+    if(line_ptr->istate == 1)
+      for(k = 0; k < ntemp; k++)
+        omega[k] = ecs_gl * (u0[k] < 2 ? u0[k] / 10.0 : 0.2) * line_ptr->f / line_ptr->freq;
+    else
+      for(k = 0; k < ntemp; k++)
+        omega[k] = ecs_gl * 0.2 * line_ptr->f / line_ptr->freq;
+  }
+  else
+  {
+    /* The reduced temperature, x, and the reduced collision strength, y, are from Burgess & Tully 1992 */
+    c = cs->scaling_param;
+    if(cs->type == 1 || cs->type == 4)
+    {
+      log_c = log(cs->scaling_param);
+      for(k = 0; k < ntemp; k++)
+        x[k] = 1. - (log_c / log(u0[k] + c));
+    }
+    else
+    {
+      for(k = 0; k < ntemp; k++)
+        x[k] = u0[k] / (u0[k] + c);
+    }
+
+    cursor = -1;
+    for(k = 0; k < ntemp; k++)
+      linterp_cursor(x[k], cs->sct, cs->scups, cs->n_points, &omega[k], 0, &cursor);
+
+    /* There are four different parametrisations to get the collision strength from y */
+    switch (cs->type)
+    {
+    case 1:
+      for(k = 0; k < ntemp; k++)
+        omega[k] *= log(u0[k] + exp(1));
+      break;
+    case 3:
+      for(k = 0; k < ntemp; k++)
+        omega[k] /= u0[k] + 1;
+      break;
+    case 4:
+      for(k = 0; k < ntemp; k++)
+        omega[k] *= log(u0[k] + c);
+      break;
+    default:
+      break;
+    }
+  }
+
+  for(k = 0; k < ntemp; k++)
+  {
+    q21[k] = Q21_CONSTANT / (sqrt(temp[k]) * line_ptr->gu) * omega[k];
+    q12[k] = line_ptr->gu / line_ptr->gl * q21[k] * exp(-H_OVER_K * line_ptr->freq / temp[k]);
+  }
+
+  return 0;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Calculate the collisional de-excitation rate coefficient of a line
+ *
+ * @param[in]  line_ptr  The line
+ * @param[in]  t         The temperature
+ *
+ * @return  The rate coefficient, or -1 if the line has a fit of an unknown
+ *          type
+ *
+ * @details
+ *
+ * c21 = n_e * q21. See evaluate_collision_rates for more than one
+ * temperature.
+ *
+ * ************************************************************************** */
+
+double
+q21(struct lines *line_ptr, double t)
+{
+  double omega, rate21, rate12;
+
+  if(evaluate_collision_rates(line_ptr, &t, 1, &omega, &rate21, &rate12))
+    return -1;
+
+  return rate21;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Calculate the collisional excitation rate coefficient of a line
+ *
+ * @param[in]  line_ptr  The line
+ * @param[in]  t         The temperature
+ *
+ * @return  The rate coefficient, or -1 if the line has a fit of an unknown
+ *          type
+ *
+ * @details
+ *
+ * This uses detailed balance, q12 = g_u / g_l q21 exp(-h nu / kT).
+ *
+ * ************************************************************************** */
+
+double
+q12(struct lines *line_ptr, double t)
+{
+  double omega, rate21, rate12;
+
+  if(evaluate_collision_rates(line_ptr, &t, 1, &omega, &rate21, &rate12))
+    return -1;
+
+  return rate12;
+}
@@ -0,0 +1,210 @@
+/* ************************************************************************** */
+/**
+ * @file     coverage.c
+ *
+ * @brief
+ *
+ * Functions for finding the edges which have a cross section at a frequency.
+ *
+ * @details
+ *
+ * limit_edges finds the edges with a threshold in a frequency range, but an
+ * edge continues to absorb above its threshold, up to the last frequency of
+ * its cross section. To find all of the edges which absorb in a frequency
+ * range, each frequency ordered list of edges has a tree of the highest
+ * frequency of the cross sections below each node.
+ *
+ * The tree is stored as an array, where node i has the children 2i and 2i + 1
+ * and the leaves are the edges in frequency order. The edges which absorb in
+ * a range are those with a threshold below the top of the range, which are at
+ * the start of the list, and a highest frequency above the bottom of the
+ * range, which are found by skipping any part of the tree where the highest
+ * frequency is too low.
+ *
+ * ************************************************************************** */
+
+#include "atomix.h"
+
+/* ************************************************************************** */
+/**
+ * @brief  Get the number of leaves in the tree for a list of edges
+ *
+ * @param[in]  nedges  The number of edges
+ *
+ * @return  The smallest power of two which is at least nedges
+ *
+ * ************************************************************************** */
+
+static int
+count_leaves(int nedges)
+{
+  int nleaves = 1;
+
+  while(nleaves < nedges)
+    nleaves *= 2;
+
+  return nleaves;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Get the size of the tree for a list of edges
+ *
+ * @param[in]  nedges  The number of edges
+ *
+ * @return  The number of entries in the tree
+ *
+ * ************************************************************************** */
+
+int
+coverage_tree_size(int nedges)
+{
+  return 2 * count_leaves(nedges);
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Make the tree for a frequency ordered list of edges
+ *
+ * @param[out]  tree    The tree, with space for twice the number of leaves
+ * @param[in]   edges   The edges, i.e. phot_top_ptr or inner_cross_ptr
+ * @param[in]   nedges  The number of edges
+ *
+ * @details
+ *
+ * The leaves past the end of the list are given a highest frequency of -1, so
+ * are never found.
+ *
+ * ************************************************************************** */
+
+static void
+build_coverage_tree(double *tree, TopPhotPtr *edges, int nedges)
+{
+  int i;
+  int nleaves = count_leaves(nedges);
+
+  for(i = 0; i < nleaves; i++)
+  {
+    if(i < nedges)
+      tree[nleaves + i] = edges[i]->np > 0 ? edges[i]->freq[edges[i]->np - 1] : edges[i]->freq[0];
+    else
+      tree[nleaves + i] = -1;
+  }
+
+  for(i = nleaves - 1; i > 0; i--)
+    tree[i] = tree[2 * i] > tree[2 * i + 1] ? tree[2 * i] : tree[2 * i + 1];
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Make the coverage trees for the photoionization and inner shell
+ *         edges
+ *
+ * @return  0 on success, or ATOMIC_MEMORY_ISSUE_ERROR if the trees could not
+ *          be allocated
+ *
+ * @details
+ *
+ * This has to be done whenever the order of the edges is set, i.e. after
+ * index_phot_top and index_inner_cross. The trees are saved in the snapshot in
+ * the cache, so are not made again when the atomic data is read from there.
+ *
+ * ************************************************************************** */
+
+int
+index_edge_coverage(void)
+{
+  if(reserve_atomic_table(TABLE_PHOT_TOP_COVERAGE, coverage_tree_size(nphot_total))
+     || reserve_atomic_table(TABLE_INNER_CROSS_COVERAGE, coverage_tree_size(n_inner_tot)))
+    return ATOMIC_MEMORY_ISSUE_ERROR;
+
+  build_coverage_tree(phot_top_coverage, phot_top_ptr, nphot_total);
+  build_coverage_tree(inner_cross_coverage, inner_cross_ptr, n_inner_tot);
+
+  return 0;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Add the edges below a node of a tree which absorb above a frequency
+ *
+ * @param[in]   tree     The tree
+ * @param[in]   node     The node
+ * @param[in]   lo       The position of the first edge below the node
+ * @param[in]   hi       The position after the last edge below the node
+ * @param[in]   nlast    The position after the last edge to consider
+ * @param[in]   freqmin  The frequency
+ * @param[out]  edges    The edges found
+ * @param[out]  nfound   The number of edges found
+ *
+ * ************************************************************************** */
+
+static void
+collect_covering_edges(double *tree, int node, int lo, int hi, int nlast, double freqmin, int *edges, int *nfound)
+{
+  int mid;
+
+  if(lo >= nlast || tree[node] < freqmin)
+    return;
+
+  if(hi - lo == 1)
+  {
+    edges[(*nfound)++] = lo;
+    return;
+  }
+
+  mid = (lo + hi) / 2;
+  collect_covering_edges(tree, 2 * node, lo, mid, nlast, freqmin, edges, nfound);
+  collect_covering_edges(tree, 2 * node + 1, mid, hi, nlast, freqmin, edges, nfound);
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Find the edges which have a cross section in a frequency range
+ *
+ * @param[in]   threshold  The frequency ordered thresholds, i.e.
+ *                         phot_top_threshold or inner_cross_threshold
+ * @param[in]   tree       The coverage tree, i.e. phot_top_coverage or
+ *                         inner_cross_coverage
+ * @param[in]   nedges     The number of edges
+ * @param[in]   freqmin    The minimum frequency we are interested in
+ * @param[in]   freqmax    The maximum frequency we are interested in
+ * @param[out]  edges      The positions of the edges found in the frequency
+ *                         ordered list, with space for nedges entries
+ *
+ * @return  The number of edges found
+ *
+ * @details
+ *
+ * An edge is found if the range of its cross section, from its threshold to
+ * its last frequency, overlaps freqmin to freqmax. The edges are found in
+ * frequency order.
+ *
+ * ************************************************************************** */
+
+int
+find_covering_edges(double *threshold, double *tree, int nedges, double freqmin, double freqmax, int *edges)
+{
+  int n, nmin, nlast;
+  int nfound;
+
+  if(nedges <= 0)
+    return 0;
+
+  /* Find the first threshold > freqmax, as none of the edges from there on absorb in the range */
+  nmin = 0;
+  nlast = nedges;
+  while(nmin < nlast)
+  {
+    n = (nmin + nlast) >> 1;
+    if(threshold[n] > freqmax)
+      nlast = n;
+    else
+      nmin = n + 1;
+  }
+
+  nfound = 0;
+  collect_covering_edges(tree, 1, 0, count_leaves(nedges), nlast, freqmin, edges, &nfound);
+
+  return nfound;
+}
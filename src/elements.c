@@ -59,7 +59,8 @@ element_line(struct elements e)
 /**
  * @brief  Print standard information about an element to screen.
  *
- * @param[in]  e  The element to print to screen
+ * @param[in]  nelem     The element number of the element to print to screen
+ * @param[in]  detailed  If true, the BB and BF information will be printed
  *
  * @details
  *
@@ -68,10 +69,16 @@ element_line(struct elements e)
  * ************************************************************************** */
 
 void
-single_element_info(struct elements e, int detailed)
+single_element_info(int nelem, int detailed)
 {
   int i, n;
+  int *entries;
   double wavelength;
+  LinePtr l;
+  TopPhotPtr x;
+  struct elements e;
+
+  e = ele[nelem];
 
   display_add(" Element: %s", e.name);
   add_sep_display(ndash);
@@ -90,16 +97,13 @@ single_element_info(struct elements e, int detailed)
   add_sep_display(ndash);
   display_add(" %-12s %-12s %-12s %-12s", "Ionisation", "Wavelength", "levu", "levl");
 
-  n = 0;
+  entries = get_element_postings(nelem, POSTING_LINES, &n);
 
-  for(i = 0; i < nlines; ++i)
+  for(i = 0; i < n; ++i)
   {
-    if(lin_ptr[i]->z == e.z)
-    {
-      n++;
-      wavelength = C_SI / lin_ptr[i]->freq / ANGSTROM / 1e-2;
-      display_add(" %-12i %-12.2f %-12i %-12i", lin_ptr[i]->istate, wavelength, lin_ptr[i]->levu, lin_ptr[i]->levl);
-    }
+    l = get_line(entries[i]);
+    wavelength = C_SI / l->freq / ANGSTROM / 1e-2;
+    display_add(" %-12i %-12.2f %-12i %-12i", l->istate, wavelength, l->levu, l->levl);
   }
 
   add_sep_display(ndash);
@@ -110,17 +114,13 @@ single_element_info(struct elements e, int detailed)
   add_sep_display(ndash);
   display_add(" %-12s %-12s %-12s %-12s", "Ionisation", "Wavelength", "n", "l");
 
-  n = 0;
+  entries = get_element_postings(nelem, POSTING_PHOT_TOP, &n);
 
-  for(i = 0; i < nphot_total; ++i)
+  for(i = 0; i < n; ++i)
   {
-    if(phot_top_ptr[i]->z == e.z)
-    {
-      n++;
-      wavelength = C_SI / phot_top_ptr[i]->freq[0] / ANGSTROM / 1e-2;
-      display_add(" %-12i %-12.2f %-12i %-12i", phot_top_ptr[i]->istate, wavelength, phot_top_ptr[i]->n,
-                  phot_top_ptr[i]->l);
-    }
+    x = phot_top_ptr[entries[i]];
+    wavelength = C_SI / x->freq[0] / ANGSTROM / 1e-2;
+    display_add(" %-12i %-12.2f %-12i %-12i", x->istate, wavelength, x->n, x->l);
   }
 
   add_sep_display(ndash);
@@ -132,17 +132,13 @@ single_element_info(struct elements e, int detailed)
   add_sep_display(ndash);
   display_add(" %-12s %-12s %-12s %-12s", "Ionisation", "Wavelength", "n", "l");
 
-  n = 0;
+  entries = get_element_postings(nelem, POSTING_INNER_CROSS, &n);
 
-  for(i = 0; i < n_inner_tot; ++i)
+  for(i = 0; i < n; ++i)
   {
-    if(inner_cross_ptr[i]->z == e.z)
-    {
-      n++;
-      wavelength = C_SI / inner_cross_ptr[i]->freq[0] / ANGSTROM / 1e-2;
-      display_add(" %-12i %-12.2f %-12i %-12i", inner_cross_ptr[i]->istate, wavelength, inner_cross_ptr[i]->n,
-                  inner_cross_ptr[i]->l);
-    }
+    x = inner_cross_ptr[entries[i]];
+    wavelength = C_SI / x->freq[0] / ANGSTROM / 1e-2;
+    display_add(" %-12i %-12.2f %-12i %-12i", x->istate, wavelength, x->n, x->l);
   }
 
   add_sep_display(ndash);
@@ -214,6 +210,6 @@ single_element(void)
   }
 
   add_sep_display(ndash);
-  single_element_info(ele[i], true);
+  single_element_info(i, true);
   display_show(SCROLL_ENABLE, false, 0);
 }
@@ -0,0 +1,244 @@
+/* ************************************************************************** */
+/**
+ * @file     equilibrium.c
+ *
+ * @brief
+ *
+ * Functions for calculating the collisional ionization equilibrium of the
+ * elements over a grid of temperatures.
+ *
+ * @details
+ *
+ * In coronal, or collisional, ionization equilibrium the ions of an element
+ * are only ionized by electron collisions and only recombine radiatively or
+ * dielectronically. The rate equations for the ions of an element form a
+ * tridiagonal chain, which in the steady state reduces to
+ *
+ * n_{i+1} / n_i = C_i / (alpha^RR_{i+1} + alpha^DR_{i+1})
+ *
+ * where C_i is the Dere direct ionization rate of ion i. The ratios are summed
+ * in log space so that the fractions of the highest and lowest ions do not
+ * overflow, and each element is solved independently of the others.
+ *
+ * The temperature grid is split into chunks, one for each thread, and each
+ * thread calculates the rates and solves every element for its temperatures.
+ *
+ * ************************************************************************** */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "atomix.h"
+
+#define EQUILIBRIUM_MIN_PER_THREAD 32
+
+typedef struct EquilibriumTask_t
+{
+  double *temp;
+  int ntemp;
+  double *frac;                 /* The fractions of every ion over the whole grid */
+  int lo, hi;                   /* The part of the grid to calculate */
+  int status;                   /* 0 on success, or ATOMIC_MEMORY_ISSUE_ERROR */
+} EquilibriumTask_t;
+
+/* ************************************************************************** */
+/**
+ * @brief  Solve the ionization balance of an element at one temperature
+ *
+ * @param[in]   nelem    The element
+ * @param[in]   ntemp    The number of temperatures in the rates
+ * @param[in]   k        The temperature to solve at
+ * @param[in]   ioniz    The ionization rate of every ion
+ * @param[in]   recomb   The recombination rate of every ion
+ * @param[out]  log_n    Working space for the log population of each ion of
+ *                       the element
+ * @param[out]  frac     The fraction of every ion over the whole grid
+ * @param[in]   nfrac    The number of temperatures in frac
+ * @param[in]   kfrac    The position of the temperature in frac
+ *
+ * @details
+ *
+ * If an ion is not ionized, every ion above it has a fraction of zero, and if
+ * an ion is ionized but the ion above it does not recombine, every ion below
+ * it has a fraction of zero. If the element has only one ion, or none of its
+ * ions have any rate data, its lowest ion has a fraction of one.
+ *
+ * ************************************************************************** */
+
+static void
+solve_element(int nelem, int ntemp, int k, double *ioniz, double *recomb, double *log_n, double *frac, int nfrac,
+              int kfrac)
+{
+  int i, lo, hi, first, nion;
+  double ci, ar, log_max, sum;
+
+  first = ele[nelem].firstion;
+  nion = ele[nelem].nions;
+
+  /* Find the ions which have a population, from lo to hi */
+  lo = 0;
+  hi = nion - 1;
+  for(i = 0; i < nion - 1; i++)
+  {
+    ci = ioniz[(first + i) * ntemp + k];
+    ar = recomb[(first + i + 1) * ntemp + k];
+    if(!(ci > 0))
+    {
+      hi = i;
+      break;
+    }
+    if(!(ar > 0))
+      lo = i + 1;
+  }
+
+  log_n[lo] = 0;
+  log_max = 0;
+  for(i = lo; i < hi; i++)
+  {
+    log_n[i + 1] = log_n[i] + log(ioniz[(first + i) * ntemp + k]) - log(recomb[(first + i + 1) * ntemp + k]);
+    if(log_n[i + 1] > log_max)
+      log_max = log_n[i + 1];
+  }
+
+  sum = 0;
+  for(i = lo; i <= hi; i++)
+  {
+    log_n[i] = exp(log_n[i] - log_max);
+    sum += log_n[i];
+  }
+
+  for(i = 0; i < nion; i++)
+    frac[(first + i) * nfrac + kfrac] = i >= lo && i <= hi ? log_n[i] / sum : 0;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Calculate the ionization equilibrium over part of the grid
+ *
+ * @param[in]  arg  The task
+ *
+ * @return  NULL
+ *
+ * @details
+ *
+ * The recombination rate of an ion is its total radiative recombination rate,
+ * or its ground state rate if it has no total rate, plus its dielectronic
+ * recombination rate.
+ *
+ * ************************************************************************** */
+
+static void *
+run_equilibrium_task(void *arg)
+{
+  int i, k, n, ntemp, max_ions;
+  double *rates, *dr, *rr, *gs_rr, *di, *log_n;
+  EquilibriumTask_t *task = arg;
+
+  ntemp = task->hi - task->lo;
+
+  max_ions = 1;
+  for(n = 0; n < nelements; n++)
+    if(ele[n].nions > max_ions)
+      max_ions = ele[n].nions;
+
+  rates = malloc((4 * (long) nions * ntemp + max_ions) * sizeof(*rates));
+  if(rates == NULL)
+  {
+    task->status = ATOMIC_MEMORY_ISSUE_ERROR;
+    return NULL;
+  }
+
+  dr = rates;
+  rr = dr + (long) nions * ntemp;
+  gs_rr = rr + (long) nions * ntemp;
+  di = gs_rr + (long) nions * ntemp;
+  log_n = di + (long) nions * ntemp;
+
+  if((task->status = evaluate_ion_rates(&task->temp[task->lo], ntemp, dr, rr, gs_rr, di)) == 0)
+  {
+    for(n = 0; n < nions; n++)
+    {
+      if(ions[n].total_rrflag)
+        for(k = 0; k < ntemp; k++)
+          rr[n * ntemp + k] += dr[n * ntemp + k];
+      else
+        for(k = 0; k < ntemp; k++)
+          rr[n * ntemp + k] = gs_rr[n * ntemp + k] + dr[n * ntemp + k];
+    }
+
+    for(n = 0; n < nelements; n++)
+    {
+      if(ele[n].nions < 1 || ele[n].firstion < 0 || ele[n].firstion + ele[n].nions > nions)
+        continue;
+      for(k = 0; k < ntemp; k++)
+        solve_element(n, ntemp, k, di, rr, log_n, task->frac, task->ntemp, task->lo + k);
+    }
+  }
+  else
+  {
+    for(i = 0; i < nions; i++)
+      for(k = task->lo; k < task->hi; k++)
+        task->frac[i * task->ntemp + k] = 0;
+  }
+
+  free(rates);
+
+  return NULL;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Calculate the collisional ionization equilibrium of every element
+ *         over a grid of temperatures
+ *
+ * @param[in]   temp      The temperatures
+ * @param[in]   ntemp     The number of temperatures
+ * @param[out]  frac      The fraction of each ion of its element, nions * ntemp
+ *                        long, where the fraction of ion nion at temp[k] is at
+ *                        nion * ntemp + k
+ * @param[out]  nthreads  The number of threads used, or NULL
+ *
+ * @return  0 on success, -1 if a temperature is not positive, or
+ *          ATOMIC_MEMORY_ISSUE_ERROR if there was not enough memory
+ *
+ * ************************************************************************** */
+
+int
+ionization_equilibrium(double *temp, int ntemp, double *frac, int *nthreads)
+{
+  int i, nparts;
+  EquilibriumTask_t tasks[PARALLEL_MAX_THREADS];
+
+  for(i = 0; i < ntemp; i++)
+    if(!(temp[i] > 0))
+      return -1;
+
+  if(nthreads)
+    *nthreads = 0;
+  if(ntemp < 1)
+    return 0;
+
+  nparts = count_parallel_chunks(ntemp, EQUILIBRIUM_MIN_PER_THREAD);
+
+  for(i = 0; i < nparts; i++)
+  {
+    tasks[i].temp = temp;
+    tasks[i].ntemp = ntemp;
+    tasks[i].frac = frac;
+    tasks[i].lo = (int) ((long) ntemp * i / nparts);
+    tasks[i].hi = (int) ((long) ntemp * (i + 1) / nparts);
+    tasks[i].status = 0;
+  }
+
+  run_parallel_tasks(run_equilibrium_task, tasks, sizeof(*tasks), nparts);
+
+  if(nthreads)
+    *nthreads = nparts;
+
+  for(i = 0; i < nparts; i++)
+    if(tasks[i].status)
+      return tasks[i].status;
+
+  return 0;
+}
@@ -0,0 +1,283 @@
+/* ************************************************************************** */
+/**
+ * @file     free_free.c
+ *
+ * @brief
+ *
+ * Functions for querying the free-free gaunt factors, emissivity and opacity.
+ *
+ * @details
+ *
+ * The emissivity and opacity are for a plasma with a hydrogen number density
+ * of 1 cm^-3 and the abundances of the elements in the atomic data. The ions
+ * are either in collisional ionization equilibrium, or have the fractions
+ * given in a file.
+ *
+ * ************************************************************************** */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "atomix.h"
+
+static const int ndash = 70;
+
+#define GAUNT_VIEW_NTEMPS 41
+#define GAUNT_VIEW_NCHARGES 8
+#define FREE_FREE_VIEW_NPOINTS 500
+#define FREE_FREE_EXPORT_NPOINTS 10000
+
+/* ************************************************************************** */
+/**
+ * @brief  Print the free-free gaunt factors over a temperature range.
+ *
+ * @details
+ *
+ * Each row of the table is a temperature and each column is an ion charge.
+ * The temperature range is queried within the function.
+ *
+ * ************************************************************************** */
+
+void
+free_free_gaunt(void)
+{
+  int k, z, len;
+  double tmin, tmax;
+  double temp[GAUNT_VIEW_NTEMPS];
+  double gsqrd[GAUNT_VIEW_NTEMPS * GAUNT_VIEW_NCHARGES];
+  double gff[GAUNT_VIEW_NTEMPS * GAUNT_VIEW_NCHARGES];
+  char row[LINELEN * 2];
+
+  if(query_temperature_range(&tmin, &tmax) == FORM_QUIT)
+    return;
+
+  temperature_grid(temp, GAUNT_VIEW_NTEMPS, tmin, tmax);
+
+  for(k = 0; k < GAUNT_VIEW_NTEMPS; ++k)
+    for(z = 1; z <= GAUNT_VIEW_NCHARGES; ++z)
+      gsqrd[k * GAUNT_VIEW_NCHARGES + z - 1] = z * z * RYD2ERGS / (BOLTZMANN * temp[k]);
+
+  evaluate_gaunt_ff(gsqrd, GAUNT_VIEW_NTEMPS * GAUNT_VIEW_NCHARGES, gff);
+
+  display_add(" Free-free gaunt factors: %.2e - %.2e K", tmin, tmax);
+  add_sep_display(ndash);
+
+  len = sprintf(row, " %-12s", "Temperature");
+  for(z = 1; z <= GAUNT_VIEW_NCHARGES; ++z)
+    len += sprintf(row + len, " Z = %-6i", z);
+  display_add("%s", row);
+
+  for(k = 0; k < GAUNT_VIEW_NTEMPS; ++k)
+  {
+    len = sprintf(row, " %-12.4e", temp[k]);
+    for(z = 1; z <= GAUNT_VIEW_NCHARGES; ++z)
+      len += sprintf(row + len, " %-10.4f", gff[k * GAUNT_VIEW_NCHARGES + z - 1]);
+    display_add("%s", row);
+  }
+
+  add_sep_display(ndash);
+  display_add(" From %i Sutherland (1998) frequency averaged gaunt factors", gaunt_n_gsqrd);
+
+  display_show(SCROLL_ENABLE, true, 4);
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Calculate the free-free emissivity and opacity over a wavelength
+ *         range given by the user.
+ *
+ * @param[in]   npoints     The number of points in the grid
+ * @param[out]  freq        The frequency grid, in ascending order
+ * @param[out]  emissivity  The emissivity on the grid
+ * @param[out]  opacity     The opacity on the grid
+ * @param[out]  t_e         The temperature
+ * @param[out]  wmin        The minimum wavelength
+ * @param[out]  wmax        The maximum wavelength
+ * @param[out]  fractions   The ion fractions file, or an empty string if the
+ *                          ions are in collisional ionization equilibrium
+ * @param[out]  ne          The electron density
+ *
+ * @return  EXIT_SUCCESS, FORM_QUIT if the user quit or EXIT_FAILURE if the
+ *          spectrum could not be calculated
+ *
+ * @details
+ *
+ * The temperature, wavelength range and ion fractions file are queried within
+ * the function. The grid is evenly spaced in log wavelength.
+ *
+ * ************************************************************************** */
+
+static int
+calculate_free_free(int npoints, double *freq, double *emissivity, double *opacity, double *t_e, double *wmin,
+                    double *wmax, char *fractions, double *ne)
+{
+  int k, n, nion, status;
+  double *density;
+
+  static char default_fractions[FIELD_INPUT_LEN] = "";
+
+  if(query_temperature(t_e) == FORM_QUIT)
+    return FORM_QUIT;
+  if(query_wavelength_range(wmin, wmax) == FORM_QUIT)
+    return FORM_QUIT;
+  if(query_file_path("Ion fractions file : ",
+                     "Input a file of ion fractions, or leave blank for collisional ionization equilibrium",
+                     default_fractions) == FORM_QUIT)
+    return FORM_QUIT;
+
+  strcpy(fractions, default_fractions);
+
+  if((density = malloc(nions * sizeof(*density))) == NULL)
+  {
+    error_atomix("Unable to allocate memory for the ion densities");
+    return EXIT_FAILURE;
+  }
+
+  if(strlen(fractions) > 0)
+  {
+    if(read_ion_fractions(fractions, density) < 0)
+    {
+      error_atomix("Unable to open ion fractions file %s", fractions);
+      free(density);
+      return EXIT_FAILURE;
+    }
+  }
+  else if(ionization_equilibrium(t_e, 1, density, NULL))
+  {
+    error_atomix("Unable to calculate the ionization equilibrium at %.2e K", *t_e);
+    free(density);
+    return EXIT_FAILURE;
+  }
+
+  /* The fractions are turned into densities for a hydrogen density of 1 */
+  for(n = 0; n < nelements; ++n)
+    for(nion = ele[n].firstion; nion < ele[n].firstion + ele[n].nions && nion < nions; ++nion)
+      density[nion] *= ele[n].abun;
+
+  for(k = 0; k < npoints; ++k)
+    freq[k] = C / (*wmax * pow(*wmin / *wmax, k / (double) (npoints - 1)) * ANGSTROM);
+
+  status = free_free_spectrum(*t_e, density, freq, npoints, emissivity, opacity, ne);
+  free(density);
+
+  if(status)
+  {
+    error_atomix("Unable to calculate the free-free emissivity and opacity");
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Print the free-free emissivity and opacity over a wavelength range.
+ *
+ * @details
+ *
+ * Each line of the ion fractions file is the atomic number, ionisation state
+ * and fraction of an ion, and ions not in the file have no density.
+ *
+ * ************************************************************************** */
+
+void
+free_free_emission(void)
+{
+  int k;
+  double t_e, wmin, wmax, ne;
+  double freq[FREE_FREE_VIEW_NPOINTS];
+  double emissivity[FREE_FREE_VIEW_NPOINTS];
+  double opacity[FREE_FREE_VIEW_NPOINTS];
+  char fractions[FIELD_INPUT_LEN];
+
+  if(calculate_free_free(FREE_FREE_VIEW_NPOINTS, freq, emissivity, opacity, &t_e, &wmin, &wmax, fractions, &ne))
+    return;
+
+  display_add(" Free-free emission at %.2e K: %.2f - %.2f Angstroms", t_e, wmin, wmax);
+  add_sep_display(ndash);
+  display_add(" %-12s %-12s %-12s %-12s", "Wavelength", "Frequency", "Emissivity", "Opacity");
+  add_sep_display(ndash);
+
+  for(k = FREE_FREE_VIEW_NPOINTS - 1; k >= 0; --k)
+    display_add(" %-12.2f %-12.4e %-12.4e %-12.4e", C / freq[k] / ANGSTROM, freq[k], emissivity[k], opacity[k]);
+
+  add_sep_display(ndash);
+  if(strlen(fractions) > 0)
+  {
+    display_add(" Using the ion fractions in %s", fractions);
+  }
+  else
+  {
+    display_add(" Using collisional ionization equilibrium");
+  }
+  display_add(" For n_H = 1 cm^-3 and n_e = %.4e cm^-3", ne);
+
+  display_show(SCROLL_ENABLE, true, 4);
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Write the free-free emissivity and opacity over a wavelength range
+ *         to a file.
+ *
+ * @details
+ *
+ * This is the same as free_free_emission, but on a finer grid which is written
+ * to a file given by the user, in ascending wavelength.
+ *
+ * ************************************************************************** */
+
+void
+free_free_emission_export(void)
+{
+  int k;
+  double t_e, wmin, wmax, ne;
+  double *freq, *emissivity, *opacity;
+  char fractions[FIELD_INPUT_LEN];
+  FILE *fptr;
+
+  static char output[FIELD_INPUT_LEN] = "free_free.txt";
+
+  freq = malloc(3 * FREE_FREE_EXPORT_NPOINTS * sizeof(*freq));
+  if(freq == NULL)
+  {
+    error_atomix("Unable to allocate memory for the free-free emission");
+    return;
+  }
+  emissivity = freq + FREE_FREE_EXPORT_NPOINTS;
+  opacity = emissivity + FREE_FREE_EXPORT_NPOINTS;
+
+  if(calculate_free_free(FREE_FREE_EXPORT_NPOINTS, freq, emissivity, opacity, &t_e, &wmin, &wmax, fractions, &ne)
+     || query_file_path("Output file : ", "Input the file to write the free-free emission to", output) == FORM_QUIT)
+    goto cleanup;
+
+  if(strlen(output) == 0 || (fptr = fopen(output, "w")) == NULL)
+  {
+    error_atomix("Unable to open output file %s", output);
+    goto cleanup;
+  }
+
+  fprintf(fptr, "# Free-free emission at %.4e K: %.2f - %.2f Angstroms\n", t_e, wmin, wmax);
+  if(strlen(fractions) > 0)
+    fprintf(fptr, "# Using the ion fractions in %s\n", fractions);
+  else
+    fprintf(fptr, "# Using collisional ionization equilibrium\n");
+  fprintf(fptr, "# For n_H = 1 cm^-3 and n_e = %.6e cm^-3\n", ne);
+  fprintf(fptr, "# %-12s %-14s %-14s %-14s\n", "Wavelength", "Frequency", "Emissivity", "Opacity");
+  for(k = FREE_FREE_EXPORT_NPOINTS - 1; k >= 0; --k)
+    fprintf(fptr, "%-14.6e %-14.6e %-14.6e %-14.6e\n", C / freq[k] / ANGSTROM, freq[k], emissivity[k], opacity[k]);
+  fclose(fptr);
+
+  display_add(" Free-free emission at %.2e K: %.2f - %.2f Angstroms", t_e, wmin, wmax);
+  display_add(" For n_H = 1 cm^-3 and n_e = %.4e cm^-3", ne);
+  display_add(" Wrote %i points to %s", FREE_FREE_EXPORT_NPOINTS, output);
+
+  display_show(SCROLL_ENABLE, false, 0);
+
+cleanup:
+  free(freq);
+}
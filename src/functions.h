@@ -1,13 +1,19 @@
 /* lines.c */
 void bound_bound_header(void);
+int format_bound_bound_line(int n, char *row, int size);
 void bound_bound_line(int n);
 void all_bound_bound(void);
 void bound_bound_wavelength_range(void);
 void bound_bound_element(void);
 void bound_bound_ion(void);
+void bound_bound_collisions(void);
+void bound_bound_collisions_export(void);
 /* buffer.c */
 void clean_up_display(Display_t *buffer);
 void add_display(Display_t *buffer, char *fmt, ...);
+void add_rows_display(Display_t *buffer, int *ids, int first, int nrows, DisplayRowFormatter_t format);
+int count_display_lines(Display_t *buffer);
+char *get_display_line(Display_t *buffer, int i, int *len);
 void add_sep_display(const int len);
 void update_current_line_progress(Window_t win, int current_line, int total_lines);
 void scroll_display(Display_t *buffer, Window_t win, _Bool persistent_header, int header_rows);
@@ -25,6 +31,8 @@ void bound_free_main_menu(void);
 void elements_main_menu(void);
 void ions_main_menu(void);
 void inner_shell_main_menu(void);
+void rates_main_menu(void);
+void free_free_main_menu(void);
 void levels_main_menu(void);
 /* tools.c */
 void get_element_name(int z, char *element);
@@ -36,6 +44,9 @@ void menu_exit_atomix(void);
 char *trim_whitespaces(char *str);
 void count(int ndash, int count);
 int create_string(char *str, char *fmt, ...);
+void temperature_grid(double *temp, int ntemp, double tmin, double tmax);
+int count_parallel_chunks(int n, int min_per_thread);
+void run_parallel_tasks(void *(*fn)(void *), void *tasks, size_t task_size, int ntasks);
 /* ui.c */
 void initialise_ncurses_stdscr(void);
 void cleanup_ncurses_stdscr(void);
@@ -47,24 +58,105 @@ void update_status_bar(char *fmt, ...);
 void home_screen(void);
 /* photoionization.c */
 void bound_free_header(void);
+int format_bound_free_line(int nphot, char *row, int size);
 void bound_free_line(int nphot);
 void all_bound_free(void);
 void bound_free_wavelength_range(void);
+void bound_free_coverage(void);
 void bound_free_element(void);
 void bound_free_ion(void);
+void bound_free_evaluate(void);
+void bound_free_opacity(void);
+void bound_free_opacity_export(void);
 /* atomic_data.c */
 void view_atomic_summary(void);
 int fraction(double value, double array[], int npts, int *ival, double *f, int mode);
 int linterp(double x, double xarray[], double yarray[], int xdim, double *y, int mode);
+int fraction_cursor(double value, double array[], int npts, int *ival, double *f, int mode);
+int linterp_cursor(double x, double xarray[], double yarray[], int xdim, double *y, int mode, int *cursor);
 int index_phot_top(void);
 int index_inner_cross(void);
-void indexx(int n, float arrin[], int indx[]);
 int limit_lines(double freqmin, double freqmax);
+int index_edge_thresholds(void);
+int limit_edges(double *threshold, int nedges, double freqmin, double freqmax, int *nfirst);
 int check_xsections(void);
 double a21(struct lines *line_ptr);
 double upsilon(int n_coll, double u0);
 int index_lines(void);
+int index_line_columns(void);
+int index_line_rates(void);
+int scan_line_record(char *aline, LinePtr l);
+int find_ion_level(int nion, int ilv);
+void match_line_to_levels(LinePtr l);
+int get_atomic_data_path(char *name, int use_relative, int masterfile, char *path);
+void attach_xsection_to_pool(TopPhotPtr xsection, int offset);
+int reserve_xsection_points(int np);
+int read_xsection_points(AtomicFile_t *afile, int np, int *offset, int *lineno);
+char classify_atomic_data_record(char *word);
+int read_atomic_data(AtomicLoader_t *loader);
 int get_atomic_data(char *masterfile, int use_relative);
+/* atomic_cache.c */
+void release_atomic_data_cache(void);
+int save_atomic_data_cache(char *masterfile, int use_relative);
+int load_atomic_data_cache(char *masterfile, int use_relative);
+/* atomic_loader.c */
+int parse_atomic_data_record(char *aline, char choice, AtomicValues_t *values);
+int start_atomic_data_loader(AtomicLoader_t *loader, FILE *mptr, int use_relative);
+AtomicFile_t *get_staged_atomic_data_file(AtomicLoader_t *loader, int n);
+AtomicRecord_t *read_atomic_data_record(AtomicFile_t *afile, char *aline);
+void read_atomic_record_values(AtomicFile_t *afile, AtomicRecord_t *record, char choice, char *aline,
+                               AtomicValues_t *values);
+void free_staged_atomic_data_file(AtomicFile_t *afile);
+void stop_atomic_data_loader(AtomicLoader_t *loader);
+/* atomic_tables.c */
+int reserve_atomic_table(AtomicTableId_t id, int n);
+void attach_atomic_table(AtomicTableId_t id, void *data);
+void free_atomic_tables(void);
+void log_atomic_tables(void);
+/* sort.c */
+int sort_by_frequency(SortKey_t *keys, int n);
+/* postings.c */
+int count_postings(void);
+int index_postings(void);
+int *get_ion_postings(int nion, PostingType_t type, int *n);
+int *get_element_postings(int nelem, PostingType_t type, int *n);
+/* coverage.c */
+int coverage_tree_size(int nedges);
+int index_edge_coverage(void);
+int find_covering_edges(double *threshold, double *tree, int nedges, double freqmin, double freqmax, int *edges);
+/* xsection.c */
+int xsection_uses_simd(void);
+int evaluate_xsection(TopPhotPtr xsection, double *freq, int nfreq, double *sigma);
+/* opacity.c */
+int total_bf_opacity(double *freq, int nfreq, double *weights, double *total, int *nthreads);
+int read_ion_fractions(char *path, double *weights);
+/* collisions.c */
+int evaluate_collision_rates(struct lines *line_ptr, double *temp, int ntemp, double *omega, double *q21, double *q12);
+double q21(struct lines *line_ptr, double t);
+double q12(struct lines *line_ptr, double t);
+/* rates.c */
+int evaluate_ion_rates(double *temp, int ntemp, double *dr, double *rr, double *gs_rr, double *di);
+/* equilibrium.c */
+int ionization_equilibrium(double *temp, int ntemp, double *frac, int *nthreads);
+/* gaunt.c */
+int index_gaunt_segments(void);
+int evaluate_gaunt_ff(double *gsqrd, int n, double *gff);
+double gaunt_ff(double gsqrd);
+int free_free_spectrum(double t_e, double *density, double *freq, int nfreq, double *emissivity, double *opacity, double *ne);
+/* line_stream.c */
+int add_streamed_line_file(char *path);
+void free_streamed_lines(void);
+LinePtr decode_streamed_line(LineIndex_t *entry);
+LinePtr get_line(int n);
+double get_line_freq(int n);
+int get_line_nion(int n);
+/* tokenizer.c */
+double fast_strtod(char *str, char **end);
+char *skip_whitespace(char *c);
+int next_token(char **cursor, char **token);
+int next_int(char **cursor, int width, int *value);
+int next_double(char **cursor, double *value);
+int scan_atomic_record(char *record, char *format, ...);
 /* query.c */
 void clean_up_form(FORM *form, FIELD **fields, int nfields);
 int control_form(FORM *form, int ch, int exit_index);
@@ -72,34 +164,50 @@ int query_user(Window_t w, Query_t *q, int nfields, char *title_message);
 void init_single_question_form(Query_t *q, char *label, char *answer);
 void init_two_question_form(Query_t *q, char *label1, char *label2, char *answer1, char *answer2);
 int query_wavelength_range(double *wmin, double *wmax);
+int query_temperature_range(double *tmin, double *tmax);
+int query_temperature(double *t);
 int query_atomic_number(int *z);
+int query_file_path(char *label, char *message, char *path);
 int query_ion_input(int nion_or_z, int *z, int *istate, int *nion);
 void switch_atomic_data(void);
 int query_atomic_number_by_symbol(int *z);
 /* elements.c */
 void elements_header(void);
 void element_line(struct elements e);
-void single_element_info(struct elements e, int detailed);
+void single_element_info(int nelem, int detailed);
 void all_elements(void);
 void single_element(void);
 /* ions.c */
 void ion_header(void);
+int format_ion_line(int nion, char *row, int size);
 void ion_line(int nion);
 void single_ion_info(int nion, int detailed);
 void all_ions(void);
 void single_ion_atomic_z(void);
 void single_ion_nion(void);
 void ions_for_element(void);
+void ion_rates(void);
+void all_ion_rates(void);
+void ion_rates_export(void);
+void ion_equilibrium(void);
+void ion_equilibrium_export(void);
 /* levels.c */
 void atomic_level_header(void);
+int format_atomic_level_line(int n, char *row, int size);
 void atomic_level_line(int n);
 void all_level_configurations(void);
 /* inner.c */
 void inner_shell_header(void);
+int format_inner_shell_line(int nphot, char *row, int size);
 void inner_shell_line(int nphot);
 void all_inner_shell(void);
 void inner_shell_wavelength_range(void);
+void inner_shell_coverage(void);
 void inner_shell_element(void);
 void inner_shell_ion(void);
+/* free_free.c */
+void free_free_gaunt(void);
+void free_free_emission(void);
+void free_free_emission_export(void);
 /* parse.c */
 int check_command_line(int argc, char **argv);
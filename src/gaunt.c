@@ -0,0 +1,254 @@
+/* ************************************************************************** */
+/**
+ * @file     gaunt.c
+ *
+ * @brief
+ *
+ * Functions for calculating free-free gaunt factors, emissivities and
+ * opacities.
+ *
+ * @details
+ *
+ * The gaunt factors are the frequency averaged gaunt factors of Sutherland
+ * (1998) in gaunt_total, which are a cubic spline in log(g^2), where
+ * g^2 = Z^2 Ry / kT. These are the same as gaunt_ff in Python.
+ *
+ * Rather than searching the spline for each g^2, log(g^2) is split into bins
+ * which are no wider than the narrowest segment of the spline, and the
+ * segment at the start of each bin is looked up when the atomic data is read
+ * in. Each g^2 is then in the segment from the lookup, or the one after it.
+ *
+ * ************************************************************************** */
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "atomix.h"
+
+#define GAUNT_MAX_BINS 4096
+/// The constants for the free-free emissivity and opacity in Python
+#define BREMS_CONSTANT 6.85e-38
+#define KAPPA_FF_CONSTANT 3.692e8
+
+/* ************************************************************************** */
+/**
+ * @brief  Make the segment lookup for the gaunt factors
+ *
+ * @return  0 on success, or ATOMIC_MEMORY_ISSUE_ERROR if the lookup could not
+ *          be allocated
+ *
+ * @details
+ *
+ * This has to be done whenever gaunt_total is read in, i.e. after reading the
+ * atomic data or when it is read from the cache. gaunt_total is in ascending
+ * order of log(g^2), which is checked when it is read in. If the segments are
+ * so narrow that there would be more than GAUNT_MAX_BINS bins, the bins are
+ * wider than some segments and more than one step may be needed to find the
+ * segment.
+ *
+ * ************************************************************************** */
+
+int
+index_gaunt_segments(void)
+{
+  int i, b;
+  double width, start;
+
+  gaunt_lookup.nbins = 0;
+  if(gaunt_n_gsqrd < 2)
+    return 0;
+
+  width = gaunt_total[gaunt_n_gsqrd - 1].log_gsqrd - gaunt_total[0].log_gsqrd;
+  for(i = 1; i < gaunt_n_gsqrd; i++)
+    if(gaunt_total[i].log_gsqrd - gaunt_total[i - 1].log_gsqrd < width)
+      width = gaunt_total[i].log_gsqrd - gaunt_total[i - 1].log_gsqrd;
+
+  gaunt_lookup.log_gsqrd_min = gaunt_total[0].log_gsqrd;
+  gaunt_lookup.nbins = (int) ((gaunt_total[gaunt_n_gsqrd - 1].log_gsqrd - gaunt_lookup.log_gsqrd_min) / width) + 1;
+  if(gaunt_lookup.nbins > GAUNT_MAX_BINS)
+    gaunt_lookup.nbins = GAUNT_MAX_BINS;
+  gaunt_lookup.inv_width = gaunt_lookup.nbins / (gaunt_total[gaunt_n_gsqrd - 1].log_gsqrd - gaunt_lookup.log_gsqrd_min);
+
+  if(reserve_atomic_table(TABLE_GAUNT_SEGMENT, gaunt_lookup.nbins))
+  {
+    gaunt_lookup.nbins = 0;
+    return ATOMIC_MEMORY_ISSUE_ERROR;
+  }
+
+  i = 0;
+  for(b = 0; b < gaunt_lookup.nbins; b++)
+  {
+    start = gaunt_lookup.log_gsqrd_min + b / gaunt_lookup.inv_width;
+    while(i + 1 < gaunt_n_gsqrd && gaunt_total[i + 1].log_gsqrd <= start)
+      i++;
+    gaunt_lookup.segment[b] = i;
+  }
+
+  return 0;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Calculate the free-free gaunt factor for a set of g^2
+ *
+ * @param[in]   gsqrd  The values of g^2 = Z^2 Ry / kT
+ * @param[in]   n      The number of values
+ * @param[out]  gff    The gaunt factor for each value
+ *
+ * @return  0 on success, or -1 if there are no gaunt factors
+ *
+ * @details
+ *
+ * The gaunt factor is the spline of the last point of gaunt_total at or below
+ * log(g^2). Outside of the table, the gaunt factor at the nearest end of the
+ * table is used.
+ *
+ * ************************************************************************** */
+
+int
+evaluate_gaunt_ff(double *gsqrd, int n, double *gff)
+{
+  int i, k, b;
+  double log_g2, delta;
+  double log_min, log_max;
+
+  if(gaunt_n_gsqrd < 1)
+    return -1;
+
+  log_min = gaunt_total[0].log_gsqrd;
+  log_max = gaunt_total[gaunt_n_gsqrd - 1].log_gsqrd;
+
+  for(k = 0; k < n; k++)
+  {
+    log_g2 = log10(gsqrd[k]);
+
+    if(!(log_g2 > log_min) || gaunt_lookup.nbins < 1)
+    {
+      gff[k] = gaunt_total[0].gff;
+      continue;
+    }
+    if(log_g2 >= log_max)
+    {
+      gff[k] = gaunt_total[gaunt_n_gsqrd - 1].gff;
+      continue;
+    }
+
+    b = (int) ((log_g2 - gaunt_lookup.log_gsqrd_min) * gaunt_lookup.inv_width);
+    if(b >= gaunt_lookup.nbins)
+      b = gaunt_lookup.nbins - 1;
+
+    /* The segment from the lookup can only be past the right one due to round off at the start of a bin */
+    i = gaunt_lookup.segment[b];
+    while(i > 0 && gaunt_total[i].log_gsqrd > log_g2)
+      i--;
+    while(i + 1 < gaunt_n_gsqrd && gaunt_total[i + 1].log_gsqrd <= log_g2)
+      i++;
+
+    delta = log_g2 - gaunt_total[i].log_gsqrd;
+    gff[k] = gaunt_total[i].gff + delta * (gaunt_total[i].s1 + delta * (gaunt_total[i].s2 + delta * gaunt_total[i].s3));
+  }
+
+  return 0;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Calculate the free-free gaunt factor
+ *
+ * @param[in]  gsqrd  g^2 = Z^2 Ry / kT
+ *
+ * @return  The gaunt factor, or 1 if there are no gaunt factors
+ *
+ * @details
+ *
+ * See evaluate_gaunt_ff for more than one g^2.
+ *
+ * ************************************************************************** */
+
+double
+gaunt_ff(double gsqrd)
+{
+  double gff;
+
+  if(evaluate_gaunt_ff(&gsqrd, 1, &gff))
+    return 1;
+
+  return gff;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Calculate the free-free emissivity and opacity of a plasma on a grid
+ *         of frequencies
+ *
+ * @param[in]   t_e         The electron temperature
+ * @param[in]   density     The number density of each ion
+ * @param[in]   freq        The frequencies
+ * @param[in]   nfreq       The number of frequencies
+ * @param[out]  emissivity  The emissivity at each frequency, or NULL
+ * @param[out]  opacity     The absorption coefficient at each frequency, or
+ *                          NULL
+ * @param[out]  ne          The electron density, or NULL
+ *
+ * @return  0 on success, -1 if t_e is not positive or there are no gaunt
+ *          factors, or ATOMIC_MEMORY_ISSUE_ERROR if there was not enough memory
+ *
+ * @details
+ *
+ * The electron density is worked out from the ion densities, and each ion
+ * with a charge Z contributes n_ion Z^2 gff(Z^2 Ry / kT). The gaunt factors of
+ * every ion are calculated together. The emissivity is in ergs s^-1 cm^-3
+ * Hz^-1 over all solid angles and the opacity, which includes stimulated
+ * emission, is in cm^-1, as in ff and kappa_ff in Python.
+ *
+ * ************************************************************************** */
+
+int
+free_free_spectrum(double t_e, double *density, double *freq, int nfreq, double *emissivity, double *opacity,
+                   double *ne)
+{
+  int k, n, z;
+  double *gsqrd, *gff;
+  double sum, electrons, factor, boltz;
+
+  if(!(t_e > 0) || gaunt_n_gsqrd < 1)
+    return -1;
+
+  if((gsqrd = malloc(2 * (nions > 0 ? nions : 1) * sizeof(*gsqrd))) == NULL)
+    return ATOMIC_MEMORY_ISSUE_ERROR;
+  gff = gsqrd + (nions > 0 ? nions : 1);
+
+  for(n = 0; n < nions; n++)
+  {
+    z = ions[n].istate - 1;
+    gsqrd[n] = z > 0 ? z * z * RYD2ERGS / (BOLTZMANN * t_e) : 1;
+  }
+  evaluate_gaunt_ff(gsqrd, nions, gff);
+
+  sum = electrons = 0;
+  for(n = 0; n < nions; n++)
+  {
+    z = ions[n].istate - 1;
+    if(z < 1)
+      continue;
+    sum += density[n] * z * z * gff[n];
+    electrons += density[n] * z;
+  }
+
+  free(gsqrd);
+
+  if(ne)
+    *ne = electrons;
+
+  factor = electrons * sum / sqrt(t_e);
+  for(k = 0; k < nfreq; k++)
+  {
+    boltz = exp(-H_OVER_K * freq[k] / t_e);
+    if(emissivity)
+      emissivity[k] = BREMS_CONSTANT * factor * boltz;
+    if(opacity)
+      opacity[k] = KAPPA_FF_CONSTANT * factor / (freq[k] * freq[k] * freq[k]) * (1 - boltz);
+  }
+
+  return 0;
+}
@@ -11,6 +11,7 @@
  * ************************************************************************** */
 
 #include <stdbool.h>
+#include <stdlib.h>
 
 #include "atomix.h"
 
@@ -39,21 +40,37 @@ inner_shell_header(void)
  * @details
  *
  * The function inner_shell_header will create an appropriate header for these
- * lines.
+ * lines. This is also the formatter for the rows of the views which list
+ * edges.
  *
  * ************************************************************************** */
 
-void
-inner_shell_line(int nphot)
+int
+format_inner_shell_line(int nphot, char *row, int size)
 {
   double wavelength;
   char element[LINELEN];
 
   get_element_name(inner_cross_ptr[nphot]->z, element);
   wavelength = C_SI / inner_cross_ptr[nphot]->freq[0] / ANGSTROM / 1e-2;
-  display_add(" %-12.2f %-12s %-12i %-12i %-12i %-12i %-12i", wavelength, element, inner_cross_ptr[nphot]->z,
-              inner_cross_ptr[nphot]->istate, inner_cross_ptr[nphot]->n, inner_cross_ptr[nphot]->l,
-              ions[inner_cross_ptr[nphot]->nion].phot_info);
+  return snprintf(row, size, " %-12.2f %-12s %-12i %-12i %-12i %-12i %-12i", wavelength, element,
+                  inner_cross_ptr[nphot]->z, inner_cross_ptr[nphot]->istate, inner_cross_ptr[nphot]->n,
+                  inner_cross_ptr[nphot]->l, ions[inner_cross_ptr[nphot]->nion].phot_info);
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Add an inner shell line to the display buffer.
+ *
+ * ************************************************************************** */
+
+void
+inner_shell_line(int nphot)
+{
+  char row[DISPLAY_ROW_LEN];
+
+  format_inner_shell_line(nphot, row, sizeof(row));
+  display_add("%s", row);
 }
 
 /* ************************************************************************** */
@@ -67,7 +84,6 @@ inner_shell_line(int nphot)
 void
 all_inner_shell(void)
 {
-  int n, nphot;
   double wmin, wmax;
 
   wmin = C_SI / inner_cross_ptr[0]->freq[0] / ANGSTROM / 1e-2;
@@ -78,15 +94,9 @@ all_inner_shell(void)
 
   inner_shell_header();
 
-  n = 0;
+  display_add_rows(NULL, 0, n_inner_tot, format_inner_shell_line);
 
-  for(nphot = 0; nphot < n_inner_tot; ++nphot)
-  {
-    n++;
-    inner_shell_line(nphot);
-  }
-
-  count(ndash, n);
+  count(ndash, n_inner_tot);
 
   display_show(SCROLL_ENABLE, true, 4);
 }
@@ -98,9 +108,9 @@ all_inner_shell(void)
  *
  * @details
  *
- * This function simply loops over the phot_top_prt (Topbase) and writes
- * to the screen whenever a threshold frequency for an edge falls
- * within the provided wavelength range.
+ * The edges with a threshold frequency in the provided wavelength range are
+ * found in inner_cross_threshold by limit_edges, and written to the screen in
+ * frequency order.
  *
  * The wavelength range is queried within the function.
  *
@@ -109,8 +119,8 @@ all_inner_shell(void)
 void
 inner_shell_wavelength_range(void)
 {
-  int n, nphot;
-  double fmin, fmax, fthreshold;
+  int n, nfirst;
+  double fmin, fmax;
   double wmin, wmax;
 
   if(query_wavelength_range(&wmin, &wmax) == FORM_QUIT)
@@ -123,21 +133,64 @@ inner_shell_wavelength_range(void)
   add_sep_display(ndash);
   inner_shell_header();
 
-  n = 0;
+  n = limit_edges(inner_cross_threshold, n_inner_tot, fmin, fmax, &nfirst);
+
+  display_add_rows(NULL, nfirst, n, format_inner_shell_line);
+
+  count(ndash, n);
+
+  display_show(SCROLL_ENABLE, true, 4);
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Retrieve all of the inner shell edges which absorb over a given
+ *         wavelength range.
+ *
+ * @details
+ *
+ * Unlike inner_shell_wavelength_range, this finds every edge with a cross section
+ * which overlaps the wavelength range, i.e. all of the edges which contribute
+ * to the continuum opacity over the range. The edges are found using the
+ * coverage tree inner_cross_coverage and written to the screen in frequency order.
+ *
+ * The wavelength range is queried within the function.
+ *
+ * ************************************************************************** */
+
+void
+inner_shell_coverage(void)
+{
+  int n;
+  int *edges;
+  double fmin, fmax;
+  double wmin, wmax;
 
-  for(nphot = 0; nphot < n_inner_tot; ++nphot)
+  if(query_wavelength_range(&wmin, &wmax) == FORM_QUIT)
+    return;
+
+  if((edges = malloc((n_inner_tot + 1) * sizeof(*edges))) == NULL)
   {
-    fthreshold = inner_cross_ptr[nphot]->freq[0];
-    if(fthreshold > fmin && fthreshold < fmax)
-    {
-      inner_shell_line(nphot);
-      n++;
-    }
+    error_atomix("Unable to allocate memory for the inner shell edges");
+    return;
   }
 
+  fmax = C / (wmin * ANGSTROM);
+  fmin = C / (wmax * ANGSTROM);
+
+  display_add(" Edges absorbing over wavelength range: %.2f - %.2f Angstroms", wmin, wmax);
+  add_sep_display(ndash);
+  inner_shell_header();
+
+  n = find_covering_edges(inner_cross_threshold, inner_cross_coverage, n_inner_tot, fmin, fmax, edges);
+
+  display_add_rows(edges, 0, n, format_inner_shell_line);
+
   count(ndash, n);
 
   display_show(SCROLL_ENABLE, true, 4);
+
+  free(edges);
 }
 
 /* ************************************************************************** */
@@ -152,13 +205,14 @@ void
 inner_shell_element(void)
 {
   int n, z;
-  int nphot;
+  int nelem;
+  int *entries;
   char element[LINELEN];
 
   if(query_atomic_number(&z) == FORM_QUIT)
     return;
 
-  if(find_element(z) == ELEMENT_NO_FOUND)
+  if((nelem = find_element(z)) == ELEMENT_NO_FOUND)
     return;
 
   get_element_name(z, element);
@@ -166,15 +220,8 @@ inner_shell_element(void)
   add_sep_display(ndash);
   inner_shell_header();
 
-  n = 0;
-  for(nphot = 0; nphot < n_inner_tot; ++nphot)
-  {
-    if(inner_cross_ptr[nphot]->z == z)
-    {
-      inner_shell_line(nphot);
-      n++;
-    }
-  }
+  entries = get_element_postings(nelem, POSTING_INNER_CROSS, &n);
+  display_add_rows(entries, 0, n, format_inner_shell_line);
 
   count(ndash, n);
 
@@ -193,7 +240,8 @@ void
 inner_shell_ion(void)
 {
   int z, istate;
-  int n, nion, nphot;
+  int n, nion;
+  int *entries;
   char element[LINELEN];
 
   if(query_ion_input(TRUE, NULL, NULL, &nion) == FORM_QUIT)
@@ -216,15 +264,8 @@ inner_shell_ion(void)
   add_sep_display(ndash);
   inner_shell_header();
 
-  n = 0;
-  for(nphot = 0; nphot < n_inner_tot; ++nphot)
-  {
-    if(inner_cross_ptr[nphot]->z == z && inner_cross_ptr[nphot]->istate == istate)
-    {
-      inner_shell_line(nphot);
-      n++;
-    }
-  }
+  entries = get_ion_postings(nion, POSTING_INNER_CROSS, &n);
+  display_add_rows(entries, 0, n, format_inner_shell_line);
 
   count(ndash, n);
 
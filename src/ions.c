@@ -11,6 +11,10 @@
  * ************************************************************************** */
 
 #include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #include "atomix.h"
 
@@ -18,6 +22,13 @@ static const int ndash = 45;
 
 static const int ndash_line = 83;
 
+static const int ndash_rates = 70;
+
+#define RATES_VIEW_NTEMPS 11
+#define RATES_EXPORT_NTEMPS 51
+#define EQUILIBRIUM_VIEW_NTEMPS 41
+#define EQUILIBRIUM_EXPORT_NTEMPS 201
+
 /* ************************************************************************** */
 /**
  * @brief
@@ -44,19 +55,35 @@ ion_header(void)
  *
  * @details
  *
- * Prints an element to screen using a standardised output.
+ * Prints an element to screen using a standardised output. This is also the
+ * formatter for the rows of the list of all the ions.
  *
  * ************************************************************************** */
 
-void
-ion_line(int nion)
+int
+format_ion_line(int nion, char *row, int size)
 {
   char element[LINELEN];
   struct ions ion = ions[nion];
 
   get_element_name(ion.z, element);
-  display_add(" %-12i %-12s %-12i %-12i %-12i %-12.2e", nion, element, ion.z, ion.istate, ion.phot_info,
-              ion.ip / EV2ERGS);
+  return snprintf(row, size, " %-12i %-12s %-12i %-12i %-12i %-12.2e", nion, element, ion.z, ion.istate,
+                  ion.phot_info, ion.ip / EV2ERGS);
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Add an ion to the display buffer.
+ *
+ * ************************************************************************** */
+
+void
+ion_line(int nion)
+{
+  char row[DISPLAY_ROW_LEN];
+
+  format_ion_line(nion, row, sizeof(row));
+  display_add("%s", row);
 }
 
 /* ************************************************************************** */
@@ -78,8 +105,11 @@ void
 single_ion_info(int nion, int detailed)
 {
   int i, n;
+  int *entries;
   double wavelength;
   char element[LINELEN];
+  LinePtr l;
+  TopPhotPtr x;
   struct ions ion;
 
   ion = ions[nion];
@@ -102,16 +132,13 @@ single_ion_info(int nion, int detailed)
   add_sep_display(ndash);
   display_add(" %-12s %-12s %-12s", "Wavelength", "levu", "levl");
 
-  n = 0;
+  entries = get_ion_postings(nion, POSTING_LINES, &n);
 
-  for(i = 0; i < nlines; ++i)
+  for(i = 0; i < n; ++i)
   {
-    if(lin_ptr[i]->z == ion.z && lin_ptr[i]->istate == ion.istate)
-    {
-      n++;
-      wavelength = C_SI / lin_ptr[i]->freq / ANGSTROM / 1e-2;
-      display_add(" %-12.2f %-12i %-12i", wavelength, lin_ptr[i]->levu, lin_ptr[i]->levl);
-    }
+    l = get_line(entries[i]);
+    wavelength = C_SI / l->freq / ANGSTROM / 1e-2;
+    display_add(" %-12.2f %-12i %-12i", wavelength, l->levu, l->levl);
   }
 
   add_sep_display(ndash);
@@ -122,16 +149,13 @@ single_ion_info(int nion, int detailed)
   add_sep_display(ndash);
   display_add(" %-12s %-12s %-12s", "Wavelength", "n", "l");
 
-  n = 0;
+  entries = get_ion_postings(nion, POSTING_PHOT_TOP, &n);
 
-  for(i = 0; i < nphot_total; ++i)
+  for(i = 0; i < n; ++i)
   {
-    if(phot_top_ptr[i]->z == ion.z && phot_top_ptr[i]->istate == ion.istate)
-    {
-      n++;
-      wavelength = C_SI / phot_top_ptr[i]->freq[0] / ANGSTROM / 1e-2;
-      display_add(" %-12.2f %-12i %-12i", wavelength, phot_top_ptr[i]->n, phot_top_ptr[i]->l);
-    }
+    x = phot_top_ptr[entries[i]];
+    wavelength = C_SI / x->freq[0] / ANGSTROM / 1e-2;
+    display_add(" %-12.2f %-12i %-12i", wavelength, x->n, x->l);
   }
 
   add_sep_display(ndash);
@@ -143,17 +167,13 @@ single_ion_info(int nion, int detailed)
   add_sep_display(ndash);
   display_add(" %-12s %-12s %-12s %-12s", "Ionisation", "Wavelength", "n", "l");
 
-  n = 0;
+  entries = get_ion_postings(nion, POSTING_INNER_CROSS, &n);
 
-  for(i = 0; i < n_inner_tot; ++i)
+  for(i = 0; i < n; ++i)
   {
-    if(inner_cross_ptr[i]->z == ion.z && inner_cross_ptr[i]->istate == ion.istate)
-    {
-      n++;
-      wavelength = C_SI / inner_cross_ptr[i]->freq[0] / ANGSTROM / 1e-2;
-      display_add(" %-12i %-12.2f %-12i %-12i", inner_cross_ptr[i]->istate, wavelength, inner_cross_ptr[i]->n,
-                  inner_cross_ptr[i]->l);
-    }
+    x = inner_cross_ptr[entries[i]];
+    wavelength = C_SI / x->freq[0] / ANGSTROM / 1e-2;
+    display_add(" %-12i %-12.2f %-12i %-12i", x->istate, wavelength, x->n, x->l);
   }
 
   add_sep_display(ndash);
@@ -173,11 +193,8 @@ single_ion_info(int nion, int detailed)
 void
 all_ions(void)
 {
-  int nion;
-
   ion_header();
-  for(nion = 0; nion < nions; ++nion)
-    ion_line(nion);
+  display_add_rows(NULL, 0, nions, format_ion_line);
 
   count(ndash_line, nions);
   display_show(SCROLL_ENABLE, true, 3);
@@ -288,3 +305,457 @@ ions_for_element(void)
   count(ndash_line, ele[n].nions);
   display_show(SCROLL_ENABLE, true, 4);
 }
+
+/* ************************************************************************** */
+/**
+ * @brief  Get a description of the recombination and ionization rate data of
+ *         an ion.
+ *
+ * @param[in]   nion  The ion number
+ * @param[out]  desc  The description
+ *
+ * ************************************************************************** */
+
+static void
+ion_rates_source(int nion, char *desc)
+{
+  char *dr = "none", *rr = "none", *gs_rr = "none", *di = "none";
+  struct ions ion = ions[nion];
+
+  if(ion.drflag && ion.nxdrecomb >= 0 && ion.nxdrecomb < ndrecomb)
+    dr = drecomb[ion.nxdrecomb].type == DRTYPE_BADNELL ? "Badnell" : "Shull";
+  if(ion.total_rrflag && ion.nxtotalrr >= 0 && ion.nxtotalrr < n_total_rr)
+    rr = total_rr[ion.nxtotalrr].type == RRTYPE_BADNELL ? "Badnell" : "Shull";
+  if(ion.bad_gs_rr_t_flag && ion.bad_gs_rr_r_flag)
+    gs_rr = "Badnell";
+  if(ion.dere_di_flag)
+    di = "Dere";
+
+  sprintf(desc, "DR: %s, RR: %s, GS RR: %s, DI: %s", dr, rr, gs_rr, di);
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Print the recombination and ionization rates of an ion from
+ *         already calculated rates.
+ *
+ * @param[in]  nion   The ion number
+ * @param[in]  temp   The temperatures
+ * @param[in]  ntemp  The number of temperatures
+ * @param[in]  dr     The dielectronic recombination rates of every ion
+ * @param[in]  rr     The total radiative recombination rates of every ion
+ * @param[in]  gs_rr  The ground state radiative recombination rates of every ion
+ * @param[in]  di     The direct ionization rates of every ion
+ *
+ * ************************************************************************** */
+
+static void
+ion_rates_block(int nion, double *temp, int ntemp, double *dr, double *rr, double *gs_rr, double *di)
+{
+  int k, i;
+  char element[LINELEN];
+  char desc[LINELEN];
+
+  get_element_name(ions[nion].z, element);
+  ion_rates_source(nion, desc);
+
+  display_add(" Ion %i: %s %i", nion, element, ions[nion].istate);
+  display_add(" %s", desc);
+  display_add(" %-12s %-12s %-12s %-12s %-12s", "Temperature", "DR", "Total RR", "GS RR", "DI");
+  for(k = 0; k < ntemp; ++k)
+  {
+    i = nion * ntemp + k;
+    display_add(" %-12.4e %-12.4e %-12.4e %-12.4e %-12.4e", temp[k], dr[i], rr[i], gs_rr[i], di[i]);
+  }
+  add_sep_display(ndash_rates);
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Calculate the recombination and ionization rates of every ion over
+ *         a temperature range.
+ *
+ * @param[in]   ntemp  The number of temperatures
+ * @param[in]   tmin   The minimum temperature
+ * @param[in]   tmax   The maximum temperature
+ * @param[out]  temp   The temperatures
+ * @param[out]  rates  The dielectronic recombination, total radiative
+ *                     recombination, ground state radiative recombination and
+ *                     direct ionization rates, one after the other
+ *
+ * @return  0 on success, or non-zero if the rates could not be calculated, in
+ *          which case an error has been shown
+ *
+ * @details
+ *
+ * rates is allocated and must be freed.
+ *
+ * ************************************************************************** */
+
+static int
+calculate_ion_rates(int ntemp, double tmin, double tmax, double *temp, double **rates)
+{
+  int status;
+  long nrates = (long) nions * ntemp;
+
+  if((*rates = malloc(4 * nrates * sizeof(**rates))) == NULL)
+  {
+    error_atomix("Unable to allocate memory for the rates");
+    return ATOMIC_MEMORY_ISSUE_ERROR;
+  }
+
+  temperature_grid(temp, ntemp, tmin, tmax);
+
+  if((status = evaluate_ion_rates(temp, ntemp, *rates, *rates + nrates, *rates + 2 * nrates, *rates + 3 * nrates)))
+  {
+    error_atomix("Unable to calculate the rates for %.2e - %.2e K", tmin, tmax);
+    free(*rates);
+    *rates = NULL;
+  }
+
+  return status;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Print the recombination and ionization rates of an ion over a
+ *         temperature range.
+ *
+ * @details
+ *
+ * The rates are the dielectronic recombination, total and ground state
+ * radiative recombination and Dere direct ionization rate coefficients. The
+ * ion and the temperature range are queried within the function.
+ *
+ * ************************************************************************** */
+
+void
+ion_rates(void)
+{
+  int nion;
+  long nrates;
+  double tmin, tmax;
+  double temp[RATES_VIEW_NTEMPS];
+  double *rates;
+
+  if(query_ion_input(true, NULL, NULL, &nion) == FORM_QUIT)
+    return;
+
+  if(nion < 0)
+    nion *= -1;
+
+  if(nion > nions - 1)
+  {
+    error_atomix("Invalid ion index choice %i when there are only %i ion indices", nion, nions);
+    return;
+  }
+
+  if(query_temperature_range(&tmin, &tmax) == FORM_QUIT)
+    return;
+
+  if(calculate_ion_rates(RATES_VIEW_NTEMPS, tmin, tmax, temp, &rates))
+    return;
+
+  nrates = (long) nions * RATES_VIEW_NTEMPS;
+  display_add(" Recombination and ionization rates: %.2e - %.2e K", tmin, tmax);
+  add_sep_display(ndash_rates);
+  ion_rates_block(nion, temp, RATES_VIEW_NTEMPS, rates, rates + nrates, rates + 2 * nrates, rates + 3 * nrates);
+  free(rates);
+
+  display_show(SCROLL_ENABLE, false, 0);
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Print the recombination and ionization rates of every ion over a
+ *         temperature range.
+ *
+ * @details
+ *
+ * Ions without any rate data are skipped. The temperature range is queried
+ * within the function.
+ *
+ * ************************************************************************** */
+
+void
+all_ion_rates(void)
+{
+  int nion, nshown;
+  long nrates;
+  double tmin, tmax;
+  double temp[RATES_VIEW_NTEMPS];
+  double *rates;
+  struct ions ion;
+
+  if(query_temperature_range(&tmin, &tmax) == FORM_QUIT)
+    return;
+
+  if(calculate_ion_rates(RATES_VIEW_NTEMPS, tmin, tmax, temp, &rates))
+    return;
+
+  nrates = (long) nions * RATES_VIEW_NTEMPS;
+  display_add(" Recombination and ionization rates: %.2e - %.2e K", tmin, tmax);
+  add_sep_display(ndash_rates);
+
+  nshown = 0;
+  for(nion = 0; nion < nions; ++nion)
+  {
+    ion = ions[nion];
+    if(!ion.drflag && !ion.total_rrflag && !(ion.bad_gs_rr_t_flag && ion.bad_gs_rr_r_flag) && !ion.dere_di_flag)
+      continue;
+    ion_rates_block(nion, temp, RATES_VIEW_NTEMPS, rates, rates + nrates, rates + 2 * nrates, rates + 3 * nrates);
+    nshown++;
+  }
+  free(rates);
+
+  display_add(" %i ions have rate data", nshown);
+
+  display_show(SCROLL_ENABLE, false, 0);
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Write the recombination and ionization rates of every ion over a
+ *         temperature range to a file.
+ *
+ * @details
+ *
+ * Each line of the file is an ion and a temperature, which makes it simple to
+ * compare the rates from different atomic data sets. Ions without data for a
+ * rate have a rate of zero. The temperature range and the file are queried
+ * within the function.
+ *
+ * ************************************************************************** */
+
+void
+ion_rates_export(void)
+{
+  int nion, k;
+  long i, nrates;
+  double tmin, tmax, time_ms;
+  double temp[RATES_EXPORT_NTEMPS];
+  double *rates;
+  struct timespec start, end;
+  FILE *fptr;
+
+  static char output[FIELD_INPUT_LEN] = "rates.txt";
+
+  if(query_temperature_range(&tmin, &tmax) == FORM_QUIT)
+    return;
+  if(query_file_path("Output file : ", "Input the file to write the rates to", output) == FORM_QUIT)
+    return;
+
+  if(strlen(output) == 0 || (fptr = fopen(output, "w")) == NULL)
+  {
+    error_atomix("Unable to open output file %s", output);
+    return;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  if(calculate_ion_rates(RATES_EXPORT_NTEMPS, tmin, tmax, temp, &rates))
+  {
+    fclose(fptr);
+    return;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  time_ms = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+
+  nrates = (long) nions * RATES_EXPORT_NTEMPS;
+
+  fprintf(fptr, "# Recombination and ionization rates: %.2e - %.2e K\n", tmin, tmax);
+  fprintf(fptr, "# %-4s %-6s %-6s %-12s %-12s %-12s %-12s %-12s\n", "z", "istate", "nion", "Temperature", "DR",
+          "Total_RR", "GS_RR", "DI");
+
+  for(nion = 0; nion < nions; ++nion)
+  {
+    for(k = 0; k < RATES_EXPORT_NTEMPS; ++k)
+    {
+      i = (long) nion * RATES_EXPORT_NTEMPS + k;
+      fprintf(fptr, "%-6i %-6i %-6i %-12.4e %-12.4e %-12.4e %-12.4e %-12.4e\n", ions[nion].z, ions[nion].istate, nion,
+              temp[k], rates[i], rates[nrates + i], rates[2 * nrates + i], rates[3 * nrates + i]);
+    }
+  }
+
+  fclose(fptr);
+  free(rates);
+
+  display_add(" Recombination and ionization rates: %.2e - %.2e K", tmin, tmax);
+  display_add(" Calculated %i ions at %i temperatures in %.2f ms", nions, RATES_EXPORT_NTEMPS, time_ms);
+  display_add(" %i DR, %i total RR, %i GS RR and %i DI rate sets", ndrecomb, n_total_rr, n_bad_gs_rr, n_dere_di_rate);
+  display_add(" Wrote to %s", output);
+
+  display_show(SCROLL_ENABLE, false, 0);
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Calculate the collisional ionization equilibrium of every element
+ *         over a temperature range.
+ *
+ * @param[in]   ntemp     The number of temperatures
+ * @param[in]   tmin      The minimum temperature
+ * @param[in]   tmax      The maximum temperature
+ * @param[out]  temp      The temperatures
+ * @param[out]  frac      The fraction of every ion at each temperature
+ * @param[out]  time_ms   The time taken in ms
+ * @param[out]  nthreads  The number of threads used
+ *
+ * @return  0 on success, or non-zero if the fractions could not be
+ *          calculated, in which case an error has been shown
+ *
+ * @details
+ *
+ * frac is allocated and must be freed.
+ *
+ * ************************************************************************** */
+
+static int
+calculate_ion_equilibrium(int ntemp, double tmin, double tmax, double *temp, double **frac, double *time_ms,
+                          int *nthreads)
+{
+  int status;
+  struct timespec start, end;
+
+  if((*frac = malloc((long) nions * ntemp * sizeof(**frac))) == NULL)
+  {
+    error_atomix("Unable to allocate memory for the ion fractions");
+    return ATOMIC_MEMORY_ISSUE_ERROR;
+  }
+
+  temperature_grid(temp, ntemp, tmin, tmax);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  status = ionization_equilibrium(temp, ntemp, *frac, nthreads);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  *time_ms = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+
+  if(status)
+  {
+    error_atomix("Unable to calculate the ionization equilibrium for %.2e - %.2e K", tmin, tmax);
+    free(*frac);
+    *frac = NULL;
+  }
+
+  return status;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Print the collisional ionization equilibrium of an element over a
+ *         temperature range.
+ *
+ * @details
+ *
+ * Each row of the table is a temperature and each column is the fraction of
+ * an ion of the element. The element and the temperature range are queried
+ * within the function.
+ *
+ * ************************************************************************** */
+
+void
+ion_equilibrium(void)
+{
+  int i, k, n, z;
+  int first, nthreads, len;
+  double tmin, tmax, time_ms;
+  double temp[EQUILIBRIUM_VIEW_NTEMPS];
+  double *frac;
+  char element[LINELEN];
+  char row[LINELEN * 4];
+
+  if(query_atomic_number(&z) == FORM_QUIT)
+    return;
+
+  if((n = find_element(z)) == ELEMENT_NO_FOUND)
+    return;
+
+  if(query_temperature_range(&tmin, &tmax) == FORM_QUIT)
+    return;
+
+  if(calculate_ion_equilibrium(EQUILIBRIUM_VIEW_NTEMPS, tmin, tmax, temp, &frac, &time_ms, &nthreads))
+    return;
+
+  first = ele[n].firstion;
+  get_element_name(z, element);
+
+  display_add(" Collisional ionization equilibrium for %s: %.2e - %.2e K", element, tmin, tmax);
+  display_add(" Calculated every element at %i temperatures in %.2f ms using %i threads", EQUILIBRIUM_VIEW_NTEMPS,
+              time_ms, nthreads);
+  add_sep_display(ndash_rates);
+
+  len = sprintf(row, " %-12s", "Temperature");
+  for(i = 0; i < ele[n].nions && len < (int) sizeof(row) - 16; ++i)
+    len += sprintf(row + len, " %-3s %-6i", element, ions[first + i].istate);
+  display_add("%s", row);
+
+  for(k = 0; k < EQUILIBRIUM_VIEW_NTEMPS; ++k)
+  {
+    len = sprintf(row, " %-12.4e", temp[k]);
+    for(i = 0; i < ele[n].nions && len < (int) sizeof(row) - 16; ++i)
+      len += sprintf(row + len, " %-10.3e", frac[(first + i) * EQUILIBRIUM_VIEW_NTEMPS + k]);
+    display_add("%s", row);
+  }
+
+  free(frac);
+
+  display_show(SCROLL_ENABLE, true, 4);
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Write the collisional ionization equilibrium of every element over a
+ *         temperature range to a file.
+ *
+ * @details
+ *
+ * Each line of the file is an ion and a temperature. The temperature range
+ * and the file are queried within the function.
+ *
+ * ************************************************************************** */
+
+void
+ion_equilibrium_export(void)
+{
+  int nion, k, nthreads;
+  double tmin, tmax, time_ms;
+  double temp[EQUILIBRIUM_EXPORT_NTEMPS];
+  double *frac;
+  FILE *fptr;
+
+  static char output[FIELD_INPUT_LEN] = "equilibrium.txt";
+
+  if(query_temperature_range(&tmin, &tmax) == FORM_QUIT)
+    return;
+  if(query_file_path("Output file : ", "Input the file to write the ion fractions to", output) == FORM_QUIT)
+    return;
+
+  if(strlen(output) == 0 || (fptr = fopen(output, "w")) == NULL)
+  {
+    error_atomix("Unable to open output file %s", output);
+    return;
+  }
+
+  if(calculate_ion_equilibrium(EQUILIBRIUM_EXPORT_NTEMPS, tmin, tmax, temp, &frac, &time_ms, &nthreads))
+  {
+    fclose(fptr);
+    return;
+  }
+
+  fprintf(fptr, "# Collisional ionization equilibrium: %.2e - %.2e K\n", tmin, tmax);
+  fprintf(fptr, "# %-4s %-6s %-6s %-12s %-12s\n", "z", "istate", "nion", "Temperature", "Fraction");
+
+  for(nion = 0; nion < nions; ++nion)
+    for(k = 0; k < EQUILIBRIUM_EXPORT_NTEMPS; ++k)
+      fprintf(fptr, "%-6i %-6i %-6i %-12.4e %-12.4e\n", ions[nion].z, ions[nion].istate, nion, temp[k],
+              frac[nion * EQUILIBRIUM_EXPORT_NTEMPS + k]);
+
+  fclose(fptr);
+  free(frac);
+
+  display_add(" Collisional ionization equilibrium: %.2e - %.2e K", tmin, tmax);
+  display_add(" Calculated %i elements at %i temperatures in %.2f ms using %i threads", nelements,
+              EQUILIBRIUM_EXPORT_NTEMPS, time_ms, nthreads);
+  display_add(" Wrote to %s", output);
+
+  display_show(SCROLL_ENABLE, false, 0);
+}
@@ -38,12 +38,12 @@ atomic_level_header(void)
  * 
  * ************************************************************************** */
 
-void
-atomic_level_line(int n)
+int
+format_atomic_level_line(int n, char *row, int size)
 {
   ConfigPtr c;
   c = &config[n];
-  display_add(" %-12i %-12i %-12i %-12i %-12i", c->z, c->istate, c->nion, c->nden, c->ilv);
+  return snprintf(row, size, " %-12i %-12i %-12i %-12i %-12i", c->z, c->istate, c->nion, c->nden, c->ilv);
 }
 
 /* ************************************************************************** */
@@ -55,14 +55,28 @@ atomic_level_line(int n)
  * ************************************************************************** */
 
 void
-all_level_configurations(void)
+atomic_level_line(int n)
 {
-  int i;
+  char row[DISPLAY_ROW_LEN];
 
+  format_atomic_level_line(n, row, sizeof(row));
+  display_add("%s", row);
+}
+
+/* ************************************************************************** */
+/**
+ * @brief
+ * 
+ * @details
+ * 
+ * ************************************************************************** */
+
+void
+all_level_configurations(void)
+{
   atomic_level_header();
 
-  for(i = 0; i < nlevels; ++i)
-    atomic_level_line(i);
+  display_add_rows(NULL, 0, nlevels, format_atomic_level_line);
 
   count(ndash, nlevels);
   display_show(SCROLL_ENABLE, true, 3);
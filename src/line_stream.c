@@ -0,0 +1,309 @@
+/* ************************************************************************** */
+/**
+ * @file     line_stream.c
+ *
+ * @brief
+ *
+ * Functions for using a line list which is streamed from the data files.
+ *
+ * @details
+ *
+ * When $ATOMIX_STREAM_LINES is set, get_atomic_data does not keep a struct
+ * lines for each line read in. Instead it keeps a small LineIndex_t, which has
+ * the frequency and ion of the line and where the record for the line is in
+ * the data files. The rest of the line is decoded from its record again when
+ * it is needed, e.g. when it is displayed, so the memory used for the line
+ * list is limited by the size of the index.
+ *
+ * The lines should be accessed with get_line, get_line_freq and get_line_nion,
+ * or searched using line_columns, which work whether or not the line list is
+ * streamed.
+ *
+ * ************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "atomix.h"
+
+#define LINELENGTH 400
+#define LINE_WINDOW_SIZE 65536
+
+typedef struct LineFile_t
+{
+  char path[LOADER_PATH_LEN];
+  int fd;                       /* The file descriptor, or -1 if the file has not been opened */
+} LineFile_t;
+
+static LineFile_t *LINE_FILES = NULL;
+static int NLINE_FILES = 0;
+
+/*
+ * The part of a file which was last read. Lines are often decoded in the
+ * order they are in the file, so most records are already in the window
+ */
+
+static char LINE_WINDOW[LINE_WINDOW_SIZE];
+static int LINE_WINDOW_FILE = -1;
+static long LINE_WINDOW_START = 0;
+static long LINE_WINDOW_LEN = 0;
+
+/* ************************************************************************** */
+/**
+ * @brief  Add a file which lines are streamed from
+ *
+ * @param[in]  path  The path of the file
+ *
+ * @return  The index of the file, or -1 if there was not enough memory
+ *
+ * ************************************************************************** */
+
+int
+add_streamed_line_file(char *path)
+{
+  LineFile_t *new_files;
+
+  if((new_files = realloc(LINE_FILES, (NLINE_FILES + 1) * sizeof(*new_files))) == NULL)
+    return -1;
+
+  LINE_FILES = new_files;
+  snprintf(LINE_FILES[NLINE_FILES].path, LOADER_PATH_LEN, "%s", path);
+  LINE_FILES[NLINE_FILES].fd = -1;
+
+  return NLINE_FILES++;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Close the files which lines are streamed from
+ *
+ * @details
+ *
+ * This is called when new atomic data is read in. The line index itself is
+ * one of the atomic data tables, so is freed with the rest of them.
+ *
+ * ************************************************************************** */
+
+void
+free_streamed_lines(void)
+{
+  int i;
+
+  for(i = 0; i < NLINE_FILES; i++)
+    if(LINE_FILES[i].fd >= 0)
+      close(LINE_FILES[i].fd);
+
+  free(LINE_FILES);
+  LINE_FILES = NULL;
+  NLINE_FILES = 0;
+  LINE_WINDOW_FILE = -1;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Read the record for a line from its file
+ *
+ * @param[in]   entry  The line
+ * @param[out]  aline  The record, LINELENGTH characters long
+ *
+ * @return  0 on success, or -1 if the record could not be read
+ *
+ * @details
+ *
+ * The record is the same as the record which was read by get_atomic_data,
+ * i.e. a line of the file which is cut short if it is longer than LINELENGTH.
+ *
+ * ************************************************************************** */
+
+static int
+read_line_record(LineIndex_t *entry, char *aline)
+{
+  long len;
+  ssize_t nread;
+  char *start, *end;
+  LineFile_t *lfile;
+
+  if(entry->file < 0 || entry->file >= NLINE_FILES)
+    return -1;
+
+  lfile = &LINE_FILES[entry->file];
+  if(lfile->fd < 0 && (lfile->fd = open(lfile->path, O_RDONLY)) < 0)
+    return -1;
+
+  /* Read a new window if the record is not entirely in the current one, unless the current one
+     ends at the end of the file */
+
+  if(LINE_WINDOW_FILE != entry->file || entry->offset < LINE_WINDOW_START
+     || entry->offset >= LINE_WINDOW_START + LINE_WINDOW_LEN
+     || (entry->offset + LINELENGTH - 1 > LINE_WINDOW_START + LINE_WINDOW_LEN && LINE_WINDOW_LEN == LINE_WINDOW_SIZE))
+  {
+    if((nread = pread(lfile->fd, LINE_WINDOW, LINE_WINDOW_SIZE, entry->offset)) <= 0)
+    {
+      LINE_WINDOW_FILE = -1;
+      return -1;
+    }
+    LINE_WINDOW_FILE = entry->file;
+    LINE_WINDOW_START = entry->offset;
+    LINE_WINDOW_LEN = nread;
+  }
+
+  start = LINE_WINDOW + (entry->offset - LINE_WINDOW_START);
+  len = LINE_WINDOW_LEN - (entry->offset - LINE_WINDOW_START);
+  if(len > LINELENGTH - 1)
+    len = LINELENGTH - 1;
+  if((end = memchr(start, '\n', len)) != NULL)
+    len = end - start + 1;
+
+  memcpy(aline, start, len);
+  aline[len] = '\0';
+
+  return 0;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Decode a streamed line
+ *
+ * @param[in]  entry  The line to decode, which must be in line_index
+ *
+ * @return  The decoded line
+ *
+ * @details
+ *
+ * The line is decoded into static memory, which is overwritten the next time
+ * a line is decoded. Everything is filled in as it would have been if the
+ * whole line list was read in, except for where_in_list which is only known
+ * by get_line.
+ *
+ * If the record can't be read, e.g. because the file has changed since it was
+ * read in, an error is logged and only what is in the index is filled in.
+ *
+ * ************************************************************************** */
+
+LinePtr
+decode_streamed_line(LineIndex_t *entry)
+{
+  int m;
+  int nline = entry - line_index;
+  char aline[LINELENGTH];
+  static struct lines decoded;
+
+  memset(&decoded, 0, sizeof(decoded));
+  decoded.nion = entry->nion;
+  decoded.z = ions[entry->nion].z;
+  decoded.istate = ions[entry->nion].istate;
+  decoded.freq = entry->freq;
+  decoded.levl = entry->levl;
+  decoded.levu = entry->levu;
+  decoded.nconfigl = decoded.nconfigu = -1;
+  decoded.where_in_list = -1;
+  decoded.coll_index = entry->coll_index;
+  decoded.macro_info = ions[entry->nion].macro_info == 1;
+
+  if(read_line_record(entry, aline) || scan_line_record(aline, &decoded) < 6)
+  {
+    logfile_error("Unable to decode line %d from %s\n", nline,
+                  entry->file >= 0 && entry->file < NLINE_FILES ? LINE_FILES[entry->file].path : "an unknown file");
+    return &decoded;
+  }
+
+  if(decoded.macro_info == 1)
+  {
+    /* Macro atom lines were matched to their levels and jumps when they were read in */
+    for(m = 0; m < nlevels && (config[m].z != decoded.z || config[m].istate != decoded.istate
+                               || config[m].ilv != decoded.levl); m++)
+      ;
+    if(m < nlevels)
+    {
+      decoded.nconfigl = m;
+      while(decoded.down_index < config[m].n_bbu_jump && config[m].bbu_jump[decoded.down_index] != nline)
+        decoded.down_index++;
+    }
+
+    for(m = 0; m < nlevels && (config[m].z != decoded.z || config[m].istate != decoded.istate
+                               || config[m].ilv != decoded.levu); m++)
+      ;
+    if(m < nlevels)
+    {
+      decoded.nconfigu = m;
+      while(decoded.up_index < config[m].n_bbd_jump && config[m].bbd_jump[decoded.up_index] != nline)
+        decoded.up_index++;
+    }
+  }
+  else
+  {
+    match_line_to_levels(&decoded);
+  }
+
+  return &decoded;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Get a line, in frequency order
+ *
+ * @param[in]  n  The position of the line in the frequency ordered line list
+ *
+ * @return  The line
+ *
+ * @details
+ *
+ * For a streamed line list, the line is decoded into static memory which is
+ * overwritten the next time a line is decoded, so the line should be used
+ * before get_line is called again.
+ *
+ * ************************************************************************** */
+
+LinePtr
+get_line(int n)
+{
+  LinePtr l;
+
+  if(!AtomixConfiguration.lines_streamed)
+    return lin_ptr[n];
+
+  l = decode_streamed_line(line_index_ptr[n]);
+  l->where_in_list = n;
+
+  return l;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Get the frequency of a line, in frequency order
+ *
+ * @param[in]  n  The position of the line in the frequency ordered line list
+ *
+ * @return  The frequency of the line
+ *
+ * ************************************************************************** */
+
+double
+get_line_freq(int n)
+{
+  return line_columns.freq[n];
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Get the ion of a line, in frequency order
+ *
+ * @param[in]  n  The position of the line in the frequency ordered line list
+ *
+ * @return  The ion number of the line
+ *
+ * @details
+ *
+ * This can be used to pick out the lines for an element or ion without
+ * decoding every line in a streamed line list.
+ *
+ * ************************************************************************** */
+
+int
+get_line_nion(int n)
+{
+  return line_columns.nion[n];
+}
@@ -11,10 +11,19 @@
  * ************************************************************************** */
 
 #include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
 
 #include "atomix.h"
 
-static const int ndash = 110;
+static const int ndash = 165;
+
+#define COLLISION_VIEW_NTEMPS 11
+#define COLLISION_EXPORT_NTEMPS 51
+#define COLLISION_EXPORT_BLOCK 1024
 
 /* ************************************************************************** */
 /**
@@ -26,8 +35,9 @@ static const int ndash = 110;
 void
 bound_bound_header(void)
 {
-  display_add(" %-12s %-12s %-12s %-12s %-12s %-12s %-12s %-12s %-12s",
-              "Wavelength", "Element", "Z", "istate", "levu", "levl", "nion", "macro info", "nres");
+  display_add(" %-12s %-12s %-12s %-12s %-12s %-12s %-12s %-12s %-12s %-12s %-12s %-12s %-12s",
+              "Wavelength", "Element", "Z", "istate", "levu", "levl", "nion", "macro info", "nres", "A21", "B12", "B21",
+              "Lifetime");
   add_sep_display(ndash);
 }
 
@@ -35,23 +45,47 @@ bound_bound_header(void)
 /**
  * @brief  Standard layout for a bound bound transition line.
  *
+ * @param[in]   n     The line
+ * @param[out]  row   The formatted line
+ * @param[in]   size  The number of chars in row
+ *
+ * @return  The length of the formatted line
+ *
  * @details
  *
  * The function bound_bound_header will create an appropriate header for one
- * of these lines.
+ * of these lines. This is also the formatter for the rows of the views which
+ * list lines, so the rows are only formatted when they are shown.
  *
  * ************************************************************************** */
 
-void
-bound_bound_line(int n)
+int
+format_bound_bound_line(int n, char *row, int size)
 {
   double wl;
   char element[LINELEN];
+  LinePtr l = get_line(n);
+
+  get_element_name(l->z, element);
+  wl = C_SI / l->freq / ANGSTROM / 1e-2;
+  return snprintf(row, size, " %-12.2f %-12s %-12i %-12i %-12i %-12i %-12i %-12i %-12i %-12.4e %-12.4e %-12.4e %-12.4e",
+                  wl, element, l->z, l->istate, l->levu, l->levl, l->nion, l->macro_info, n, line_columns.a21[n],
+                  line_columns.b12[n], line_columns.b21[n], line_columns.lifetime[n]);
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Add a bound bound transition line to the display buffer.
+ *
+ * ************************************************************************** */
 
-  get_element_name(lin_ptr[n]->z, element);
-  wl = C_SI / lin_ptr[n]->freq / ANGSTROM / 1e-2;
-  display_add(" %-12.2f %-12s %-12i %-12i %-12i %-12i %-12i %-12i %-12i", wl, element, lin_ptr[n]->z,
-              lin_ptr[n]->istate, lin_ptr[n]->levu, lin_ptr[n]->levl, lin_ptr[n]->nion, lin_ptr[n]->macro_info, n);
+void
+bound_bound_line(int n)
+{
+  char row[DISPLAY_ROW_LEN];
+
+  format_bound_bound_line(n, row, sizeof(row));
+  display_add("%s", row);
 }
 
 /* ************************************************************************** */
@@ -60,7 +94,7 @@ bound_bound_line(int n)
  *
  * @details
  *
- * Iterates over the lin_ptr array, which is ordered by frequency. For atomic
+ * Iterates over the lines in frequency order. For atomic
  * data sets, there can be some lines with very large wavelengths.
  *
  * ************************************************************************** */
@@ -68,19 +102,17 @@ bound_bound_line(int n)
 void
 all_bound_bound(void)
 {
-  int i;
   double wmin, wmax;
 
-  wmin = C_SI / lin_ptr[nlines - 1]->freq / ANGSTROM / 1e-2;
-  wmax = C_SI / lin_ptr[0]->freq / ANGSTROM / 1e-2;
+  wmin = C_SI / get_line_freq(nlines - 1) / ANGSTROM / 1e-2;
+  wmax = C_SI / get_line_freq(0) / ANGSTROM / 1e-2;
 
   display_add(" Wavelength range: %.2f - %.2f Angstroms", wmin, wmax);
   add_sep_display(ndash);
 
   bound_bound_header();
 
-  for(i = 0; i < nlines; ++i)
-    bound_bound_line(i);
+  display_add_rows(NULL, 0, nlines, format_bound_bound_line);
 
   count(ndash, nlines);
 
@@ -94,7 +126,7 @@ all_bound_bound(void)
  *
  * @details
  *
- * This function simply loops over the lin_ptr struct between the limits
+ * This function simply loops over the lines between the limits
  * nline_min and nline_max set by the limit_lines() function. The wavelength
  * limits are queried within the function.
  *
@@ -103,7 +135,7 @@ all_bound_bound(void)
 void
 bound_bound_wavelength_range(void)
 {
-  int n, nline;
+  int n;
   double wmin, wmax;
 
   if(query_wavelength_range(&wmin, &wmax) == FORM_QUIT)
@@ -116,8 +148,7 @@ bound_bound_wavelength_range(void)
   add_sep_display(ndash);
   bound_bound_header();
 
-  for(nline = nline_min + 1; nline < nline_max; ++nline)
-    bound_bound_line(nline);
+  display_add_rows(NULL, nline_min + 1, n, format_bound_bound_line);
 
   count(ndash, n);
 
@@ -136,13 +167,14 @@ void
 bound_bound_element(void)
 {
   int n, z;
-  int nline;
+  int nelem;
+  int *entries;
   char element[LINELEN];
 
   if(query_atomic_number(&z) == FORM_QUIT)
     return;
 
-  if(find_element(z) == ELEMENT_NO_FOUND)
+  if((nelem = find_element(z)) == ELEMENT_NO_FOUND)
     return;
 
   get_element_name(z, element);
@@ -150,15 +182,8 @@ bound_bound_element(void)
   add_sep_display(ndash);
   bound_bound_header();
 
-  n = 0;
-  for(nline = 0; nline < nlines; ++nline)
-  {
-    if(lin_ptr[nline]->z == z)
-    {
-      bound_bound_line(nline);
-      n++;
-    }
-  }
+  entries = get_element_postings(nelem, POSTING_LINES, &n);
+  display_add_rows(entries, 0, n, format_bound_bound_line);
 
   count(ndash, n);
 
@@ -181,7 +206,8 @@ void
 bound_bound_ion(void)
 {
   int z, istate;
-  int n, nion, nline;
+  int n, nion;
+  int *entries;
   char element[LINELEN];
 
   if(query_ion_input(TRUE, NULL, NULL, &nion) == FORM_QUIT)
@@ -204,17 +230,199 @@ bound_bound_ion(void)
   add_sep_display(ndash);
   bound_bound_header();
 
-  n = 0;
-  for(nline = 0; nline < nlines; ++nline)
+  entries = get_ion_postings(nion, POSTING_LINES, &n);
+  display_add_rows(entries, 0, n, format_bound_bound_line);
+
+  count(ndash, n);
+
+  display_show(SCROLL_ENABLE, true, 4);
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Print the collision strengths and collisional rates of the lines of
+ *         an ion over a temperature range.
+ *
+ * @details
+ *
+ * The collision strength is from the Burgess & Tully fit for the line if there
+ * is one, otherwise the g-bar approximation is used. The ion and the
+ * temperature range are queried within the function.
+ *
+ * ************************************************************************** */
+
+void
+bound_bound_collisions(void)
+{
+  int i, k, n, nion;
+  int *entries;
+  double tmin, tmax;
+  double temp[COLLISION_VIEW_NTEMPS];
+  double omega[COLLISION_VIEW_NTEMPS];
+  double q21[COLLISION_VIEW_NTEMPS];
+  double q12[COLLISION_VIEW_NTEMPS];
+  char element[LINELEN];
+  LinePtr line;
+
+  if(query_ion_input(TRUE, NULL, NULL, &nion) == FORM_QUIT)
+    return;
+
+  if(nion < 0)
+    nion *= -1;
+
+  if(nion > nions - 1)
+  {
+    error_atomix("Invaild ion number %i > nions %i", nion, nions);
+    return;
+  }
+
+  if(query_temperature_range(&tmin, &tmax) == FORM_QUIT)
+    return;
+
+  temperature_grid(temp, COLLISION_VIEW_NTEMPS, tmin, tmax);
+
+  get_element_name(ions[nion].z, element);
+  display_add("Collisional rates for %s %i: %.2e - %.2e K", element, ions[nion].istate, tmin, tmax);
+  add_sep_display(ndash);
+  bound_bound_header();
+
+  entries = get_ion_postings(nion, POSTING_LINES, &n);
+
+  for(i = 0; i < n; ++i)
   {
-    if(lin_ptr[nline]->z == z && lin_ptr[nline]->istate == istate)
+    bound_bound_line(entries[i]);
+    line = get_line(entries[i]);
+    if(evaluate_collision_rates(line, temp, COLLISION_VIEW_NTEMPS, omega, q21, q12))
+    {
+      display_add("   Collision strength %i has an unknown type", line->coll_index);
+    }
+    else
     {
-      bound_bound_line(nline);
-      n++;
+      display_add("   %-12s %-12s %-12s %-12s %s", "Temperature", "Upsilon", "q21", "q12",
+                  line->coll_index >= 0 ? "(Burgess & Tully fit)" : "(g-bar approximation)");
+      for(k = 0; k < COLLISION_VIEW_NTEMPS; ++k)
+        display_add("   %-12.4e %-12.4e %-12.4e %-12.4e", temp[k], omega[k], q21[k], q12[k]);
     }
+    add_sep_display(ndash);
   }
 
-  count(ndash, n);
+  display_add(" %i lines", n);
 
   display_show(SCROLL_ENABLE, true, 4);
 }
+
+/* ************************************************************************** */
+/**
+ * @brief  Write the collision strengths and collisional rates of every line
+ *         over a temperature range to a file.
+ *
+ * @details
+ *
+ * Each line of the file is a line and a temperature, with the lines in
+ * frequency order. This is used to check all of the collision strength data
+ * at once. The temperature range and the file are queried within the function.
+ *
+ * The lines are done in blocks, so the rates of the whole line list are never
+ * held at once. Only the loop which evaluates the rates of a block is timed,
+ * so the time reported does not include getting the lines or writing the file.
+ *
+ * ************************************************************************** */
+
+void
+bound_bound_collisions_export(void)
+{
+  int i, k, n, nblock;
+  int nfit, nbad;
+  int *status;
+  double tmin, tmax, time_ms;
+  double temp[COLLISION_EXPORT_NTEMPS];
+  double *omega, *q21, *q12;
+  struct timespec start, end;
+  struct lines *block;
+  LinePtr line;
+  FILE *fptr;
+
+  static char output[FIELD_INPUT_LEN] = "collisions.txt";
+
+  if(query_temperature_range(&tmin, &tmax) == FORM_QUIT)
+    return;
+  if(query_file_path("Output file : ", "Input the file to write the collisional rates to", output) == FORM_QUIT)
+    return;
+
+  if(strlen(output) == 0 || (fptr = fopen(output, "w")) == NULL)
+  {
+    error_atomix("Unable to open output file %s", output);
+    return;
+  }
+
+  block = malloc(COLLISION_EXPORT_BLOCK * sizeof(*block));
+  status = malloc(COLLISION_EXPORT_BLOCK * sizeof(*status));
+  omega = malloc(3 * COLLISION_EXPORT_BLOCK * COLLISION_EXPORT_NTEMPS * sizeof(*omega));
+  if(block == NULL || status == NULL || omega == NULL)
+  {
+    error_atomix("Unable to allocate memory for the collisional rates");
+    free(block);
+    free(status);
+    free(omega);
+    fclose(fptr);
+    return;
+  }
+  q21 = omega + COLLISION_EXPORT_BLOCK * COLLISION_EXPORT_NTEMPS;
+  q12 = q21 + COLLISION_EXPORT_BLOCK * COLLISION_EXPORT_NTEMPS;
+
+  temperature_grid(temp, COLLISION_EXPORT_NTEMPS, tmin, tmax);
+
+  fprintf(fptr, "# Collisional rates: %.2e - %.2e K\n", tmin, tmax);
+  fprintf(fptr, "# %-12s %-6s %-6s %-6s %-6s %-10s %-12s %-12s %-12s %-12s\n", "Wavelength", "z", "istate", "levl",
+          "levu", "coll_index", "Temperature", "Upsilon", "q21", "q12");
+
+  nfit = nbad = 0;
+  time_ms = 0;
+
+  for(n = 0; n < nlines; n += nblock)
+  {
+    /* A streamed line is overwritten by the next call to get_line, so the lines of the block are copied */
+    nblock = nlines - n < COLLISION_EXPORT_BLOCK ? nlines - n : COLLISION_EXPORT_BLOCK;
+    for(i = 0; i < nblock; ++i)
+      block[i] = *get_line(n + i);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(i = 0; i < nblock; ++i)
+      status[i] = evaluate_collision_rates(&block[i], temp, COLLISION_EXPORT_NTEMPS, &omega[i * COLLISION_EXPORT_NTEMPS],
+                                           &q21[i * COLLISION_EXPORT_NTEMPS], &q12[i * COLLISION_EXPORT_NTEMPS]);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    time_ms += (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+
+    for(i = 0; i < nblock; ++i)
+    {
+      if(status[i])
+      {
+        nbad++;
+        continue;
+      }
+
+      line = &block[i];
+      if(line->coll_index >= 0)
+        nfit++;
+
+      for(k = i * COLLISION_EXPORT_NTEMPS; k < (i + 1) * COLLISION_EXPORT_NTEMPS; ++k)
+        fprintf(fptr, "%-14.6e %-6i %-6i %-6i %-6i %-10i %-12.4e %-12.4e %-12.4e %-12.4e\n",
+                C_SI / line->freq / ANGSTROM / 1e-2, line->z, line->istate, line->levl, line->levu, line->coll_index,
+                temp[k - i * COLLISION_EXPORT_NTEMPS], omega[k], q21[k], q12[k]);
+    }
+  }
+
+  fclose(fptr);
+  free(block);
+  free(status);
+  free(omega);
+
+  display_add(" Collisional rates: %.2e - %.2e K", tmin, tmax);
+  display_add(" Calculated %i lines at %i temperatures in %.2f ms", nlines - nbad, COLLISION_EXPORT_NTEMPS, time_ms);
+  display_add(" %i lines have a Burgess & Tully fit and %i use the g-bar approximation", nfit, nlines - nbad - nfit);
+  if(nbad > 0)
+    display_add(" %i lines have a fit of unknown type and were skipped", nbad);
+  display_add(" Wrote to %s", output);
+
+  display_show(SCROLL_ENABLE, false, 0);
+}
@@ -9,20 +9,249 @@
  * These are a series of routines designed to store comments and errors in a
  * diagnostic file or files.
  *
+ * The messages are not written to the file by the thread which logs them.
+ * They are copied into a ring of fixed size slots, which a writer thread
+ * empties into the file in batches. A message is given enough consecutive
+ * slots for its text by atomically adding to the count of reserved slots, so
+ * any number of threads can copy their messages into the ring at the same
+ * time without taking a lock. Each slot is marked as ready by storing its
+ * sequence number in it once its text has been copied, and the writer only
+ * writes out the slots before the first one which is not ready, so messages
+ * come out whole and in the order their slots were reserved.
+ *
+ * The writer waits for LOG_BATCH_DELAY_MS after a slot is first ready, or
+ * until LOG_BATCH_SLOTS slots are waiting, so that it is not woken up for
+ * every message. A logging thread only waits for the writer when the ring is
+ * full or is being flushed. If the writer thread can't be started, the
+ * messages are written to the file as they are logged.
+ *
  ***********************************************************/
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
+#include <pthread.h>
+#include <time.h>
 
-#include "log.h"
+#include "atomix.h"
 
 #define LINELENGTH 256
+#define LOG_SLOT_SIZE 240
+#define LOG_NSLOTS 4096
+#define LOG_BATCH_SLOTS (LOG_NSLOTS / 4)
+#define LOG_BATCH_DELAY_MS 50
+
+typedef struct LogSlot_t
+{
+  unsigned long seq;            /* One more than the sequence number of the slot once it is ready */
+  size_t len;                   /* The number of chars in text */
+  char text[LOG_SLOT_SIZE];
+} LogSlot_t;
 
 FILE *diagptr;
 int init_log = 0;
 
+static int log_verbosity = LOG_INFO;
+static int log_threaded = 0;
+static int log_stop = 0;
+static int log_nwaiting = 0;    // The number of threads waiting for text to be written
+static int log_exit_registered = 0;
+
+static LogSlot_t log_ring[LOG_NSLOTS];
+static unsigned long log_head = 0;      // The number of slots reserved
+static unsigned long log_tail = 0;      // The number of slots written to the file
+
+static pthread_t log_writer_thread;
+static pthread_mutex_t log_wake_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t log_wake_writer = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t log_written = PTHREAD_COND_INITIALIZER;
+
+/**********************************************************/
+/**
+ * @brief      Check if a slot of the ring buffer is ready to be written
+ *
+ * @param [in] unsigned long  seq   The sequence number of the slot
+ * @return     TRUE if the text of the slot has been copied into it
+ *
+ **********************************************************/
+
+static int
+logfile_slot_ready(unsigned long seq)
+{
+  return __atomic_load_n(&log_ring[seq % LOG_NSLOTS].seq, __ATOMIC_SEQ_CST) == seq + 1;
+}
+
+/**********************************************************/
+/**
+ * @brief      Write the text in the ring buffer to the log file
+ *
+ * @param [in] void *  arg   Unused
+ * @return     NULL
+ *
+ * This is run by the writer thread until the log file is closed
+ *
+ * ###Notes###
+ *
+ * Once the next slot is ready, the thread waits for more to build up
+ * unless there is a full batch, a thread is waiting for the text to be
+ * written, or the file is being closed.
+ * All of the ready slots are then written before the tail is moved on, so
+ * the logging threads know that everything before the tail is in the file
+ * and that its slots can be reused.
+ *
+ **********************************************************/
+
+static void *
+logfile_writer(void *arg)
+{
+  unsigned long tail;
+  LogSlot_t *slot;
+  struct timespec deadline;
+
+  (void) arg;
+
+  pthread_mutex_lock(&log_wake_lock);
+
+  while(1)
+  {
+    while(!log_stop && !logfile_slot_ready(log_tail))
+      pthread_cond_wait(&log_wake_writer, &log_wake_lock);
+
+    if(!logfile_slot_ready(log_tail))
+      break;
+
+    if(!log_stop && log_nwaiting == 0 && __atomic_load_n(&log_head, __ATOMIC_SEQ_CST) - log_tail < LOG_BATCH_SLOTS)
+    {
+      clock_gettime(CLOCK_REALTIME, &deadline);
+      deadline.tv_nsec += LOG_BATCH_DELAY_MS * 1000000L;
+      if(deadline.tv_nsec >= 1000000000L)
+      {
+        deadline.tv_sec += 1;
+        deadline.tv_nsec -= 1000000000L;
+      }
+      pthread_cond_timedwait(&log_wake_writer, &log_wake_lock, &deadline);
+    }
+
+    pthread_mutex_unlock(&log_wake_lock);
+
+    for(tail = log_tail; logfile_slot_ready(tail); tail++)
+    {
+      slot = &log_ring[tail % LOG_NSLOTS];
+      fwrite(slot->text, 1, slot->len, diagptr);
+    }
+
+    pthread_mutex_lock(&log_wake_lock);
+    __atomic_store_n(&log_tail, tail, __ATOMIC_SEQ_CST);
+    pthread_cond_broadcast(&log_written);
+  }
+
+  pthread_mutex_unlock(&log_wake_lock);
+
+  return NULL;
+}
+
+/**********************************************************/
+/**
+ * @brief      Wait until the writer thread has written everything up to a
+ *             point in the ring buffer
+ *
+ * @param [in] unsigned long  upto   The number of slots which have to be
+ *                                   written
+ *
+ * ###Notes###
+ *
+ * The writer thread is woken up in case it is waiting for more text.
+ *
+ **********************************************************/
+
+static void
+logfile_wait(unsigned long upto)
+{
+  pthread_mutex_lock(&log_wake_lock);
+  log_nwaiting++;
+  pthread_cond_signal(&log_wake_writer);
+  while((long) (upto - log_tail) > 0)
+    pthread_cond_wait(&log_written, &log_wake_lock);
+  log_nwaiting--;
+  pthread_mutex_unlock(&log_wake_lock);
+}
+
+/**********************************************************/
+/**
+ * @brief      Add text to the log file
+ *
+ * @param [in] char *  text   The text
+ * @param [in] size_t  len    The number of chars in text
+ *
+ * ###Notes###
+ *
+ * The slots for the text are reserved with a single atomic add, and then
+ * filled in and marked as ready one at a time. This only waits for the
+ * writer thread if a slot has not been written out since it was last used,
+ * so text which is longer than the whole ring is fed through it as the writer
+ * empties it. The writer thread is only woken up if the ring was empty, or if
+ * there is now a full batch to write.
+ *
+ **********************************************************/
+
+static void
+logfile_append(char *text, size_t len)
+{
+  unsigned long first, nslots, seq, tail;
+  size_t n;
+  LogSlot_t *slot;
+
+  if(!log_threaded)
+  {
+    fwrite(text, 1, len, diagptr);
+    return;
+  }
+
+  nslots = (len + LOG_SLOT_SIZE - 1) / LOG_SLOT_SIZE;
+  first = __atomic_fetch_add(&log_head, nslots, __ATOMIC_SEQ_CST);
+
+  for(seq = first; seq < first + nslots; seq++)
+  {
+    if(seq - __atomic_load_n(&log_tail, __ATOMIC_SEQ_CST) >= LOG_NSLOTS)
+      logfile_wait(seq - LOG_NSLOTS + 1);
+
+    slot = &log_ring[seq % LOG_NSLOTS];
+    n = len < LOG_SLOT_SIZE ? len : LOG_SLOT_SIZE;
+    memcpy(slot->text, text, n);
+    slot->len = n;
+    text += n;
+    len -= n;
+
+    __atomic_store_n(&slot->seq, seq + 1, __ATOMIC_SEQ_CST);
+
+    tail = __atomic_load_n(&log_tail, __ATOMIC_SEQ_CST);
+    if(tail == seq || seq + 1 - tail == LOG_BATCH_SLOTS)
+    {
+      pthread_mutex_lock(&log_wake_lock);
+      pthread_cond_signal(&log_wake_writer);
+      pthread_mutex_unlock(&log_wake_lock);
+    }
+  }
+}
+
+/**********************************************************/
+/**
+ * @brief      Close the log file when the program exits
+ *
+ * ###Notes###
+ *
+ * This makes sure that the text still in the ring buffer is written if the
+ * log file has not been closed.
+ *
+ **********************************************************/
+
+static void
+logfile_exit(void)
+{
+  logfile_close();
+}
+
 /**********************************************************/
 /**
  * @brief      Open a log file
@@ -32,6 +261,9 @@ int init_log = 0;
  *
  * ###Notes###
  *
+ * If a log file is already open, it is closed first. The count of slots
+ * carries on from the last log file rather than starting again at zero, so
+ * the sequence numbers left in the ring are never taken as ready.
  *
  **********************************************************/
 
@@ -39,6 +271,9 @@ int
 logfile_init(filename)
      char *filename;
 {
+  if(init_log)
+    logfile_close();
+
   if((diagptr = fopen(filename, "w")) == NULL)
   {
     printf("Yikes: could not even open log file %s\n", filename);
@@ -46,6 +281,15 @@ logfile_init(filename)
   }
   init_log = 1;
 
+  log_stop = 0;
+  log_threaded = pthread_create(&log_writer_thread, NULL, logfile_writer, NULL) == 0;
+
+  if(!log_exit_registered)
+  {
+    atexit(logfile_exit);
+    log_exit_registered = 1;
+  }
+
   return (0);
 }
 
@@ -59,18 +303,141 @@ logfile_init(filename)
  *
  * ###Notes###
  *
+ * The writer thread is stopped once it has written everything which has been
+ * logged. Nothing happens if the log file is not open.
  *
  **********************************************************/
 
 int
 logfile_close()
 {
-  logfile_flush();
+  if(init_log == 0)
+    return (0);
+
+  if(log_threaded)
+  {
+    pthread_mutex_lock(&log_wake_lock);
+    log_stop = 1;
+    pthread_cond_signal(&log_wake_writer);
+    pthread_mutex_unlock(&log_wake_lock);
+    pthread_join(log_writer_thread, NULL);
+    log_threaded = 0;
+  }
+
   fclose(diagptr);
   init_log = 0;                 // Release the error summary structure
   return (0);
 }
 
+/**********************************************************/
+/**
+ * @brief      Set the verbosity of the log file
+ *
+ * @param [in] int  level   Messages with a level above this are not written
+ * @return     Always returns 0
+ *
+ * ###Notes###
+ *
+ * The levels are LOG_ERROR, LOG_INFO and LOG_DISPLAY.
+ *
+ **********************************************************/
+
+int
+logfile_verbosity(int level)
+{
+  log_verbosity = level;
+  return (0);
+}
+
+/**********************************************************/
+/**
+ * @brief      Print/write a message with a level
+ *
+ * @param [in] int     level    The level of the message
+ * @param [in] char *  prefix   Text to put before the message
+ * @param [in] char *  format   The format string for the message
+ * @param [in] va_list ap       The values which fill out the format string
+ * @return     The number of characters sucessfully written
+ *
+ * ###Notes###
+ *
+ * A message above the verbosity is not formatted. Messages are formatted on
+ * the stack unless they are too long.
+ *
+ **********************************************************/
+
+static int
+logfile_vmessage(int level, char *prefix, char *format, va_list ap)
+{
+  int len, plen;
+  char line[LINELENGTH * 4];
+  char *text = line;
+  va_list ap2;
+
+  if(level > log_verbosity)
+    return (0);
+
+  if(init_log == 0)
+    logfile_init("logfile");
+
+  va_copy(ap2, ap);             /* ap is not necessarily preserved by vsnprintf */
+
+  plen = strlen(prefix);
+  len = plen + vsnprintf(line + plen, sizeof(line) - plen, format, ap);
+  if(len < plen)
+  {
+    va_end(ap2);
+    return (0);
+  }
+  if((size_t) len >= sizeof(line))
+  {
+    if((text = malloc(len + 1)) == NULL)
+    {
+      va_end(ap2);
+      return (0);
+    }
+    vsnprintf(text + plen, len - plen + 1, format, ap2);
+  }
+  memcpy(text, prefix, plen);
+
+  va_end(ap2);
+
+  logfile_append(text, len);
+
+  if(text != line)
+    free(text);
+
+  return (len);
+}
+
+/**********************************************************/
+/**
+ * @brief      Print/write a message with a level
+ *
+ * @param [in] int     level    The level of the message
+ * @param [in] char *  format   The format string for the message
+ * @param [in]   ...   The various values which fill out the format screen
+ * @return     The number of characters sucessfully written
+ *
+ * ###Notes###
+ *
+ * Nothing is written if the level is above the verbosity of the log file.
+ *
+ **********************************************************/
+
+int
+logfile_message(int level, char *format, ...)
+{
+  va_list ap;
+  int result;
+
+  va_start(ap, format);
+  result = logfile_vmessage(level, "", format, ap);
+  va_end(ap);
+
+  return (result);
+}
+
 /**********************************************************/
 /**
  * @brief      Print/write an informational message
@@ -83,24 +450,20 @@ logfile_close()
  *
  * ###Notes###
  *
- * Printing to the screen can be suppressed by setting the verbosity level
+ * The message has the level LOG_INFO.
  *
  **********************************************************/
 
 int
 logfile(char *format, ...)
 {
-  va_list ap, ap2;
+  va_list ap;
   int result;
 
-  if(init_log == 0)
-    logfile_init("logfile");
-
   va_start(ap, format);
-  va_copy(ap2, ap);             /* ap is not necessarily preserved by vprintf */
-  result = vfprintf(diagptr, format, ap2);
-  va_end(ap);
+  result = logfile_vmessage(LOG_INFO, "", format, ap);
   va_end(ap);
+
   return (result);
 }
 
@@ -119,25 +482,20 @@ logfile(char *format, ...)
  *
  * ###Notes###
  *
- * Writing to the screen can be suppressed depending on the level of verbosity
+ * The message has the level LOG_ERROR, so it is always written, and starts
+ * with "Error: ".
  *
  **********************************************************/
 
 int
 logfile_error(char *format, ...)
 {
-  va_list ap, ap2;
-  int result = 0;
-
-  if(init_log == 0)
-    logfile_init("logfile");
+  va_list ap;
+  int result;
 
   va_start(ap, format);
-  va_copy(ap2, ap);
-//  fprintf (diagptr, "Error: ")
-//  result = vfprintf (diagptr, format, ap2);
+  result = logfile_vmessage(LOG_ERROR, "Error: ", format, ap);
   va_end(ap);
-  va_end(ap2);
 
   return (result);
 }
@@ -153,7 +511,7 @@ logfile_error(char *format, ...)
  *
  * ###Notes###
  *
- *
+ * This waits for the writer thread to write everything which has been logged.
  *
  **********************************************************/
 
@@ -163,6 +521,9 @@ logfile_flush()
   if(init_log == 0)
     logfile_init("logfile");
 
+  if(log_threaded)
+    logfile_wait(__atomic_load_n(&log_head, __ATOMIC_SEQ_CST));
+
   fflush(diagptr);
   return (0);
 }
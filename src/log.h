@@ -1,6 +1,8 @@
 /* log.c */
 int logfile_init(char *filename);
 int logfile_close(void);
+int logfile_verbosity(int level);
+int logfile_message(int level, char *format, ...);
 int logfile(char *format, ...);
 int logfile_error(char *format, ...);
 int logfile_flush(void);
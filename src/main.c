@@ -47,20 +47,31 @@ main(int argc, char *argv[])
   AtomixConfiguration.rows = AtomixConfiguration.cols = 0;
   AtomixConfiguration.current_line = AtomixConfiguration.current_col = 0;
   AtomixConfiguration.atomic_data_loaded = FALSE;
+  AtomixConfiguration.lines_streamed = FALSE;
   AtomixConfiguration.atomic_data[0] = '\0';
   AtomixConfiguration.status_message[0] = '\0';
 
   DISPLAY_BUFFER.nlines = 0;
   DISPLAY_BUFFER.maxlen = 0;
+  DISPLAY_BUFFER.maxlines = 0;
   DISPLAY_BUFFER.lines = NULL;
+  DISPLAY_BUFFER.chunks = DISPLAY_BUFFER.current = NULL;
+  memset(&DISPLAY_BUFFER.rows, 0, sizeof(DISPLAY_BUFFER.rows));
+  DISPLAY_BUFFER.log_level = LOG_DISPLAY;
   strcpy(DISPLAY_BUFFER.name, "display");
 
   ATOMIC_BUFFER.nlines = 0;
   ATOMIC_BUFFER.maxlen = 0;
+  ATOMIC_BUFFER.maxlines = 0;
   ATOMIC_BUFFER.lines = NULL;
+  ATOMIC_BUFFER.chunks = ATOMIC_BUFFER.current = NULL;
+  memset(&ATOMIC_BUFFER.rows, 0, sizeof(ATOMIC_BUFFER.rows));
+  ATOMIC_BUFFER.log_level = LOG_INFO;
   strcpy(ATOMIC_BUFFER.name, "atomic");
 
   logfile_init("atomix.log.txt");
+  if(getenv("ATOMIX_LOG_LEVEL") != NULL && strlen(getenv("ATOMIX_LOG_LEVEL")) > 0)
+    logfile_verbosity(atoi(getenv("ATOMIX_LOG_LEVEL")));
   check_command_line(argc, argv);
 
   /*
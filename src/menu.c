@@ -465,6 +465,66 @@ inner_shell_main_menu(void)
   }
 }
 
+/* ************************************************************************** */
+/**
+ * @brief  The main menu for recombination and ionization rate queries.
+ *
+ * @details
+ *
+ * The previous menu index is remembered.
+ *
+ * ************************************************************************** */
+
+void
+rates_main_menu(void)
+{
+  static int menu_index = 0;
+
+  if(nions == 0)
+  {
+    error_atomix("No ions have been read in. Unable to query!");
+    return;
+  }
+
+  while(true)
+  {
+    menu_index = create_menu(CONTENT_VIEW_WINDOW, "Recombination and Ionization Rates", RATES_MENU_CHOICES,
+                             ARRAY_SIZE(RATES_MENU_CHOICES), menu_index, MENU_CONTROL);
+    if(RATES_MENU_CHOICES[menu_index].index == MENU_QUIT || menu_index == MENU_QUIT)
+      return;
+  }
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  The main menu for free-free queries.
+ *
+ * @details
+ *
+ * The previous menu index is remembered.
+ *
+ * ************************************************************************** */
+
+void
+free_free_main_menu(void)
+{
+  static int menu_index = 0;
+
+  if(gaunt_n_gsqrd == 0)
+  {
+    error_atomix("No free-free gaunt factors have been read in");
+    return;
+  }
+
+  while(true)
+  {
+    menu_index = create_menu(CONTENT_VIEW_WINDOW, "Free-free", FREE_FREE_MENU_CHOICES,
+                             ARRAY_SIZE(FREE_FREE_MENU_CHOICES), menu_index, MENU_CONTROL);
+    if(FREE_FREE_MENU_CHOICES[menu_index].index == MENU_QUIT || menu_index == MENU_QUIT)
+      return;
+  }
+}
+
 /* ************************************************************************** */
 /**
  * @brief  The main menu for atomic configuration queries.
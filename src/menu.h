@@ -20,8 +20,10 @@ MenuItem_t MAIN_MENU_CHOICES[] = {
   {&bound_bound_main_menu, 3, "Bound-Bound", "Query possible bound-bound transitions"},
   {&bound_free_main_menu, 4, "Bound-Free", "Query the photionization edges"},
   {&inner_shell_main_menu, 5, "Inner-Shell", "Query inner shell ionization edges"},
-  {&view_atomic_summary, 6, "Atomic Summary", "View the atomic summary output"},
-  {&switch_atomic_data, 7, "Switch Atomic Data", "Switch atomic data data sets"},
+  {&rates_main_menu, 6, "Rates", "Query the recombination and ionization rates"},
+  {&free_free_main_menu, 7, "Free-Free", "Query the free-free gaunt factors and emission"},
+  {&view_atomic_summary, 8, "Atomic Summary", "View the atomic summary output"},
+  {&switch_atomic_data, 9, "Switch Atomic Data", "Switch atomic data data sets"},
   {&menu_exit_atomix, MENU_QUIT, "Exit", "Exit Atomix"},
 };
 
@@ -31,6 +33,8 @@ MenuItem_t BOUND_MENU_CHOICES[] = {
   {&bound_bound_wavelength_range, 1, "By wavelength range", "Print the transitions over a given wavelength range"},
   {&bound_bound_element, 2, "By element", "Print all the transitions for a given element"},
   {&bound_bound_ion, 3, "By ion number", "Print all the transitions for a given ion"},
+  {&bound_bound_collisions, 4, "Collisional rates", "Print the collisional rates for an ion over a temperature range"},
+  {&bound_bound_collisions_export, 5, "Export collisional rates", "Write the collisional rates of every line to a file"},
   {NULL, MENU_QUIT, "Return to main menu", ""}
 };
 
@@ -40,6 +44,10 @@ MenuItem_t BOUND_FREE_MENU_CHOICES[] = {
   {&bound_free_wavelength_range, 1, "By wavelength range", "Print the transitions over a given wavelength range"},
   {&bound_free_element, 2, "By element", "Print all the transitions for a given element"},
   {&bound_free_ion, 3, "By ion number", "Print all the transitions for a given ion"},
+  {&bound_free_coverage, 4, "Absorbing over wavelength range", "Print the edges absorbing over a wavelength range"},
+  {&bound_free_evaluate, 5, "Evaluate cross sections", "Print the cross sections for an ion over a wavelength range"},
+  {&bound_free_opacity, 6, "Total cross section", "Print the total bound-free cross section over a wavelength range"},
+  {&bound_free_opacity_export, 7, "Export total cross section", "Write the total bound-free cross section to a file"},
   {NULL, MENU_QUIT, "Return to main menu", ""}
 };
 
@@ -49,6 +57,26 @@ MenuItem_t INNER_SHELL_MENU_CHOICES[] = {
   {&inner_shell_wavelength_range, 1, "By wavelength range", "Print the transitions over a given wavelength range"},
   {&inner_shell_element, 2, "By element", "Print all the transitions for a given element"},
   {&inner_shell_ion, 3, "By ion number", "Print all the transitions for a given ion"},
+  {&inner_shell_coverage, 4, "Absorbing over wavelength range", "Print the edges absorbing over a wavelength range"},
+  {NULL, MENU_QUIT, "Return to main menu", ""}
+};
+
+// const
+MenuItem_t RATES_MENU_CHOICES[] = {
+  {&ion_rates, 0, "By ion number", "Print the rates for an ion over a temperature range"},
+  {&all_ion_rates, 1, "All ions", "Print the rates for every ion with rate data over a temperature range"},
+  {&ion_rates_export, 2, "Export rates", "Write the rates of every ion to a file"},
+  {&ion_equilibrium, 3, "Ionization equilibrium", "Print the collisional ionization equilibrium of an element"},
+  {&ion_equilibrium_export, 4, "Export ionization equilibrium",
+   "Write the collisional ionization equilibrium of every element to a file"},
+  {NULL, MENU_QUIT, "Return to main menu", ""}
+};
+
+// const
+MenuItem_t FREE_FREE_MENU_CHOICES[] = {
+  {&free_free_gaunt, 0, "Gaunt factors", "Print the free-free gaunt factors over a temperature range"},
+  {&free_free_emission, 1, "Emission", "Print the free-free emissivity and opacity over a wavelength range"},
+  {&free_free_emission_export, 2, "Export emission", "Write the free-free emissivity and opacity to a file"},
   {NULL, MENU_QUIT, "Return to main menu", ""}
 };
 
@@ -0,0 +1,268 @@
+/* ************************************************************************** */
+/**
+ * @file     opacity.c
+ *
+ * @brief
+ *
+ * Functions for calculating the total bound-free cross section of the atomic
+ * data on a grid of frequencies.
+ *
+ * @details
+ *
+ * The total is the sum of the photoionization and inner shell cross sections
+ * of every edge, each of which can be weighted by the fraction of its ion,
+ * e.g. from a Python model. An edge only contributes between its threshold
+ * and the last point of its cross section.
+ *
+ * The grid is split into chunks, one for each thread. For each chunk, the
+ * edges which absorb over the chunk are found using the coverage trees in
+ * threshold order, and each of these is evaluated by evaluate_xsection over
+ * only the part of the chunk it covers. Every point of the grid is therefore
+ * only touched by the edges which absorb there.
+ *
+ * ************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "atomix.h"
+
+#define LINELENGTH 400
+#define OPACITY_MIN_PER_THREAD 256
+
+typedef struct OpacityTask_t
+{
+  double *freq;
+  double *weights;
+  double *total;
+  int lo, hi;                   /* The part of the grid to calculate */
+  int status;                   /* 0 on success, or ATOMIC_MEMORY_ISSUE_ERROR */
+} OpacityTask_t;
+
+/* ************************************************************************** */
+/**
+ * @brief  Find the first point of a grid above a frequency
+ *
+ * @param[in]  freq  The grid, in ascending order
+ * @param[in]  lo    The first point to search
+ * @param[in]  hi    The point after the last point to search
+ * @param[in]  f     The frequency
+ * @param[in]  above_or_equal  If TRUE, find the first point >= f instead
+ *
+ * @return  The position of the point, or hi if there is none
+ *
+ * ************************************************************************** */
+
+static int
+find_grid_point(double *freq, int lo, int hi, double f, int above_or_equal)
+{
+  int n;
+
+  while(lo < hi)
+  {
+    n = (lo + hi) >> 1;
+    if(freq[n] > f || (above_or_equal && freq[n] == f))
+      hi = n;
+    else
+      lo = n + 1;
+  }
+
+  return lo;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Add the edges in a frequency ordered list to part of the grid
+ *
+ * @param[in, out]  task       The part of the grid
+ * @param[in]       edges      The edges, i.e. phot_top_ptr or inner_cross_ptr
+ * @param[in]       threshold  The thresholds of the edges
+ * @param[in]       tree       The coverage tree of the edges
+ * @param[in]       nedges     The number of edges
+ * @param[out]      active     Working space for nedges edge positions
+ * @param[out]      sigma      Working space for the cross section over the part
+ *                             of the grid
+ *
+ * ************************************************************************** */
+
+static void
+add_edges(OpacityTask_t *task, TopPhotPtr *edges, double *threshold, double *tree, int nedges, int *active,
+          double *sigma)
+{
+  int i, k, nactive;
+  int klo, khi;
+  double weight;
+  TopPhotPtr x;
+
+  nactive = find_covering_edges(threshold, tree, nedges, task->freq[task->lo], task->freq[task->hi - 1], active);
+
+  for(i = 0; i < nactive; i++)
+  {
+    x = edges[active[i]];
+    if(task->weights)
+      weight = x->nion >= 0 && x->nion < nions ? task->weights[x->nion] : 0;
+    else
+      weight = 1;
+    if(weight == 0)
+      continue;
+
+    klo = find_grid_point(task->freq, task->lo, task->hi, x->freq[0], TRUE);
+    khi = find_grid_point(task->freq, klo, task->hi, x->freq[x->np > 0 ? x->np - 1 : 0], FALSE);
+    evaluate_xsection(x, &task->freq[klo], khi - klo, sigma);
+
+    for(k = klo; k < khi; k++)
+      task->total[k] += weight * sigma[k - klo];
+  }
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Calculate the total cross section over part of the grid
+ *
+ * @param[in]  arg  The task
+ *
+ * @return  NULL
+ *
+ * ************************************************************************** */
+
+static void *
+run_opacity_task(void *arg)
+{
+  int *active;
+  double *sigma;
+  OpacityTask_t *task = arg;
+
+  memset(&task->total[task->lo], 0, (task->hi - task->lo) * sizeof(*task->total));
+
+  active = malloc((nphot_total > n_inner_tot ? nphot_total : n_inner_tot) * sizeof(*active) + sizeof(*active));
+  sigma = malloc((task->hi - task->lo) * sizeof(*sigma));
+  if(active == NULL || sigma == NULL)
+  {
+    task->status = ATOMIC_MEMORY_ISSUE_ERROR;
+  }
+  else
+  {
+    add_edges(task, phot_top_ptr, phot_top_threshold, phot_top_coverage, nphot_total, active, sigma);
+    add_edges(task, inner_cross_ptr, inner_cross_threshold, inner_cross_coverage, n_inner_tot, active, sigma);
+    task->status = 0;
+  }
+
+  free(active);
+  free(sigma);
+
+  return NULL;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Calculate the total bound-free cross section on a grid of
+ *         frequencies
+ *
+ * @param[in]   freq      The frequencies, in ascending order
+ * @param[in]   nfreq     The number of frequencies
+ * @param[in]   weights   The weight of each ion, e.g. its ion fraction, or NULL
+ *                        to give every ion a weight of 1
+ * @param[out]  total     The total cross section at each frequency
+ * @param[out]  nthreads  The number of threads used, or NULL
+ *
+ * @return  0 on success, -1 if the frequencies are not in ascending order, or
+ *          ATOMIC_MEMORY_ISSUE_ERROR if there was not enough memory
+ *
+ * ************************************************************************** */
+
+int
+total_bf_opacity(double *freq, int nfreq, double *weights, double *total, int *nthreads)
+{
+  int i, nparts;
+  OpacityTask_t tasks[PARALLEL_MAX_THREADS];
+
+  for(i = 1; i < nfreq; i++)
+    if(freq[i] < freq[i - 1])
+      return -1;
+
+  if(nthreads)
+    *nthreads = 0;
+  if(nfreq < 1)
+    return 0;
+
+  /* Make sure the interpolation is chosen before any threads use it */
+  xsection_uses_simd();
+
+  nparts = count_parallel_chunks(nfreq, OPACITY_MIN_PER_THREAD);
+
+  for(i = 0; i < nparts; i++)
+  {
+    tasks[i].freq = freq;
+    tasks[i].weights = weights;
+    tasks[i].total = total;
+    tasks[i].lo = (int) ((long) nfreq * i / nparts);
+    tasks[i].hi = (int) ((long) nfreq * (i + 1) / nparts);
+    tasks[i].status = 0;
+  }
+
+  run_parallel_tasks(run_opacity_task, tasks, sizeof(*tasks), nparts);
+
+  if(nthreads)
+    *nthreads = nparts;
+
+  for(i = 0; i < nparts; i++)
+    if(tasks[i].status)
+      return tasks[i].status;
+
+  return 0;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Read the fraction of each ion from a file
+ *
+ * @param[in]   path     The file
+ * @param[out]  weights  The fraction of each ion, nions long
+ *
+ * @return  The number of ions read in, or -1 if the file could not be read
+ *
+ * @details
+ *
+ * Each line of the file gives the atomic number, ionisation state and fraction
+ * of an ion, and lines beginning with # are ignored. Ions which are not in the
+ * file have a fraction of zero.
+ *
+ * ************************************************************************** */
+
+int
+read_ion_fractions(char *path, double *weights)
+{
+  int n, nread;
+  int z, istate;
+  double frac;
+  char aline[LINELENGTH];
+  FILE *fptr;
+
+  if((fptr = fopen(path, "r")) == NULL)
+    return -1;
+
+  for(n = 0; n < nions; n++)
+    weights[n] = 0;
+
+  nread = 0;
+  while(fgets(aline, LINELENGTH, fptr) != NULL)
+  {
+    if(skip_whitespace(aline)[0] == '#' || scan_atomic_record(aline, "%d %d %le", &z, &istate, &frac) != 3)
+      continue;
+
+    for(n = 0; n < nions; n++)
+    {
+      if(ions[n].z == z && ions[n].istate == istate)
+      {
+        weights[n] = frac;
+        nread++;
+        break;
+      }
+    }
+  }
+
+  fclose(fptr);
+
+  return nread;
+}
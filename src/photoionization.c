@@ -11,11 +11,20 @@
  * ************************************************************************** */
 
 #include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
 
 #include "atomix.h"
 
 static const int ndash = 99;
 
+#define XSECTION_VIEW_NPOINTS 50
+#define OPACITY_VIEW_NPOINTS 500
+#define OPACITY_EXPORT_NPOINTS 10000
+
 /* ************************************************************************** */
 /**
  * @brief  Add a header for the bound free table.
@@ -39,21 +48,38 @@ bound_free_header(void)
  * @details
  *
  * The function bound_free_header will create an approprate header for these
- * lines.
+ * lines. nphot is the position of the edge in phot_top_ptr, i.e. in frequency
+ * order, but nres is worked out from the position of the edge in phot_top.
+ * This is also the formatter for the rows of the views which list edges.
  *
  * ************************************************************************** */
 
-void
-bound_free_line(int nphot)
+int
+format_bound_free_line(int nphot, char *row, int size)
 {
   double wavelength;
   char element[LINELEN];
+  TopPhotPtr x = phot_top_ptr[nphot];
+
+  get_element_name(x->z, element);
+  wavelength = C_SI / x->freq[0] / ANGSTROM / 1e-2;
+  return snprintf(row, size, " %-12.2f %-12s %-12i %-12i %-12i %-12i %-12i %-12i", wavelength, element, x->z,
+                  x->istate, x->n, x->l, ions[x->nion].phot_info, 1 + PYTHON_NLINES + (int) (x - phot_top));
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Add a bound free line to the display buffer.
+ *
+ * ************************************************************************** */
+
+void
+bound_free_line(int nphot)
+{
+  char row[DISPLAY_ROW_LEN];
 
-  get_element_name(phot_top[nphot].z, element);
-  wavelength = C_SI / phot_top[nphot].freq[0] / ANGSTROM / 1e-2;
-  display_add(" %-12.2f %-12s %-12i %-12i %-12i %-12i %-12i %-12i", wavelength, element, phot_top[nphot].z,
-              phot_top[nphot].istate, phot_top[nphot].n, phot_top[nphot].l,
-              ions[phot_top[nphot].nion].phot_info, 1 + NLINES + nphot);
+  format_bound_free_line(nphot, row, sizeof(row));
+  display_add("%s", row);
 }
 
 /* ************************************************************************** */
@@ -67,7 +93,6 @@ bound_free_line(int nphot)
 void
 all_bound_free(void)
 {
-  int n, nphot;
   double wmin, wmax;
 
   wmin = C_SI / phot_top_ptr[0]->freq[0] / ANGSTROM / 1e-2;
@@ -78,15 +103,9 @@ all_bound_free(void)
 
   bound_free_header();
 
-  n = 0;
+  display_add_rows(NULL, 0, nphot_total, format_bound_free_line);
 
-  for(nphot = 0; nphot < nphot_total; ++nphot)
-  {
-    n++;
-    bound_free_line(nphot);
-  }
-
-  count(ndash, n);
+  count(ndash, nphot_total);
 
   display_show(SCROLL_ENABLE, true, 4);
 }
@@ -98,9 +117,9 @@ all_bound_free(void)
  *
  * @details
  *
- * This function simply loops over the phot_top_prt (Topbase) and writes
- * to the screen whenever a threshold frequency for an edge falls
- * within the provided wavelength range.
+ * The edges with a threshold frequency in the provided wavelength range are
+ * found in phot_top_threshold by limit_edges, and written to the screen in
+ * frequency order.
  *
  * The wavelength range is queried within the function.
  *
@@ -109,8 +128,8 @@ all_bound_free(void)
 void
 bound_free_wavelength_range(void)
 {
-  int n, nphot;
-  double fmin, fmax, fthreshold;
+  int n, nfirst;
+  double fmin, fmax;
   double wmin, wmax;
 
   if(query_wavelength_range(&wmin, &wmax) == FORM_QUIT)
@@ -123,21 +142,64 @@ bound_free_wavelength_range(void)
   add_sep_display(ndash);
   bound_free_header();
 
-  n = 0;
+  n = limit_edges(phot_top_threshold, nphot_total, fmin, fmax, &nfirst);
+
+  display_add_rows(NULL, nfirst, n, format_bound_free_line);
 
-  for(nphot = 0; nphot < nphot_total; ++nphot)
+  count(ndash, n);
+
+  display_show(SCROLL_ENABLE, true, 4);
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Retrieve all of the photoionization edges which absorb over a given
+ *         wavelength range.
+ *
+ * @details
+ *
+ * Unlike bound_free_wavelength_range, this finds every edge with a cross section
+ * which overlaps the wavelength range, i.e. all of the edges which contribute
+ * to the continuum opacity over the range. The edges are found using the
+ * coverage tree phot_top_coverage and written to the screen in frequency order.
+ *
+ * The wavelength range is queried within the function.
+ *
+ * ************************************************************************** */
+
+void
+bound_free_coverage(void)
+{
+  int n;
+  int *edges;
+  double fmin, fmax;
+  double wmin, wmax;
+
+  if(query_wavelength_range(&wmin, &wmax) == FORM_QUIT)
+    return;
+
+  if((edges = malloc((nphot_total + 1) * sizeof(*edges))) == NULL)
   {
-    fthreshold = phot_top[nphot].freq[0];
-    if(fthreshold > fmin && fthreshold < fmax)
-    {
-      bound_free_line(nphot);
-      n++;
-    }
+    error_atomix("Unable to allocate memory for the photoionization edges");
+    return;
   }
 
+  fmax = C / (wmin * ANGSTROM);
+  fmin = C / (wmax * ANGSTROM);
+
+  display_add(" Edges absorbing over wavelength range: %.2f - %.2f Angstroms", wmin, wmax);
+  add_sep_display(ndash);
+  bound_free_header();
+
+  n = find_covering_edges(phot_top_threshold, phot_top_coverage, nphot_total, fmin, fmax, edges);
+
+  display_add_rows(edges, 0, n, format_bound_free_line);
+
   count(ndash, n);
 
   display_show(SCROLL_ENABLE, true, 4);
+
+  free(edges);
 }
 
 /* ************************************************************************** */
@@ -152,13 +214,14 @@ void
 bound_free_element(void)
 {
   int n, z;
-  int nphot;
+  int nelem;
+  int *entries;
   char element[LINELEN];
 
   if(query_atomic_number(&z) == FORM_QUIT)
     return;
 
-  if(find_element(z) == ELEMENT_NO_FOUND)
+  if((nelem = find_element(z)) == ELEMENT_NO_FOUND)
     return;
 
   get_element_name(z, element);
@@ -166,15 +229,8 @@ bound_free_element(void)
   add_sep_display(ndash);
   bound_free_header();
 
-  n = 0;
-  for(nphot = 0; nphot < nphot_total; ++nphot)
-  {
-    if(phot_top[nphot].z == z)
-    {
-      bound_free_line(nphot);
-      n++;
-    }
-  }
+  entries = get_element_postings(nelem, POSTING_PHOT_TOP, &n);
+  display_add_rows(entries, 0, n, format_bound_free_line);
 
   count(ndash, n);
 
@@ -193,7 +249,8 @@ void
 bound_free_ion(void)
 {
   int z, istate;
-  int n, nion, nphot;
+  int n, nion;
+  int *entries;
   char element[LINELEN];
 
   if(query_ion_input(TRUE, NULL, NULL, &nion) == FORM_QUIT)
@@ -216,18 +273,260 @@ bound_free_ion(void)
   add_sep_display(ndash);
   bound_free_header();
 
-  n = 0;
-  for(nphot = 0; nphot < nphot_total; ++nphot)
+  entries = get_ion_postings(nion, POSTING_PHOT_TOP, &n);
+  display_add_rows(entries, 0, n, format_bound_free_line);
+
+  count(ndash, n);
+
+  display_show(SCROLL_ENABLE, true, 4);
+
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Print the cross sections of the bound free edges of an ion over a
+ *         wavelength range.
+ *
+ * @details
+ *
+ * Each edge of the ion is evaluated on a grid of XSECTION_VIEW_NPOINTS
+ * wavelengths, evenly spaced in log wavelength over the range, using
+ * evaluate_xsection.
+ *
+ * The ion and the wavelength range are queried within the function.
+ *
+ * ************************************************************************** */
+
+void
+bound_free_evaluate(void)
+{
+  int i, k, n, nion;
+  int *entries;
+  double wmin, wmax;
+  double freq[XSECTION_VIEW_NPOINTS];
+  double sigma[XSECTION_VIEW_NPOINTS];
+  char element[LINELEN];
+
+  if(query_ion_input(TRUE, NULL, NULL, &nion) == FORM_QUIT)
+    return;
+
+  if(nion < 0)
+    nion *= -1;
+
+  if(nion > nions - 1)
+  {
+    error_atomix("Invaild ion number %i > nions %i", nion, nions);
+    return;
+  }
+
+  if(query_wavelength_range(&wmin, &wmax) == FORM_QUIT)
+    return;
+
+  /* The frequencies have to be in ascending order, so the grid starts at wmax */
+  for(k = 0; k < XSECTION_VIEW_NPOINTS; ++k)
+    freq[k] = C / (wmax * pow(wmin / wmax, k / (double) (XSECTION_VIEW_NPOINTS - 1)) * ANGSTROM);
+
+  get_element_name(ions[nion].z, element);
+  display_add("Bound-free cross sections for %s %i: %.2f - %.2f Angstroms", element, ions[nion].istate, wmin, wmax);
+  add_sep_display(ndash);
+  bound_free_header();
+
+  entries = get_ion_postings(nion, POSTING_PHOT_TOP, &n);
+
+  for(i = 0; i < n; ++i)
   {
-    if(phot_top[nphot].z == z && phot_top[nphot].istate == istate)
+    bound_free_line(entries[i]);
+    evaluate_xsection(phot_top_ptr[entries[i]], freq, XSECTION_VIEW_NPOINTS, sigma);
+    for(k = XSECTION_VIEW_NPOINTS - 1; k >= 0; --k)
+      display_add("   %-12.2f %-12.4e", C / freq[k] / ANGSTROM, sigma[k]);
+    add_sep_display(ndash);
+  }
+
+  display_add(" %i photoionization edges", n);
+
+  display_show(SCROLL_ENABLE, true, 4);
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Calculate the total bound-free cross section over a wavelength range
+ *         given by the user.
+ *
+ * @param[in]   npoints    The number of points in the grid
+ * @param[out]  freq       The frequency grid, in ascending order
+ * @param[out]  total      The total cross section on the grid
+ * @param[out]  wmin       The minimum wavelength
+ * @param[out]  wmax       The maximum wavelength
+ * @param[out]  fractions  The ion fractions file, or an empty string if the
+ *                         cross sections are not weighted
+ * @param[out]  time_ms    The time taken to calculate the total, in ms
+ * @param[out]  nthreads   The number of threads used
+ *
+ * @return  EXIT_SUCCESS, FORM_QUIT if the user quit or EXIT_FAILURE if the
+ *          total could not be calculated
+ *
+ * @details
+ *
+ * The wavelength range and the ion fractions file are queried within the
+ * function. The grid is evenly spaced in log wavelength.
+ *
+ * ************************************************************************** */
+
+static int
+calculate_bound_free_opacity(int npoints, double *freq, double *total, double *wmin, double *wmax, char *fractions,
+                             double *time_ms, int *nthreads)
+{
+  int k, status;
+  double *weights = NULL;
+  struct timespec start, end;
+
+  static char default_fractions[FIELD_INPUT_LEN] = "";
+
+  if(query_wavelength_range(wmin, wmax) == FORM_QUIT)
+    return FORM_QUIT;
+  if(query_file_path("Ion fractions file : ", "Input a file of ion fractions, or leave blank for no weighting",
+                     default_fractions) == FORM_QUIT)
+    return FORM_QUIT;
+
+  strcpy(fractions, default_fractions);
+
+  if(strlen(fractions) > 0)
+  {
+    if((weights = malloc(nions * sizeof(*weights))) == NULL)
     {
-      bound_free_line(nphot);
-      n++;
+      error_atomix("Unable to allocate memory for the ion fractions");
+      return EXIT_FAILURE;
+    }
+    if(read_ion_fractions(fractions, weights) < 0)
+    {
+      error_atomix("Unable to open ion fractions file %s", fractions);
+      free(weights);
+      return EXIT_FAILURE;
     }
   }
 
-  count(ndash, n);
+  /* The frequencies have to be in ascending order, so the grid starts at wmax */
+  for(k = 0; k < npoints; ++k)
+    freq[k] = C / (*wmax * pow(*wmin / *wmax, k / (double) (npoints - 1)) * ANGSTROM);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  status = total_bf_opacity(freq, npoints, weights, total, nthreads);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  *time_ms = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+
+  free(weights);
+
+  if(status)
+  {
+    error_atomix("Unable to calculate the total bound-free cross section");
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Print the total bound-free cross section over a wavelength range.
+ *
+ * @details
+ *
+ * The total is the sum of the photoionization and inner shell cross sections
+ * of every edge, optionally weighted by ion fractions read from a file. Each
+ * line of the file is the atomic number, ionisation state and fraction of an
+ * ion, and ions not in the file are ignored.
+ *
+ * ************************************************************************** */
+
+void
+bound_free_opacity(void)
+{
+  int k, nthreads;
+  double wmin, wmax, time_ms;
+  double freq[OPACITY_VIEW_NPOINTS];
+  double total[OPACITY_VIEW_NPOINTS];
+  char fractions[FIELD_INPUT_LEN];
+
+  if(calculate_bound_free_opacity(OPACITY_VIEW_NPOINTS, freq, total, &wmin, &wmax, fractions, &time_ms, &nthreads))
+    return;
+
+  display_add(" Total bound-free cross section: %.2f - %.2f Angstroms", wmin, wmax);
+  add_sep_display(ndash);
+  display_add(" %-12s %-12s %-12s", "Wavelength", "Frequency", "Sigma");
+  add_sep_display(ndash);
+
+  for(k = OPACITY_VIEW_NPOINTS - 1; k >= 0; --k)
+    display_add(" %-12.2f %-12.4e %-12.4e", C / freq[k] / ANGSTROM, freq[k], total[k]);
+
+  add_sep_display(ndash);
+  if(strlen(fractions) > 0)
+    display_add(" Weighted by the ion fractions in %s", fractions);
+  display_add(" %i points calculated in %.2f ms using %i threads", OPACITY_VIEW_NPOINTS, time_ms, nthreads);
 
   display_show(SCROLL_ENABLE, true, 4);
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Write the total bound-free cross section over a wavelength range to
+ *         a file.
+ *
+ * @details
+ *
+ * This is the same as bound_free_opacity, but on a finer grid which is written
+ * to a file given by the user. Each line of the file is the wavelength,
+ * frequency and total cross section of a point, in ascending wavelength.
+ *
+ * ************************************************************************** */
+
+void
+bound_free_opacity_export(void)
+{
+  int k, nthreads;
+  double wmin, wmax, time_ms;
+  double *freq, *total;
+  char fractions[FIELD_INPUT_LEN];
+  FILE *fptr;
+
+  static char output[FIELD_INPUT_LEN] = "opacity.txt";
+
+  freq = malloc(OPACITY_EXPORT_NPOINTS * sizeof(*freq));
+  total = malloc(OPACITY_EXPORT_NPOINTS * sizeof(*total));
+  if(freq == NULL || total == NULL)
+  {
+    error_atomix("Unable to allocate memory for the total bound-free cross section");
+    free(freq);
+    free(total);
+    return;
+  }
+
+  if(calculate_bound_free_opacity(OPACITY_EXPORT_NPOINTS, freq, total, &wmin, &wmax, fractions, &time_ms, &nthreads)
+     || query_file_path("Output file : ", "Input the file to write the total cross section to", output) == FORM_QUIT)
+    goto cleanup;
+
+  if(strlen(output) == 0 || (fptr = fopen(output, "w")) == NULL)
+  {
+    error_atomix("Unable to open output file %s", output);
+    goto cleanup;
+  }
 
+  fprintf(fptr, "# Total bound-free cross section: %.2f - %.2f Angstroms\n", wmin, wmax);
+  if(strlen(fractions) > 0)
+    fprintf(fptr, "# Weighted by the ion fractions in %s\n", fractions);
+  fprintf(fptr, "# %-12s %-14s %-14s\n", "Wavelength", "Frequency", "Sigma");
+  for(k = OPACITY_EXPORT_NPOINTS - 1; k >= 0; --k)
+    fprintf(fptr, "%-14.6e %-14.6e %-14.6e\n", C / freq[k] / ANGSTROM, freq[k], total[k]);
+  fclose(fptr);
+
+  display_add(" Total bound-free cross section: %.2f - %.2f Angstroms", wmin, wmax);
+  if(strlen(fractions) > 0)
+    display_add(" Weighted by the ion fractions in %s", fractions);
+  display_add(" Calculated in %.2f ms using %i threads", time_ms, nthreads);
+  display_add(" Wrote %i points to %s", OPACITY_EXPORT_NPOINTS, output);
+
+  display_show(SCROLL_ENABLE, false, 0);
+
+cleanup:
+  free(freq);
+  free(total);
 }
@@ -0,0 +1,223 @@
+/* ************************************************************************** */
+/**
+ * @file     postings.c
+ *
+ * @brief
+ *
+ * Functions for finding the lines and edges which belong to an ion or element.
+ *
+ * @details
+ *
+ * The views for a single ion or element used to look at every line and every
+ * cross section to find the ones for that ion or element. Instead, once the
+ * atomic data is in frequency order, a list of the lines, photoionization
+ * edges and inner shell edges of each ion and each element is made. These
+ * lists are known as postings. Each entry is the position of a line or edge
+ * in its frequency ordered list, i.e. lin_ptr, phot_top_ptr or inner_cross_ptr,
+ * so the entries in a list are also in frequency order.
+ *
+ * All of the entries are kept in a single table, postings, and ion_postings
+ * and element_postings give where the entries for each ion and element are.
+ *
+ * ************************************************************************** */
+
+#include <string.h>
+
+#include "atomix.h"
+
+/* ************************************************************************** */
+/**
+ * @brief  Get the number of entries in a frequency ordered list
+ *
+ * @param[in]  type  The list
+ *
+ * @return  The number of entries in the list
+ *
+ * ************************************************************************** */
+
+static int
+count_entries(PostingType_t type)
+{
+  switch(type)
+  {
+  case POSTING_LINES:
+    return nlines;
+  case POSTING_PHOT_TOP:
+    return nphot_total;
+  case POSTING_INNER_CROSS:
+    return n_inner_tot;
+  default:
+    return 0;
+  }
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Get the ion of an entry in a frequency ordered list
+ *
+ * @param[in]  type  The list
+ * @param[in]  n     The position of the entry in the list
+ *
+ * @return  The ion number of the entry, or -1 if it doesn't belong to an ion
+ *
+ * ************************************************************************** */
+
+static int
+entry_nion(PostingType_t type, int n)
+{
+  int nion;
+
+  switch(type)
+  {
+  case POSTING_LINES:
+    nion = line_columns.nion[n];
+    break;
+  case POSTING_PHOT_TOP:
+    nion = phot_top_ptr[n]->nion;
+    break;
+  case POSTING_INNER_CROSS:
+    nion = inner_cross_ptr[n]->nion;
+    break;
+  default:
+    nion = -1;
+    break;
+  }
+
+  return nion >= 0 && nion < nions ? nion : -1;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Get the size of the postings
+ *
+ * @return  The number of entries in postings
+ *
+ * @details
+ *
+ * Each line and edge has an entry for its ion and one for its element.
+ *
+ * ************************************************************************** */
+
+int
+count_postings(void)
+{
+  return 2 * (nlines + nphot_total + n_inner_tot) + 1;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Make the postings for every ion and element
+ *
+ * @return  0 on success, or ATOMIC_MEMORY_ISSUE_ERROR if the postings could
+ *          not be allocated
+ *
+ * @details
+ *
+ * This has to be called whenever the order of the atomic data is set, i.e.
+ * after the lines and cross sections are indexed. The postings are saved in
+ * the snapshot in the cache, so are not made again when the atomic data is
+ * read from there. The entries are counted for each ion and element, then
+ * put into place with a second pass through each frequency ordered list.
+ *
+ * ************************************************************************** */
+
+int
+index_postings(void)
+{
+  int n, nion, nelem;
+  int type;
+  int first;
+
+  if(reserve_atomic_table(TABLE_ION_POSTINGS, nions) || reserve_atomic_table(TABLE_ELEMENT_POSTINGS, nelements)
+     || reserve_atomic_table(TABLE_POSTINGS, count_postings()))
+    return ATOMIC_MEMORY_ISSUE_ERROR;
+
+  memset(ion_postings, 0, nions * sizeof(*ion_postings));
+  memset(element_postings, 0, nelements * sizeof(*element_postings));
+
+  for(type = 0; type < NPOSTING_TYPES; type++)
+  {
+    for(n = 0; n < count_entries(type); n++)
+    {
+      if((nion = entry_nion(type, n)) < 0)
+        continue;
+      ion_postings[nion].n[type]++;
+      if((nelem = ions[nion].nelem) >= 0 && nelem < nelements)
+        element_postings[nelem].n[type]++;
+    }
+  }
+
+  first = 0;
+  for(nion = 0; nion < nions; nion++)
+  {
+    for(type = 0; type < NPOSTING_TYPES; type++)
+    {
+      ion_postings[nion].first[type] = first;
+      first += ion_postings[nion].n[type];
+      ion_postings[nion].n[type] = 0;
+    }
+  }
+  for(nelem = 0; nelem < nelements; nelem++)
+  {
+    for(type = 0; type < NPOSTING_TYPES; type++)
+    {
+      element_postings[nelem].first[type] = first;
+      first += element_postings[nelem].n[type];
+      element_postings[nelem].n[type] = 0;
+    }
+  }
+
+  for(type = 0; type < NPOSTING_TYPES; type++)
+  {
+    for(n = 0; n < count_entries(type); n++)
+    {
+      if((nion = entry_nion(type, n)) < 0)
+        continue;
+      postings[ion_postings[nion].first[type] + ion_postings[nion].n[type]++] = n;
+      if((nelem = ions[nion].nelem) >= 0 && nelem < nelements)
+        postings[element_postings[nelem].first[type] + element_postings[nelem].n[type]++] = n;
+    }
+  }
+
+  return 0;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Get the lines or edges which belong to an ion
+ *
+ * @param[in]   nion  The ion number
+ * @param[in]   type  The type of the entries
+ * @param[out]  n     The number of entries
+ *
+ * @return  The entries, which are positions in the frequency ordered list
+ *
+ * ************************************************************************** */
+
+int *
+get_ion_postings(int nion, PostingType_t type, int *n)
+{
+  *n = ion_postings[nion].n[type];
+
+  return postings + ion_postings[nion].first[type];
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Get the lines or edges which belong to an element
+ *
+ * @param[in]   nelem  The element number
+ * @param[in]   type   The type of the entries
+ * @param[out]  n      The number of entries
+ *
+ * @return  The entries, which are positions in the frequency ordered list
+ *
+ * ************************************************************************** */
+
+int *
+get_element_postings(int nelem, PostingType_t type, int *n)
+{
+  *n = element_postings[nelem].n[type];
+
+  return postings + element_postings[nelem].first[type];
+}
@@ -379,6 +379,122 @@ query_wavelength_range(double *wmin, double *wmax)
   return EXIT_SUCCESS;
 }
 
+/* ************************************************************************** */
+/**
+ * @brief  Query a temperature range from the user.
+ *
+ * @param[out]  tmin  The minimum temperature
+ * @param[out]  tmax  The maximum temperature
+ *
+ * @details
+ *
+ * Continues to loop until valid input is received or until a user quits. The
+ * range defaults to 1e3 - 1e8 K.
+ *
+ * ************************************************************************** */
+
+int
+query_temperature_range(double *tmin, double *tmax)
+{
+  int form_return;
+  int valid_input = false;
+  WINDOW *window = CONTENT_VIEW_WINDOW.window;
+
+  static int init_default = false;
+  static char string_tmin[FIELD_INPUT_LEN];
+  static char string_tmax[FIELD_INPUT_LEN];
+  static Query_t temperature_query[5];
+
+  if(init_default == false)
+  {
+    strcpy(string_tmin, "1e3");
+    strcpy(string_tmax, "1e8");
+    init_default = true;
+  }
+
+  while(valid_input == false)
+  {
+    wclear(window);
+    init_two_question_form(temperature_query, "Minimum Temperature : ", "Maximum Temperature : ", string_tmin,
+                           string_tmax);
+    form_return = query_user(CONTENT_VIEW_WINDOW, temperature_query, 4, "Input the temperature range");
+
+    if(form_return == FORM_QUIT)
+      return form_return;
+
+    *tmin = strtod(temperature_query[1].buffer, NULL);
+    *tmax = strtod(temperature_query[3].buffer, NULL);
+    strcpy(string_tmin, temperature_query[1].buffer);
+    strcpy(string_tmax, temperature_query[3].buffer);
+
+    if(*tmin > 0 && *tmax > *tmin)
+    {
+      valid_input = true;
+    }
+    else
+    {
+      update_status_bar("Invalid input for temperature range %g - %g (minimum - maximum)", *tmin, *tmax);
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Query a temperature from the user.
+ *
+ * @param[out]  t  The temperature
+ *
+ * @details
+ *
+ * Continues to loop until valid input is received or until a user quits. The
+ * temperature defaults to 1e4 K.
+ *
+ * ************************************************************************** */
+
+int
+query_temperature(double *t)
+{
+  int form_return;
+  int valid_input = false;
+  WINDOW *window = CONTENT_VIEW_WINDOW.window;
+
+  static int init_default = false;
+  static char string_t[FIELD_INPUT_LEN];
+  static Query_t temperature_query[2];
+
+  if(init_default == false)
+  {
+    strcpy(string_t, "1e4");
+    init_default = true;
+  }
+
+  while(valid_input == false)
+  {
+    wclear(window);
+    init_single_question_form(temperature_query, "Temperature : ", string_t);
+    form_return = query_user(CONTENT_VIEW_WINDOW, temperature_query, 2, "Input the temperature");
+
+    if(form_return == FORM_QUIT)
+      return form_return;
+
+    *t = strtod(temperature_query[1].buffer, NULL);
+    strcpy(string_t, temperature_query[1].buffer);
+
+    if(*t > 0)
+    {
+      valid_input = true;
+    }
+    else
+    {
+      update_status_bar("Invalid input for temperature %g", *t);
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
 /* ************************************************************************** */
 /**
  * @brief  Query an atomic number from the user.
@@ -439,6 +555,39 @@ query_atomic_number(int *z)
   return EXIT_SUCCESS;
 }
 
+/* ************************************************************************** */
+/**
+ * @brief  Query a file path from the user.
+ *
+ * @param[in]      label    The question to ask for the field
+ * @param[in]      message  The title message for the form
+ * @param[in, out] path     The default path on input, and the path given by
+ *                          the user on output, FIELD_INPUT_LEN long
+ *
+ * @details
+ *
+ * The path is not checked, and can be empty.
+ *
+ * ************************************************************************** */
+
+int
+query_file_path(char *label, char *message, char *path)
+{
+  int form_return;
+  Query_t path_query[2];
+
+  wclear(CONTENT_VIEW_WINDOW.window);
+  init_single_question_form(path_query, label, path);
+  form_return = query_user(CONTENT_VIEW_WINDOW, path_query, 2, message);
+
+  if(form_return == FORM_QUIT)
+    return form_return;
+
+  strcpy(path, path_query[1].buffer);
+
+  return EXIT_SUCCESS;
+}
+
 /* ************************************************************************** */
 /**
  * @brief  Query the user for atomic number and ionisation state or an ion
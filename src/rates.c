@@ -0,0 +1,377 @@
+/* ************************************************************************** */
+/**
+ * @file     rates.c
+ *
+ * @brief
+ *
+ * Functions for calculating the recombination and ionization rate
+ * coefficients of the ions over a grid of temperatures.
+ *
+ * @details
+ *
+ * These are the same as the dielectronic recombination, total and
+ * ground state radiative recombination and Dere direct ionization rates in
+ * Python. Ions without data for a rate are given a rate of zero, as they are
+ * in Python.
+ *
+ * All of the ions are done in one pass over the tables of rate data. The parts
+ * of each fit which only depend on the temperature are worked out once for the
+ * whole grid, and then each fit is done as a loop over the temperatures. The
+ * tabulated rates are interpolated starting each search from the points found
+ * for the previous temperature.
+ *
+ * ************************************************************************** */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "atomix.h"
+
+#define EULER_GAMMA 0.5772156649015329
+#define E1_MAX_ITERATIONS 100
+#define E1_EPSILON 1.0e-16
+#define E1_TINY 1.0e-300
+
+typedef struct RateGrid_t
+{
+  double *temp;
+  int ntemp;
+  double *inv_temp;             /* 1 / T */
+  double *temp_1_5;             /* T^-1.5 */
+  double *sqrt_temp;            /* sqrt(T) */
+} RateGrid_t;
+
+/* ************************************************************************** */
+/**
+ * @brief  Calculate the exponential integral E1(x)
+ *
+ * @param[in]  x  The argument, which must be > 0
+ *
+ * @return  E1(x)
+ *
+ * @details
+ *
+ * This uses the power series for x <= 1 and a continued fraction otherwise,
+ * as in Numerical Recipes. It replaces gsl_sf_expint_E1, which is used in
+ * Python.
+ *
+ * ************************************************************************** */
+
+static double
+expint_e1(double x)
+{
+  int i;
+  double a, b, c, d, h, delta, fact, sum;
+
+  if(x <= 0)
+    return 0;
+
+  if(x > 1)
+  {
+    b = x + 1;
+    c = 1 / E1_TINY;
+    d = 1 / b;
+    h = d;
+    for(i = 1; i <= E1_MAX_ITERATIONS; i++)
+    {
+      a = -(double) i * i;
+      b += 2;
+      d = 1 / (a * d + b);
+      c = b + a / c;
+      delta = c * d;
+      h *= delta;
+      if(fabs(delta - 1) < E1_EPSILON)
+        break;
+    }
+    return h * exp(-x);
+  }
+
+  sum = -log(x) - EULER_GAMMA;
+  fact = 1;
+  for(i = 1; i <= E1_MAX_ITERATIONS; i++)
+  {
+    fact *= -x / i;
+    delta = -fact / i;
+    sum += delta;
+    if(fabs(delta) < fabs(sum) * E1_EPSILON)
+      break;
+  }
+
+  return sum;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Calculate the dielectronic recombination rates
+ *
+ * @param[in]   grid  The temperatures
+ * @param[out]  dr    The rate of each ion at each temperature
+ *
+ * @details
+ *
+ * The Badnell fits are T^-1.5 sum c_i exp(-e_i / T) and the Shull & van
+ * Steenberg (1982) fits are A T^-1.5 exp(-T0 / T) (1 + B exp(-T1 / T)).
+ *
+ * ************************************************************************** */
+
+static void
+dr_rates(RateGrid_t *grid, double *dr)
+{
+  int i, k, n;
+  double *rate;
+  Drecombptr d;
+
+  for(n = 0; n < ndrecomb; n++)
+  {
+    d = &drecomb[n];
+    if(d->nion < 0 || d->nion >= nions)
+      continue;
+    rate = &dr[d->nion * grid->ntemp];
+
+    if(d->type == DRTYPE_BADNELL)
+    {
+      for(i = 0; i < d->nparam; i++)
+        for(k = 0; k < grid->ntemp; k++)
+          rate[k] += d->c[i] * exp(-d->e[i] * grid->inv_temp[k]);
+      for(k = 0; k < grid->ntemp; k++)
+        rate[k] *= grid->temp_1_5[k];
+    }
+    else if(d->type == DRTYPE_SHULL)
+    {
+      for(k = 0; k < grid->ntemp; k++)
+        rate[k] = d->shull[0] * grid->temp_1_5[k] * exp(-d->shull[2] * grid->inv_temp[k])
+          * (1 + d->shull[1] * exp(-d->shull[3] * grid->inv_temp[k]));
+    }
+  }
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Calculate the total radiative recombination rates
+ *
+ * @param[in]   grid  The temperatures
+ * @param[out]  rr    The rate of each ion at each temperature
+ *
+ * @details
+ *
+ * The Badnell fits are from Verner & Ferland (1996), or Gu (2003) when C is
+ * given, and the "Shull" fits are A (T / 1e4)^-eta from Aldrovandi & Pequignot
+ * (1973).
+ *
+ * ************************************************************************** */
+
+static void
+rr_rates(RateGrid_t *grid, double *rr)
+{
+  int k, n;
+  double a, b, c, t2, sqrt_t0, sqrt_t1, beta;
+  double *rate;
+  total_rrptr r;
+
+  for(n = 0; n < n_total_rr; n++)
+  {
+    r = &total_rr[n];
+    if(r->nion < 0 || r->nion >= nions)
+      continue;
+    rate = &rr[r->nion * grid->ntemp];
+
+    if(r->type == RRTYPE_BADNELL)
+    {
+      a = r->params[0];
+      b = r->params[1];
+      sqrt_t0 = sqrt(r->params[2]);
+      sqrt_t1 = sqrt(r->params[3]);
+      c = r->params[4];
+      t2 = r->params[5];
+      for(k = 0; k < grid->ntemp; k++)
+      {
+        beta = b + c * exp(-t2 * grid->inv_temp[k]);
+        rate[k] = a / ((grid->sqrt_temp[k] / sqrt_t0) * pow(1 + grid->sqrt_temp[k] / sqrt_t0, 1 - beta)
+                       * pow(1 + grid->sqrt_temp[k] / sqrt_t1, 1 + beta));
+      }
+    }
+    else if(r->type == RRTYPE_SHULL)
+    {
+      for(k = 0; k < grid->ntemp; k++)
+        rate[k] = r->params[0] * pow(grid->temp[k] / 1e4, -r->params[1]);
+    }
+  }
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Calculate the ground state radiative recombination rates
+ *
+ * @param[in]   grid   The temperatures
+ * @param[out]  gs_rr  The rate of each ion at each temperature
+ *
+ * @details
+ *
+ * The Badnell rates are tabulated in temperature and are linearly
+ * interpolated, using the rate at the end of the table for temperatures
+ * outside of it. Ions which only have one of the temperature or rate lines are
+ * skipped.
+ *
+ * ************************************************************************** */
+
+static void
+gs_rr_rates(RateGrid_t *grid, double *gs_rr)
+{
+  int k, n, cursor;
+  double *rate;
+  Bad_gs_rrptr g;
+
+  for(n = 0; n < n_bad_gs_rr; n++)
+  {
+    g = &bad_gs_rr[n];
+    if(g->nion < 0 || g->nion >= nions || !ions[g->nion].bad_gs_rr_t_flag || !ions[g->nion].bad_gs_rr_r_flag)
+      continue;
+    rate = &gs_rr[g->nion * grid->ntemp];
+
+    cursor = -1;
+    for(k = 0; k < grid->ntemp; k++)
+      linterp_cursor(grid->temp[k], g->temps, g->rates, BAD_GS_RR_PARAMS, &rate[k], 0, &cursor);
+  }
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Calculate the Dere (2007) direct ionization rates
+ *
+ * @param[in]   grid  The temperatures
+ * @param[out]  di    The rate of each ion at each temperature
+ * @param[out]  work  Working space for two values at each temperature
+ *
+ * @details
+ *
+ * The rate is t^-0.5 I^-1.5 R(x) E1(1 / t), where t = kT / I, I is the
+ * ionization energy in eV and R is the scaled rate, which is tabulated in the
+ * scaled temperature x = 1 - ln 2 / ln(2 + t). Below the table the rate is
+ * zero, and above it R is extrapolated from the last two points.
+ *
+ * ************************************************************************** */
+
+static void
+di_rates(RateGrid_t *grid, double *di, double *work)
+{
+  int k, n, np, cursor;
+  double xi_ergs, slope;
+  double *rate;
+  double *t = work;
+  double *x = work + grid->ntemp;
+  Dere_di_rateptr d;
+
+  for(n = 0; n < n_dere_di_rate; n++)
+  {
+    d = &dere_di_rate[n];
+    np = d->nspline;
+    if(d->nion < 0 || d->nion >= nions || np < 2 || np > DERE_DI_PARAMS)
+      continue;
+    rate = &di[d->nion * grid->ntemp];
+
+    xi_ergs = d->xi * EV2ERGS;
+    for(k = 0; k < grid->ntemp; k++)
+    {
+      t[k] = BOLTZMANN * grid->temp[k] / xi_ergs;
+      x[k] = 1 - log(2) / log(2 + t[k]);
+    }
+
+    slope = (d->rates[np - 1] - d->rates[np - 2]) / (d->temps[np - 1] - d->temps[np - 2]);
+    cursor = -1;
+    for(k = 0; k < grid->ntemp; k++)
+    {
+      if(x[k] < d->temps[0])
+        rate[k] = 0;
+      else if(x[k] > d->temps[np - 1])
+        rate[k] = d->rates[np - 1] + slope * (x[k] - d->temps[np - 1]);
+      else
+        linterp_cursor(x[k], d->temps, d->rates, np, &rate[k], 0, &cursor);
+    }
+
+    for(k = 0; k < grid->ntemp; k++)
+      if(rate[k] != 0)
+        rate[k] *= pow(t[k], -0.5) * pow(d->xi, -1.5) * expint_e1(1 / t[k]);
+  }
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Calculate the recombination and ionization rate coefficients of
+ *         every ion over a grid of temperatures
+ *
+ * @param[in]   temp   The temperatures
+ * @param[in]   ntemp  The number of temperatures
+ * @param[out]  dr     The dielectronic recombination rates, or NULL
+ * @param[out]  rr     The total radiative recombination rates, or NULL
+ * @param[out]  gs_rr  The ground state radiative recombination rates, or NULL
+ * @param[out]  di     The direct ionization rates, or NULL
+ *
+ * @return  0 on success, -1 if a temperature is not positive, or
+ *          ATOMIC_MEMORY_ISSUE_ERROR if there was not enough memory
+ *
+ * @details
+ *
+ * Each of the rates has nions * ntemp entries, where the rate of ion nion at
+ * temp[k] is at nion * ntemp + k. The rates are in cm^3 s^-1, and are zero
+ * for ions without data for the rate. The temperatures do not need to be in
+ * order, but the interpolation of the tabulated rates is quickest when they
+ * are.
+ *
+ * ************************************************************************** */
+
+int
+evaluate_ion_rates(double *temp, int ntemp, double *dr, double *rr, double *gs_rr, double *di)
+{
+  int k;
+  double *work;
+  RateGrid_t grid;
+
+  for(k = 0; k < ntemp; k++)
+    if(!(temp[k] > 0))
+      return -1;
+
+  if(ntemp < 1)
+    return 0;
+
+  if((work = malloc(5 * ntemp * sizeof(*work))) == NULL)
+    return ATOMIC_MEMORY_ISSUE_ERROR;
+
+  grid.temp = temp;
+  grid.ntemp = ntemp;
+  grid.inv_temp = work;
+  grid.temp_1_5 = work + ntemp;
+  grid.sqrt_temp = work + 2 * ntemp;
+
+  for(k = 0; k < ntemp; k++)
+  {
+    grid.inv_temp[k] = 1 / temp[k];
+    grid.sqrt_temp[k] = sqrt(temp[k]);
+    grid.temp_1_5[k] = grid.inv_temp[k] / grid.sqrt_temp[k];
+  }
+
+  if(dr)
+  {
+    memset(dr, 0, nions * ntemp * sizeof(*dr));
+    dr_rates(&grid, dr);
+  }
+  if(rr)
+  {
+    memset(rr, 0, nions * ntemp * sizeof(*rr));
+    rr_rates(&grid, rr);
+  }
+  if(gs_rr)
+  {
+    memset(gs_rr, 0, nions * ntemp * sizeof(*gs_rr));
+    gs_rr_rates(&grid, gs_rr);
+  }
+  if(di)
+  {
+    memset(di, 0, nions * ntemp * sizeof(*di));
+    di_rates(&grid, di, work + 3 * ntemp);
+  }
+
+  free(work);
+
+  return 0;
+}
@@ -0,0 +1,247 @@
+/* ************************************************************************** */
+/**
+ * @file     sort.c
+ *
+ * @brief
+ *
+ * A parallel, stable sort for putting the atomic data into frequency order.
+ *
+ * @details
+ *
+ * The lines and cross sections used to be sorted by copying their frequencies
+ * into an array of floats and using the Numerical Recipes heapsort, indexx.
+ * Lines which are closer together than the precision of a float ended up in
+ * an arbitrary order, as the heapsort is not stable.
+ *
+ * The entries to sort are now described by a SortKey_t, which keeps the full
+ * double precision frequency and the element, ion and levels of the entry to
+ * break any ties. Every key is different, so the order is always the same.
+ * The keys are split between worker threads which each merge sort their part,
+ * and the sorted parts are then merged together, also in parallel.
+ *
+ * ************************************************************************** */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "atomix.h"
+
+#define SORT_MIN_PER_THREAD 4096
+#define SORT_INSERTION_LENGTH 32
+
+typedef struct SortTask_t
+{
+  SortKey_t *keys;
+  SortKey_t *tmp;
+  int lo, mid, hi;              /* The range to sort, or to merge if mid is not -1 */
+} SortTask_t;
+
+/* ************************************************************************** */
+/**
+ * @brief  Compare two sort keys
+ *
+ * @param[in]  a  The first key
+ * @param[in]  b  The second key
+ *
+ * @return  A negative number if a comes before b, otherwise a positive number
+ *
+ * @details
+ *
+ * Keys are ordered by frequency, then by (z, istate, lower, upper) and then by
+ * their position in their table, so two keys are never equal.
+ *
+ * ************************************************************************** */
+
+static int
+compare_keys(const SortKey_t *a, const SortKey_t *b)
+{
+  if(a->freq != b->freq)
+    return a->freq < b->freq ? -1 : 1;
+  if(a->z != b->z)
+    return a->z - b->z;
+  if(a->istate != b->istate)
+    return a->istate - b->istate;
+  if(a->lower != b->lower)
+    return a->lower - b->lower;
+  if(a->upper != b->upper)
+    return a->upper - b->upper;
+
+  return a->id - b->id;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Merge two sorted, adjacent, ranges of keys
+ *
+ * @param[in]   src  The keys to merge
+ * @param[out]  dst  Where the merged keys are written
+ * @param[in]   lo   The start of the first range
+ * @param[in]   mid  The start of the second range
+ * @param[in]   hi   The end of the second range
+ *
+ * ************************************************************************** */
+
+static void
+merge_keys(SortKey_t *src, SortKey_t *dst, int lo, int mid, int hi)
+{
+  int i = lo;
+  int j = mid;
+  int k = lo;
+
+  while(i < mid && j < hi)
+    dst[k++] = compare_keys(&src[j], &src[i]) < 0 ? src[j++] : src[i++];
+  while(i < mid)
+    dst[k++] = src[i++];
+  while(j < hi)
+    dst[k++] = src[j++];
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Merge sort a range of keys
+ *
+ * @param[in, out]  keys  The keys
+ * @param[in]       tmp   Working space, the same size as keys
+ * @param[in]       lo    The start of the range
+ * @param[in]       hi    The end of the range
+ *
+ * @details
+ *
+ * Short runs are sorted by insertion, and then merged together until the
+ * whole range is sorted.
+ *
+ * ************************************************************************** */
+
+static void
+sort_key_range(SortKey_t *keys, SortKey_t *tmp, int lo, int hi)
+{
+  int i, j;
+  int width, start;
+  SortKey_t key;
+  SortKey_t *src = keys;
+  SortKey_t *dst = tmp;
+  SortKey_t *swap;
+
+  for(start = lo; start < hi; start += SORT_INSERTION_LENGTH)
+  {
+    for(i = start + 1; i < hi && i < start + SORT_INSERTION_LENGTH; i++)
+    {
+      key = keys[i];
+      for(j = i; j > start && compare_keys(&key, &keys[j - 1]) < 0; j--)
+        keys[j] = keys[j - 1];
+      keys[j] = key;
+    }
+  }
+
+  for(width = SORT_INSERTION_LENGTH; width < hi - lo; width *= 2)
+  {
+    for(start = lo; start < hi; start += 2 * width)
+    {
+      if(start + width >= hi)
+        memcpy(&dst[start], &src[start], (hi - start) * sizeof(*src));
+      else
+        merge_keys(src, dst, start, start + width, start + 2 * width < hi ? start + 2 * width : hi);
+    }
+    swap = src;
+    src = dst;
+    dst = swap;
+  }
+
+  if(src != keys)
+    memcpy(&keys[lo], &src[lo], (hi - lo) * sizeof(*keys));
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Sort or merge the range of keys given by a task
+ *
+ * @param[in]  arg  The task
+ *
+ * @return  NULL
+ *
+ * ************************************************************************** */
+
+static void *
+run_sort_task(void *arg)
+{
+  SortTask_t *task = arg;
+
+  if(task->mid < 0)
+  {
+    sort_key_range(task->keys, task->tmp, task->lo, task->hi);
+  }
+  else
+  {
+    merge_keys(task->keys, task->tmp, task->lo, task->mid, task->hi);
+    memcpy(&task->keys[task->lo], &task->tmp[task->lo], (task->hi - task->lo) * sizeof(*task->keys));
+  }
+
+  return NULL;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Sort keys into frequency order
+ *
+ * @param[in, out]  keys  The keys to sort
+ * @param[in]       n     The number of keys
+ *
+ * @return  0 on success, or ATOMIC_MEMORY_ISSUE_ERROR if there was not enough
+ *          memory
+ *
+ * @details
+ *
+ * The keys are split into one part for each thread, which are sorted at the
+ * same time. Neighbouring parts are then merged, with each merge done by its
+ * own thread, until there is only one part left.
+ *
+ * ************************************************************************** */
+
+int
+sort_by_frequency(SortKey_t *keys, int n)
+{
+  int i;
+  int nparts, ntasks, width;
+  int bounds[PARALLEL_MAX_THREADS + 1];
+  SortKey_t *tmp;
+  SortTask_t tasks[PARALLEL_MAX_THREADS];
+
+  if(n < 2)
+    return 0;
+  if((tmp = malloc(n * sizeof(*tmp))) == NULL)
+    return ATOMIC_MEMORY_ISSUE_ERROR;
+
+  nparts = count_parallel_chunks(n, SORT_MIN_PER_THREAD);
+
+  for(i = 0; i <= nparts; i++)
+    bounds[i] = (int) ((long) n * i / nparts);
+
+  for(i = 0; i < nparts; i++)
+  {
+    tasks[i].keys = keys;
+    tasks[i].tmp = tmp;
+    tasks[i].lo = bounds[i];
+    tasks[i].mid = -1;
+    tasks[i].hi = bounds[i + 1];
+  }
+  run_parallel_tasks(run_sort_task, tasks, sizeof(*tasks), nparts);
+
+  for(width = 1; width < nparts; width *= 2)
+  {
+    ntasks = 0;
+    for(i = 0; i + width < nparts; i += 2 * width)
+    {
+      tasks[ntasks].keys = keys;
+      tasks[ntasks].tmp = tmp;
+      tasks[ntasks].lo = bounds[i];
+      tasks[ntasks].mid = bounds[i + width];
+      tasks[ntasks].hi = bounds[i + 2 * width < nparts ? i + 2 * width : nparts];
+      ntasks++;
+    }
+    run_parallel_tasks(run_sort_task, tasks, sizeof(*tasks), ntasks);
+  }
+
+  free(tmp);
+
+  return 0;
+}
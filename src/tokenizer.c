@@ -0,0 +1,383 @@
+/* ************************************************************************** */
+/**
+ * @file     tokenizer.c
+ *
+ * @brief
+ *
+ * A small tokenizer and number parser for the records in the atomic data.
+ *
+ * @details
+ *
+ * Most of the time taken to read in the atomic data used to be spent in sscanf,
+ * which is slow as it has to interpret the format string and deal with the
+ * locale for every number it reads. The functions in here read the words and
+ * numbers in a record directly from the record, without allocating any memory.
+ *
+ * scan_atomic_record is a replacement for sscanf for the records in the atomic
+ * data, which understands the subset of the format string used by
+ * get_atomic_data. It returns exactly what sscanf would, so it can be used in
+ * place of sscanf without changing how a record is checked.
+ *
+ * ************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <ctype.h>
+
+#include "atomix.h"
+
+#define MAX_FAST_DIGITS 19
+#define MAX_FAST_MANTISSA (1ULL << 53)
+#define MAX_FAST_EXPONENT 22
+
+static const double POWERS_OF_TEN[MAX_FAST_EXPONENT + 1] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/* ************************************************************************** */
+/**
+ * @brief  Convert a string into a double
+ *
+ * @param[in]   str  The string to convert
+ * @param[out]  end  The character after the number which was converted
+ *
+ * @return  The value of the number
+ *
+ * @details
+ *
+ * This is a replacement for strtod. Numbers with no more than 19 significant
+ * digits, whose mantissa fits exactly into a double and whose exponent is
+ * small enough for the power of ten to be exact, are converted with a single
+ * multiplication or division. The result is correctly rounded, and therefore
+ * exactly the same as strtod. This covers almost every number in the atomic
+ * data, and anything else is passed to strtod.
+ *
+ * ************************************************************************** */
+
+double
+fast_strtod(char *str, char **end)
+{
+  char *c = str;
+  int negative = FALSE;
+  int ndigits = 0;
+  int nsignificant = 0;
+  int exponent = 0;
+  int exponent_sign, exponent_value;
+  uint64_t mantissa = 0;
+  double value;
+
+  if(*c == '+' || *c == '-')
+    negative = *c++ == '-';
+
+  for(; isdigit((unsigned char) *c); c++, ndigits++)
+  {
+    if(mantissa || *c != '0')
+      nsignificant++;
+    mantissa = 10 * mantissa + (*c - '0');
+  }
+
+  if(*c == '.')
+  {
+    for(c++; isdigit((unsigned char) *c); c++, ndigits++)
+    {
+      if(mantissa || *c != '0')
+        nsignificant++;
+      mantissa = 10 * mantissa + (*c - '0');
+      exponent--;
+    }
+  }
+
+  /* No digits, i.e. inf, nan or not a number at all, or a number which needs
+     more care than we can give it here, e.g. hex floats, so let strtod deal
+     with it */
+
+  if(ndigits == 0 || nsignificant > MAX_FAST_DIGITS || *c == 'x' || *c == 'X')
+    return strtod(str, end);
+
+  if(*c == 'e' || *c == 'E')
+  {
+    char *e = c + 1;
+
+    exponent_sign = 1;
+    if(*e == '+' || *e == '-')
+      exponent_sign = *e++ == '-' ? -1 : 1;
+
+    if(isdigit((unsigned char) *e))
+    {
+      for(exponent_value = 0; isdigit((unsigned char) *e); e++)
+        if(exponent_value < 10000)
+          exponent_value = 10 * exponent_value + (*e - '0');
+      exponent += exponent_sign * exponent_value;
+      c = e;
+    }
+  }
+
+  if(mantissa > MAX_FAST_MANTISSA || exponent > MAX_FAST_EXPONENT || exponent < -MAX_FAST_EXPONENT)
+    return strtod(str, end);
+
+  *end = c;
+
+  value = (double) mantissa;
+  if(exponent >= 0)
+    value *= POWERS_OF_TEN[exponent];
+  else
+    value /= POWERS_OF_TEN[-exponent];
+
+  return negative ? -value : value;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Skip over any whitespace
+ *
+ * @param[in]  c  The current position in a record
+ *
+ * @return  The first character in the record which is not whitespace
+ *
+ * ************************************************************************** */
+
+char *
+skip_whitespace(char *c)
+{
+  while(isspace((unsigned char) *c))
+    c++;
+
+  return c;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Get the next word in a record
+ *
+ * @param[in, out]  cursor  The current position in the record, which is moved
+ *                          to the end of the word
+ * @param[out]      token   The start of the word
+ *
+ * @return  The length of the word, or 0 if there are no words left
+ *
+ * ************************************************************************** */
+
+int
+next_token(char **cursor, char **token)
+{
+  char *c = skip_whitespace(*cursor);
+
+  *token = c;
+  while(*c != '\0' && !isspace((unsigned char) *c))
+    c++;
+  *cursor = c;
+
+  return c - *token;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Read an integer from a record
+ *
+ * @param[in, out]  cursor  The current position in the record
+ * @param[in]       width   The maximum number of characters to read, or 0 for
+ *                          no limit
+ * @param[out]      value   The integer read in
+ *
+ * @return  1 if an integer was read, 0 if the next word is not an integer or
+ *          EOF if there is nothing left in the record
+ *
+ * @details
+ *
+ * As with %d in sscanf, the cursor is left after the last digit read.
+ *
+ * ************************************************************************** */
+
+int
+next_int(char **cursor, int width, int *value)
+{
+  char *c = skip_whitespace(*cursor);
+  char *start;
+  int negative = FALSE;
+  long result = 0;
+
+  if(*c == '\0')
+    return EOF;
+  if(width <= 0)
+    width = INT32_MAX;
+
+  start = c;
+  if((*c == '+' || *c == '-') && width > 1)
+    negative = *c++ == '-';
+
+  if(!isdigit((unsigned char) *c))
+    return 0;
+
+  while(isdigit((unsigned char) *c) && c - start < width)
+    result = 10 * result + (*c++ - '0');
+
+  *value = (int) (negative ? -result : result);
+  *cursor = c;
+
+  return 1;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Read a floating point number from a record
+ *
+ * @param[in, out]  cursor  The current position in the record
+ * @param[out]      value   The number read in
+ *
+ * @return  1 if a number was read, 0 if the next word is not a number or EOF
+ *          if there is nothing left in the record
+ *
+ * ************************************************************************** */
+
+int
+next_double(char **cursor, double *value)
+{
+  char *c = skip_whitespace(*cursor);
+  char *end;
+  double result;
+
+  if(*c == '\0')
+    return EOF;
+
+  result = fast_strtod(c, &end);
+  if(end == c)
+    return 0;
+
+  *value = result;
+  *cursor = end;
+
+  return 1;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  A replacement for sscanf for the records in the atomic data
+ *
+ * @param[in]  record  The record to read
+ * @param[in]  format  The format of the record
+ * @param[out] ...     Pointers to where the values read in are stored
+ *
+ * @return  The number of values read in, or EOF if the record ended before
+ *          anything was read in, exactly as sscanf would
+ *
+ * @details
+ *
+ * Only the conversions used for the atomic data are understood, which are %d,
+ * %s, %c, %le, %lf and %lg, each of which can have a width (but widths are
+ * ignored for the floating point conversions) and be suppressed with *.
+ *
+ * ************************************************************************** */
+
+int
+scan_atomic_record(char *record, char *format, ...)
+{
+  int nread = 0;
+  int suppress, is_long, width, status, n;
+  int ivalue;
+  double dvalue;
+  char *c = record;
+  char *f = format;
+  char *dest;
+  va_list ap;
+
+  va_start(ap, format);
+
+  while(*f != '\0')
+  {
+    if(isspace((unsigned char) *f))
+    {
+      c = skip_whitespace(c);
+      f++;
+      continue;
+    }
+
+    if(*f != '%')
+    {
+      if(*c == '\0')
+        goto input_failure;
+      if(*c++ != *f++)
+        break;
+      continue;
+    }
+
+    f++;
+    suppress = *f == '*';
+    if(suppress)
+      f++;
+    for(width = 0; isdigit((unsigned char) *f); f++)
+      width = 10 * width + (*f - '0');
+    is_long = *f == 'l';
+    if(is_long)
+      f++;
+
+    switch (*f++)
+    {
+    case 'd':
+      if((status = next_int(&c, width, &ivalue)) == EOF)
+        goto input_failure;
+      if(status == 0)
+        goto matching_failure;
+      if(!suppress)
+      {
+        *va_arg(ap, int *) = ivalue;
+        nread++;
+      }
+      break;
+    case 'e':
+    case 'f':
+    case 'g':
+      if((status = next_double(&c, &dvalue)) == EOF)
+        goto input_failure;
+      if(status == 0)
+        goto matching_failure;
+      if(!suppress)
+      {
+        if(is_long)
+          *va_arg(ap, double *) = dvalue;
+        else
+          *va_arg(ap, float *) = (float) dvalue;
+        nread++;
+      }
+      break;
+    case 's':
+      c = skip_whitespace(c);
+      if(*c == '\0')
+        goto input_failure;
+      dest = suppress ? NULL : va_arg(ap, char *);
+      for(n = 0; *c != '\0' && !isspace((unsigned char) *c) && (width == 0 || n < width); n++, c++)
+        if(dest)
+          dest[n] = *c;
+      if(dest)
+      {
+        dest[n] = '\0';
+        nread++;
+      }
+      break;
+    case 'c':
+      if(*c == '\0')
+        goto input_failure;
+      if(width == 0)
+        width = 1;
+      dest = suppress ? NULL : va_arg(ap, char *);
+      for(n = 0; *c != '\0' && n < width; n++, c++)
+        if(dest)
+          dest[n] = *c;
+      if(dest)
+        nread++;
+      break;
+    default:
+      goto matching_failure;
+    }
+  }
+
+matching_failure:
+  va_end(ap);
+  return nread;
+
+input_failure:
+  va_end(ap);
+  return nread ? nread : EOF;
+}
@@ -11,9 +11,11 @@
  * ************************************************************************** */
 
 #include <stdlib.h>
+#include <math.h>
 #include <string.h>
 #include <ctype.h>
 #include <stdarg.h>
+#include <unistd.h>
 
 #include "atomix.h"
 
@@ -354,3 +356,95 @@ create_string(char *str, char *fmt, ...)
 
   return len;
 }
+
+/* ************************************************************************** */
+/**
+ * @brief  Make a grid of temperatures, evenly spaced in log temperature.
+ *
+ * @param[out]  temp   The temperatures
+ * @param[in]   ntemp  The number of temperatures
+ * @param[in]   tmin   The minimum temperature
+ * @param[in]   tmax   The maximum temperature
+ *
+ * ************************************************************************** */
+
+void
+temperature_grid(double *temp, int ntemp, double tmin, double tmax)
+{
+  int k;
+
+  for(k = 0; k < ntemp; ++k)
+    temp[k] = tmin * pow(tmax / tmin, k / (double) (ntemp - 1));
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Work out how many chunks to split some work into, one per thread
+ *
+ * @param[in]  n               The number of items of work
+ * @param[in]  min_per_thread  The fewest items worth giving a thread
+ *
+ * @return  The number of chunks, between 1 and PARALLEL_MAX_THREADS
+ *
+ * @details
+ *
+ * There is at most one chunk for each processor. Chunk i covers the items
+ * from n * i / nchunks up to n * (i + 1) / nchunks.
+ *
+ * ************************************************************************** */
+
+int
+count_parallel_chunks(int n, int min_per_thread)
+{
+  int nchunks;
+  long ncpus;
+
+  ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+  nchunks = n / min_per_thread;
+  if(nchunks > ncpus)
+    nchunks = ncpus;
+  if(nchunks > PARALLEL_MAX_THREADS)
+    nchunks = PARALLEL_MAX_THREADS;
+  if(nchunks < 1)
+    nchunks = 1;
+
+  return nchunks;
+}
+
+/* ************************************************************************** */
+/**
+ * @brief  Run a set of tasks, one per thread
+ *
+ * @param[in]  fn         The function to run each task with
+ * @param[in]  tasks      The tasks, an array of structures passed to fn
+ * @param[in]  task_size  The size of each task
+ * @param[in]  ntasks     The number of tasks, at most PARALLEL_MAX_THREADS
+ *
+ * @details
+ *
+ * The first task is run by the calling thread. If a thread can't be started,
+ * its task is run by the calling thread instead.
+ *
+ * ************************************************************************** */
+
+void
+run_parallel_tasks(void *(*fn)(void *), void *tasks, size_t task_size, int ntasks)
+{
+  int i;
+  int started[PARALLEL_MAX_THREADS];
+  char *task = tasks;
+  pthread_t threads[PARALLEL_MAX_THREADS];
+
+  for(i = 1; i < ntasks; i++)
+    started[i] = pthread_create(&threads[i], NULL, fn, task + i * task_size) == 0;
+
+  fn(task);
+
+  for(i = 1; i < ntasks; i++)
+  {
+    if(started[i])
+      pthread_join(threads[i], NULL);
+    else
+      fn(task + i * task_size);
+  }
+}
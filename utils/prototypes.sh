@@ -1,4 +1,4 @@
 #!/bin/bash
-cproto lines.c buffer.c main.c menu.c tools.c ui.c photoionization.c atomic_data.c query.c \
-       elements.c ions.c levels.c inner.c parse.c > functions.h
+cproto lines.c buffer.c main.c menu.c tools.c ui.c photoionization.c atomic_data.c atomic_cache.c atomic_loader.c atomic_tables.c sort.c postings.c coverage.c xsection.c opacity.c collisions.c rates.c equilibrium.c gaunt.c line_stream.c tokenizer.c query.c \
+       elements.c ions.c levels.c inner.c free_free.c parse.c > functions.h
 cproto log.c > log.h